@@ -82,6 +82,41 @@ class Card(ctypes.Structure):
         ("anniversary", ctypes.POINTER(DateTime))
     ]
 
+# Defines the flat CardSummary record
+class CardSummary(ctypes.Structure):
+    _fields_ = [
+        ("status", ctypes.c_int32),
+        ("numOptionalProperties", ctypes.c_int32),
+        ("flags", ctypes.c_uint32),
+        ("fileName", ctypes.c_uint32),
+        ("fn", ctypes.c_uint32),
+        ("birthdayDate", ctypes.c_uint32),
+        ("birthdayTime", ctypes.c_uint32),
+        ("birthdayText", ctypes.c_uint32),
+        ("anniversaryDate", ctypes.c_uint32),
+        ("anniversaryTime", ctypes.c_uint32),
+        ("anniversaryText", ctypes.c_uint32)
+    ]
+
+# Defines the CardSummaryBatch header
+class CardSummaryBatch(ctypes.Structure):
+    _fields_ = [
+        ("count", ctypes.c_uint32),
+        ("stringsLength", ctypes.c_uint32),
+        ("records", ctypes.POINTER(CardSummary)),
+        ("strings", ctypes.c_void_p)
+    ]
+
+
+# Defines the CardFileEntry struct returned by the directory scanner
+class CardFileEntry(ctypes.Structure):
+    _fields_ = [
+        ("name", ctypes.c_char * 256),
+        ("size", ctypes.c_int64),
+        ("mtimeSec", ctypes.c_int64),
+        ("mtimeNsec", ctypes.c_int32)
+    ]
+
 
 # Allows the python code to use C functions
 lib.createCard.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.POINTER(Card))]
@@ -96,6 +131,87 @@ lib.deleteCard.restype = None
 lib.writeCard.argtypes = [ctypes.c_char_p, ctypes.POINTER(Card)]
 lib.writeCard.restype = ctypes.c_int
 
+lib.createCardSummaries.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.POINTER(ctypes.POINTER(CardSummaryBatch))]
+lib.createCardSummaries.restype = ctypes.c_int
+
+lib.deleteCardSummaries.argtypes = [ctypes.POINTER(CardSummaryBatch)]
+lib.deleteCardSummaries.restype = None
+
+lib.scanCardDirectory.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.POINTER(CardFileEntry)), ctypes.POINTER(ctypes.c_int)]
+lib.scanCardDirectory.restype = ctypes.c_int
+
+lib.deleteCardDirectory.argtypes = [ctypes.POINTER(CardFileEntry)]
+lib.deleteCardDirectory.restype = None
+
+lib.createCardTrieFromNames.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.POINTER(ctypes.c_void_p)]
+lib.createCardTrieFromNames.restype = ctypes.c_int
+
+lib.deleteCardTrie.argtypes = [ctypes.c_void_p]
+lib.deleteCardTrie.restype = None
+
+lib.lookupCardPrefix.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int]
+lib.lookupCardPrefix.restype = ctypes.c_int
+
+# Messages for the VCardErrorCode values, in the order of the enum
+ERROR_NAMES = ["OK", "Invalid file", "Invalid card", "Invalid property", "Invalid date",
+               "Write error", "Other error", "Invalid encoding"]
+
+lib.updateCardProperty.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+lib.updateCardProperty.restype = ctypes.c_int
+
+# Lists the vcf files in the cards folder with their modification times in one call
+def scan_cards():
+    entries_ptr = ctypes.POINTER(CardFileEntry)()
+    count = ctypes.c_int()
+
+    if lib.scanCardDirectory(b"./cards", ctypes.byref(entries_ptr), ctypes.byref(count)) != 0:
+        return {}
+
+    modified = {}
+    for i in range(count.value):
+        entry = entries_ptr[i]
+        modified[entry.name.decode('utf-8')] = datetime.datetime.fromtimestamp(entry.mtimeSec + entry.mtimeNsec / 1e9)
+
+    lib.deleteCardDirectory(entries_ptr)
+
+    return modified
+
+# Reads every record of a summary batch in a single crossing
+def read_summaries(filenames):
+    paths = [f"./cards/{filename}".encode('utf-8') for filename in filenames]
+    path_array = (ctypes.c_char_p * len(paths))(*paths)
+    batch_ptr = ctypes.POINTER(CardSummaryBatch)()
+
+    if lib.createCardSummaries(path_array, len(paths), ctypes.byref(batch_ptr)) != 0 or not batch_ptr:
+        return []
+
+    # Copies the records and the string blob, which are contiguous, out of the batch at once
+    batch = batch_ptr.contents
+    records_size = ctypes.sizeof(CardSummary) * batch.count
+    block = ctypes.string_at(batch.records, records_size + batch.stringsLength)
+    lib.deleteCardSummaries(batch_ptr)
+
+    records = (CardSummary * len(filenames)).from_buffer_copy(block[:records_size])
+    strings = block[records_size:]
+
+    # Decodes a string field from its offset in the blob
+    def field(offset):
+        return strings[offset:strings.index(b'\0', offset)].decode('utf-8', errors='replace')
+
+    summaries = []
+    for filename, record in zip(filenames, records):
+        summaries.append({
+            "filename": filename,
+            "status": record.status,
+            "contact": field(record.fn),
+            "birthday_date": field(record.birthdayDate) if record.flags & 0x01 else None,
+            "birthday_time": field(record.birthdayTime) if record.flags & 0x01 else None,
+            "anniversary_date": field(record.anniversaryDate) if record.flags & 0x08 else None,
+            "anniversary_time": field(record.anniversaryTime) if record.flags & 0x08 else None
+        })
+
+    return summaries
+
 # Displays the login page
 class LoginView(Frame):
     def __init__(self, screen):
@@ -169,6 +285,9 @@ class ContactModel():
         self.current_id = None
         self.current_card = None
 
+        # Name trie used by the find box
+        self.trie = None
+
         if _db_connection is not None:
             self.create_tables()
 
@@ -315,6 +434,7 @@ class ContactModel():
             return []
         else:
             valid_files = []
+            names = []
 
             # Defines the cursor
             self.cursor = _db_connection.cursor()
@@ -324,131 +444,135 @@ class ContactModel():
             files_in_db = self.cursor.fetchall()
             files_in_db = {row[0] for row in files_in_db}
 
-            # Loops through the files in the cards folder
-            for filename in os.listdir("./cards"):
-
-                if filename.endswith(".vcf"):
-                    # Converts the filepath into a string
-                    filepath = f"./cards/{filename}".encode('utf-8')
-
-                    # Creates a pointer for the Card to be populated
-                    card_ptr = ctypes.POINTER(Card)()
-
-                    # Calls createCard to populate the card object
-                    result = lib.createCard(filepath, ctypes.byref(card_ptr))
-
-                    # If the return value is correct
-                    if result == 0 and card_ptr:
-                        # Calls the validateCard function
-                        validate_result = lib.validateCard(card_ptr)
-
-                        # If card is valid
-                        if validate_result == 0:
-                            # Returns the valid files
-                            valid_files.append((filename, filename))
-
-                            # Extracts contact name from the struct
-                            if card_ptr.contents.fn and card_ptr.contents.fn.contents.values:
-                                first_value = card_ptr.contents.fn.contents.values.contents.head
-
-                                # Stores the contact name
-                                if first_value and first_value.contents.data:
-                                    contact_name = ctypes.cast(first_value.contents.data, ctypes.c_char_p).value.decode('utf-8')
-                                else:
-                                    contact_name = None
-                            else:
-                                contact_name = None
-
-                            # Extracts birthday date and time from struct
-                            birthday_date = card_ptr.contents.birthday.contents.date.decode('utf-8') if card_ptr.contents.birthday else None
-                            birthday_time = card_ptr.contents.birthday.contents.time.decode('utf-8') if card_ptr.contents.birthday and card_ptr.contents.birthday.contents.time else None
-
-                            # Extracts anniversary date and time from struct
-                            anniversary_date = card_ptr.contents.anniversary.contents.date.decode('utf-8') if card_ptr.contents.anniversary else None
-                            anniversary_time = card_ptr.contents.anniversary.contents.time.decode('utf-8') if card_ptr.contents.anniversary and card_ptr.contents.anniversary.contents.time else None
-
-                            # Converts the birthday date and time to MySQL format
-                            if birthday_date and birthday_time:
-                                try:
-                                    birthday_str = f"{birthday_date} {birthday_time}"
-
-                                    # Converts the string into MySQL datetime format
-                                    format_bday = f"{birthday_str[:4]}-{birthday_str[4:6]}-{birthday_str[6:8]} {birthday_str[9:11]}:{birthday_str[11:13]}:{birthday_str[13:15]}"
-                                    birthday_datetime = datetime.datetime.strptime(format_bday, "%Y-%m-%d %H:%M:%S")
-                                    birthday = birthday_datetime.strftime("%Y-%m-%d %H:%M:%S")
-                                except ValueError:
-                                    birthday = None
-                            else:
-                                birthday = None
-
-                            # Converts the anniversary date and time to MySQL format
-                            if anniversary_date and anniversary_time:
-                                try:
-                                    anniv_str = f"{anniversary_date} {anniversary_time}"
-
-                                    # Converts the string into MySQL datetime format
-                                    format_anniv = f"{anniv_str[:4]}-{anniv_str[4:6]}-{anniv_str[6:8]} {anniv_str[9:11]}:{anniv_str[11:13]}:{anniv_str[13:15]}"
-                                    anniversary_datetime = datetime.datetime.strptime(format_anniv, "%Y-%m-%d %H:%M:%S")
-                                    anniversary = anniversary_datetime.strftime("%Y-%m-%d %H:%M:%S")
-                                except ValueError:
-                                    anniversary = None
-                            else:
-                                anniversary = None
-
-                            # Updates last_modified in the database if file already exists
-                            if filename in files_in_db:
-                                last_modified = datetime.datetime.fromtimestamp(os.path.getmtime(f"./cards/{filename}"))
-                                self.cursor.execute(
-                                    "UPDATE FILE SET last_modified = %s WHERE file_name = %s",
-                                    (last_modified, filename)
-                                )
-                                _db_connection.commit()
-
-                                # Retrieves the file_id from the FILE table
-                                self.cursor.execute("SELECT file_id FROM FILE WHERE file_name = %s", (filename,))
-                                file_id = self.cursor.fetchone()[0]
-
-                                # Checks if that file_id already exists before inserting to table
-                                self.cursor.execute("SELECT COUNT(*) FROM CONTACT WHERE file_id = %s", (file_id,))
-                                contact_exists = self.cursor.fetchone()[0]
-
-                                # Inserts info into the CONTACT table
-                                if contact_exists == 0 and contact_name:
-                                    self.cursor.execute(
-                                        "INSERT INTO CONTACT (name, birthday, anniversary, file_id) VALUES (%s, %s, %s, %s)",
-                                        (contact_name, birthday, anniversary, file_id)
-                                    )
-                                    _db_connection.commit()
-
-                            else:
-                                # Adds the file to the database if it is new
-                                creation_time = datetime.datetime.now()
-                                last_modified = datetime.datetime.fromtimestamp(os.path.getmtime(f"./cards/{filename}"))
-                                self.cursor.execute(
-                                    "INSERT INTO FILE (file_name, last_modified, creation_time) VALUES (%s, %s, %s)",
-                                    (filename, last_modified, creation_time)
-                                )
-                                _db_connection.commit()
-
-                                # Retrieves the file_id from the FILE table
-                                self.cursor.execute("SELECT file_id FROM FILE WHERE file_name = %s", (filename,))
-                                file_id = self.cursor.fetchone()[0]
-
-                                # Checks if that file_id already exists before inserting
-                                self.cursor.execute("SELECT COUNT(*) FROM CONTACT WHERE file_id = %s", (file_id,))
-                                contact_exists = selfcursor.fetchone()[0]
-
-                                # Inserts or updates the CONTACT table
-                                if contact_exists == 0 and contact_name:
-                                    self.cursor.execute(
-                                        "INSERT INTO CONTACT (name, birthday, anniversary, file_id) VALUES (%s, %s, %s, %s)",
-                                        (contact_name, birthday, anniversary, file_id)
-                                    )
-                                    _db_connection.commit()
+            # Lists the vcf files in the cards folder and parses them in one batch
+            modified = scan_cards()
+            filenames = list(modified)
+
+            for summary in read_summaries(filenames):
+                filename = summary["filename"]
+
+                # If card is valid
+                if summary["status"] == 0:
+                    # Returns the valid files
+                    valid_files.append((filename, filename))
+                    names.append((filename, summary["contact"]))
+
+                    # Extracts contact name, birthday and anniversary from the summary
+                    contact_name = summary["contact"] or None
+                    birthday_date = summary["birthday_date"]
+                    birthday_time = summary["birthday_time"] or None
+                    anniversary_date = summary["anniversary_date"]
+                    anniversary_time = summary["anniversary_time"] or None
+
+                    # Converts the birthday date and time to MySQL format
+                    if birthday_date and birthday_time:
+                        try:
+                            birthday_str = f"{birthday_date} {birthday_time}"
+
+                            # Converts the string into MySQL datetime format
+                            format_bday = f"{birthday_str[:4]}-{birthday_str[4:6]}-{birthday_str[6:8]} {birthday_str[9:11]}:{birthday_str[11:13]}:{birthday_str[13:15]}"
+                            birthday_datetime = datetime.datetime.strptime(format_bday, "%Y-%m-%d %H:%M:%S")
+                            birthday = birthday_datetime.strftime("%Y-%m-%d %H:%M:%S")
+                        except ValueError:
+                            birthday = None
+                    else:
+                        birthday = None
+
+                    # Converts the anniversary date and time to MySQL format
+                    if anniversary_date and anniversary_time:
+                        try:
+                            anniv_str = f"{anniversary_date} {anniversary_time}"
+
+                            # Converts the string into MySQL datetime format
+                            format_anniv = f"{anniv_str[:4]}-{anniv_str[4:6]}-{anniv_str[6:8]} {anniv_str[9:11]}:{anniv_str[11:13]}:{anniv_str[13:15]}"
+                            anniversary_datetime = datetime.datetime.strptime(format_anniv, "%Y-%m-%d %H:%M:%S")
+                            anniversary = anniversary_datetime.strftime("%Y-%m-%d %H:%M:%S")
+                        except ValueError:
+                            anniversary = None
+                    else:
+                        anniversary = None
+
+                    # Updates last_modified in the database if file already exists
+                    if filename in files_in_db:
+                        last_modified = modified[filename]
+                        self.cursor.execute(
+                            "UPDATE FILE SET last_modified = %s WHERE file_name = %s",
+                            (last_modified, filename)
+                        )
+                        _db_connection.commit()
+
+                        # Retrieves the file_id from the FILE table
+                        self.cursor.execute("SELECT file_id FROM FILE WHERE file_name = %s", (filename,))
+                        file_id = self.cursor.fetchone()[0]
+
+                        # Checks if that file_id already exists before inserting to table
+                        self.cursor.execute("SELECT COUNT(*) FROM CONTACT WHERE file_id = %s", (file_id,))
+                        contact_exists = self.cursor.fetchone()[0]
+
+                        # Inserts info into the CONTACT table
+                        if contact_exists == 0 and contact_name:
+                            self.cursor.execute(
+                                "INSERT INTO CONTACT (name, birthday, anniversary, file_id) VALUES (%s, %s, %s, %s)",
+                                (contact_name, birthday, anniversary, file_id)
+                            )
+                            _db_connection.commit()
+
+                    else:
+                        # Adds the file to the database if it is new
+                        creation_time = datetime.datetime.now()
+                        last_modified = modified[filename]
+                        self.cursor.execute(
+                            "INSERT INTO FILE (file_name, last_modified, creation_time) VALUES (%s, %s, %s)",
+                            (filename, last_modified, creation_time)
+                        )
+                        _db_connection.commit()
+
+                        # Retrieves the file_id from the FILE table
+                        self.cursor.execute("SELECT file_id FROM FILE WHERE file_name = %s", (filename,))
+                        file_id = self.cursor.fetchone()[0]
+
+                        # Checks if that file_id already exists before inserting
+                        self.cursor.execute("SELECT COUNT(*) FROM CONTACT WHERE file_id = %s", (file_id,))
+                        contact_exists = self.cursor.fetchone()[0]
+
+                        # Inserts or updates the CONTACT table
+                        if contact_exists == 0 and contact_name:
+                            self.cursor.execute(
+                                "INSERT INTO CONTACT (name, birthday, anniversary, file_id) VALUES (%s, %s, %s, %s)",
+                                (contact_name, birthday, anniversary, file_id)
+                            )
+                            _db_connection.commit()
+
+            # Rebuilds the name trie from the FN values already in the summaries
+            self.build_trie(names)
 
             # Returns a tuple of valid filenames
             return valid_files
 
+    # Builds the name trie used for type-ahead lookups from (filename, FN) pairs
+    def build_trie(self, names):
+        if self.trie:
+            lib.deleteCardTrie(self.trie)
+            self.trie = None
+
+        paths = [f"./cards/{filename}".encode('utf-8') for filename, _ in names]
+        path_array = (ctypes.c_char_p * len(paths))(*paths)
+        fn_array = (ctypes.c_char_p * len(names))(*[contact.encode('utf-8') for _, contact in names])
+        trie = ctypes.c_void_p()
+
+        if lib.createCardTrieFromNames(path_array, fn_array, len(names), ctypes.byref(trie)) == 0:
+            self.trie = trie
+
+    # Returns the files whose FN starts with the prefix
+    def find_prefix(self, prefix, limit=50):
+        if not self.trie:
+            return []
+
+        results = (ctypes.c_char_p * limit)()
+        count = lib.lookupCardPrefix(self.trie, prefix.encode('utf-8'), results, limit)
+
+        return [results[i].decode('utf-8')[len("./cards/"):] for i in range(count)]
+
     # A method to retrieve a single contact
     def get_contact(self, contact_id):
         return self._db.cursor().execute(
@@ -549,7 +673,7 @@ class ContactModel():
             "notes": notes
         }
 
-    # A method to update the current contact
+    # A method to update the current contact, returning a message if it could not be saved
     def update_current_contact(self, details):
         #Extracts the filename and new contact information
         filename = details.get("filename", "")
@@ -557,41 +681,29 @@ class ContactModel():
 
         # Ensures the user entered something in the contact field
         if not contact:
-            return
+            return "The contact name cannot be empty."
 
         if self.current_id is None:
             self.add(details)
-        else:
-            # Gets the filepath
-            filepath = f"./cards/{filename}".encode('utf-8')
-            card_ptr = ctypes.POINTER(Card)()
-            error_code = lib.createCard(filepath, ctypes.byref(card_ptr))
-
-        if error_code == 0 and card_ptr:
-            # Calls validateCard to ensure changes made are valid
-            validate_result = lib.validateCard(card_ptr)
-
-            if validate_result != 0:
-                return
+            return
 
-            # Updates the FN property value in the card struct
-            if card_ptr.contents.fn:
-                card_ptr.contents.fn.contents.values.contents.head.contents.data = ctypes.cast(
-                    ctypes.create_string_buffer(contact.encode('utf-8')),
-                    ctypes.c_void_p
-                )
+        # Rewrites only the FN line of the file, which may be gzip-compressed
+        filepath = f"./cards/{filename}".encode('utf-8')
+        result = lib.updateCardProperty(filepath, b"FN", contact.encode('utf-8'))
 
-            # Rewrites the updated contact to file
-            lib.writeCard(filepath, card_ptr)
+        # Reports the failure, as the edit was not saved
+        if result != 0:
+            reason = ERROR_NAMES[result] if result < len(ERROR_NAMES) else "Unknown error"
+            return f"Could not save {filename}: {reason}."
 
-            # Updates the database
-            self.cursor.execute('SELECT file_id FROM FILE WHERE file_name = %s', (filename,))
-            current_file = self.cursor.fetchone()
+        # Updates the database
+        self.cursor.execute('SELECT file_id FROM FILE WHERE file_name = %s', (filename,))
+        current_file = self.cursor.fetchone()
 
-            if current_file:
-                file_id = current_file[0]
-                self.cursor.execute('UPDATE CONTACT SET name = %s WHERE file_id = %s', (contact, file_id))
-                _db_connection.commit()
+        if current_file:
+            file_id = current_file[0]
+            self.cursor.execute('UPDATE CONTACT SET name = %s WHERE file_id = %s', (contact, file_id))
+            _db_connection.commit()
 
     # A method to delete the current contact
     def delete_contact(self, contact_id):
@@ -614,11 +726,15 @@ class ListView(Frame):
         # Save off the model that accesses the contacts database.
         self._model = model
 
+        # Creates the find box, which narrows the list as the user types
+        self._find = Text("Find:", "find", on_change=self._filter)
+
         # Create the form for displaying the list of contacts.
+        self._all_options = model.get_summary()
         self._list_view = ListBox(
             Widget.FILL_FRAME,
             # retrieves a list of valid files and their corresponding card objects
-            model.get_summary(),
+            self._all_options,
 
             # Displays the first instances of the valid_files tuple
             name="contacts",
@@ -634,7 +750,8 @@ class ListView(Frame):
         layout = Layout([100], fill_frame=True)
         self.add_layout(layout)
 
-        # Adds the listbox to the frame
+        # Adds the find box and the listbox to the frame
+        layout.add_widget(self._find)
         layout.add_widget(self._list_view)
         layout.add_widget(Divider())
 
@@ -658,9 +775,18 @@ class ListView(Frame):
 
     # Updates the list of contacts
     def _reload_list(self, new_value=None):
-        self._list_view.options = self._model.get_summary()
+        self._all_options = self._model.get_summary()
+        self._filter()
         self._list_view.value = new_value
 
+    # Narrows the list to the contacts whose name starts with the find text
+    def _filter(self):
+        prefix = self._find.value
+        if prefix:
+            self._list_view.options = [(filename, filename) for filename in self._model.find_prefix(prefix)]
+        else:
+            self._list_view.options = self._all_options
+
     # Gets called when the user selects the add button
     def _add(self):
         self._model.current_id = None
@@ -721,7 +847,13 @@ class ContactView(Frame):
 
     def _ok(self):
         self.save()
-        self._model.update_current_contact(self.data)
+        error = self._model.update_current_contact(self.data)
+
+        # Stays on the form, with the user's edit, so it can be corrected or cancelled
+        if error:
+            self.scene.add_effect(PopUpDialog(self.screen, error, ["OK"]))
+            return
+
         raise NextScene("Main")
 
     @staticmethod
@@ -40,6 +40,21 @@ typedef struct listHead{
 } List;
 
 
+/**
+ * List carved, together with some of its nodes and data, out of one larger allocation, such as
+ * the block of a packed or cloned card.  The list functions recognize it by its deleteData,
+ * keepBlockData.  They free only the nodes that lie outside the block and hand every piece of
+ * data to deleteItem, which frees whatever of it lies outside the block.  freeList does not free
+ * the header, which always lies in the block.
+ **/
+typedef struct blockList{
+    List list;
+    const void* blockStart;
+    size_t blockSize;
+    void (*deleteItem)(const struct blockList* list, void* toBeDeleted);
+} BlockList;
+
+
 /**
  * List iterator structure.
  * It represents an abstract object for iterating through the list.
@@ -64,6 +79,34 @@ List* initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunc
 
 
 
+/** Function to initialize a list that lives inside a larger allocation.
+*@pre list lies between blockStart and blockStart + blockSize
+*@post list is empty and its deleteData is keepBlockData
+*@return list, as a List
+*@param list - storage for the list inside the block
+*@param blockStart - the start of the block
+*@param blockSize - the size of the block in bytes
+*@param printFunction - function pointer to print a single node of the list
+*@param deleteItem - function pointer to release a single piece of data, given the list it belongs to
+*@param compareFunction - function pointer to compare two nodes of the list
+**/
+List* initializeBlockList(BlockList* list, const void* blockStart, size_t blockSize, char* (*printFunction)(void* toBePrinted),
+                          void (*deleteItem)(const BlockList* list, void* toBeDeleted), int (*compareFunction)(const void* first,const void* second));
+
+/** deleteData of every BlockList.  It frees nothing; the list functions call deleteItem instead.
+*@param toBeDeleted - ignored
+**/
+void keepBlockData(void* toBeDeleted);
+
+/** Function to check whether a pointer lies inside the block of a BlockList.
+*@return true if ptr lies in the block, false otherwise
+*@param list - the list
+*@param ptr - the pointer to check
+**/
+bool inListBlock(const BlockList* list, const void* ptr);
+
+
+
 /**Function for creating a node for the linked list. 
 * This node contains abstracted (void *) data as well as previous and next
 * pointers to connect to other nodes in the list
@@ -127,6 +170,18 @@ void insertSorted(List* list, void* toBeAdded);
 
 
 
+/** Sorts the list in place using the comparison function pointer.
+* Runs in O(n log n) time without allocating, and is stable: elements that compare
+* equal keep their relative order.  Prefer this over repeated insertSorted calls
+* when building a sorted list from many elements.
+*@pre List exists and has memory allocated to it.
+*@post The list is in ascending order according to its compare function
+*@param list - a pointer to the List struct
+**/
+void sortList(List* list);
+
+
+
 /** Removes data from from the list, deletes the node and frees the memory,
  * changes pointer values of surrounding nodes to maintain list structure.
  * returns the data 
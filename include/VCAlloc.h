@@ -0,0 +1,96 @@
+#ifndef _CARDALLOC_H
+#define _CARDALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Memory source for everything a Card owns: properties, parameters, dates, their strings,
+    and the List and Node structs of the list code.  The library's own working memory (file
+    buffers, hash tables, writer buffers and zlib state) comes from it as well, so a limit set
+    with setVCardMemoryLimit covers all of it.  Strings the library returns for the
+    caller to free (cardToString, errorToString and the list and helper toString functions)
+    always come from malloc, whatever allocator is set.
+*/
+typedef struct vCardAllocator {
+    //Returns size bytes aligned for any type, or NULL
+    void*   (*allocate)(size_t size, void* context);
+
+    //Resizes a block from allocate.  May be NULL, in which case the library allocates a new
+    //block, copies and releases the old one
+    void*   (*reallocate)(void* ptr, size_t size, void* context);
+
+    //Releases a block from allocate or reallocate
+    void    (*release)(void* ptr, void* context);
+
+    //Passed to every call
+    void*   context;
+
+} VCardAllocator;
+
+//Memory the calling thread has taken through the library
+typedef struct vCardHeapStats {
+    //Bytes currently held, including the library's per-block header.  Blocks freed by another
+    //thread than the one that allocated them are subtracted there, so this may go negative
+    int64_t     bytesInUse;
+
+    //Highest bytesInUse since the thread started or called resetVCardHeapPeak
+    int64_t     peakBytes;
+
+    //Allocations refused because of the limit set with setVCardMemoryLimit
+    uint64_t    failedAllocations;
+
+} VCardHeapStats;
+
+
+/** Function to route all future Card memory through an allocator.
+ *  Every block records the allocator it came from, so blocks are always released by the
+ *  allocator that created them and the allocator may be changed while cards are alive.
+ *@pre allocator, if not NULL, stays valid until every block it allocated has been released
+ *@param allocator - the allocator to use, or NULL for malloc, realloc and free
+ **/
+void setVCardAllocator(const VCardAllocator* allocator);
+
+/** Function to cap the memory the calling thread may hold through the library.
+ *  Allocations that would take bytesInUse past the limit fail, which the parser reports as
+ *  OTHER_ERROR, so one oversized request cannot exhaust a shared process.
+ *@param limit - the most bytes the thread may hold, or 0 for no limit
+ **/
+void setVCardMemoryLimit(size_t limit);
+
+/** Function to read the calling thread's memory accounting.
+ *@param stats - receives the counters
+ **/
+void getVCardHeapStats(VCardHeapStats* stats);
+
+/** Function to restart peak tracking for the calling thread from its current usage.
+ **/
+void resetVCardHeapPeak(void);
+
+/*  Memory functions used for everything a Card owns, in place of malloc, calloc, realloc and
+    free.  They go through the current allocator, keep the byte accounting above and count each
+    call in ParserStats.  Objects that deleteCard, deleteProperty and the other delete
+    functions release must have been allocated with them.
+*/
+void* vcMalloc(size_t size);
+void* vcCalloc(size_t count, size_t size);
+void* vcRealloc(void* ptr, size_t size);
+void vcFree(void* ptr);
+
+/** Function to get the usable size of a block from vcMalloc, vcCalloc or vcRealloc.
+ *@return the size that was requested for the block, or 0 if ptr is NULL
+ **/
+size_t vcAllocatedSize(const void* ptr);
+
+/** Function to get the bytes the library keeps in front of every block for its bookkeeping.
+ *@return the size of the per-block header
+ **/
+size_t vcHeaderSize(void);
+
+/*  zlib allocation hooks that take a stream's state from vcMalloc and vcFree.  Their types
+    match zlib's alloc_func and free_func so they can be stored in a z_stream's zalloc and
+    zfree; opaque is ignored.
+*/
+void* vcZlibAlloc(void* opaque, unsigned int items, unsigned int size);
+void vcZlibFree(void* opaque, void* address);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef _CARDBINARY_H
+#define _CARDBINARY_H
+
+#include "VCParser.h"
+
+/*  Archive of cards in the binary format, opened with openCardArchive.  The file is mapped
+    read-only and every string in it is stored NUL-terminated, so names and values can be
+    read in place.  The layout is private to VCBinary.c
+*/
+typedef struct cardArchive CardArchive;
+
+
+/** Function to save one card in the binary format.
+ *  The file is an archive holding a single card with an empty name, so it can also be read
+ *  with openCardArchive.
+ *@pre obj is a valid Card
+ *@return OK on success, WRITE_ERROR if the arguments are invalid or the file could not be
+          written, OTHER_ERROR if memory could not be allocated
+ *@param fileName - the file to create
+         obj - the card to save
+ **/
+VCardErrorCode saveCardBinary(const char* fileName, const Card* obj);
+
+/** Function to load a card saved by saveCardBinary.
+ *@post On success obj points to a new card that must be released with deleteCard
+ *@return OK on success, INV_FILE if the file cannot be read or is not a binary card file,
+          INV_CARD if the card record is damaged, OTHER_ERROR if the arguments are invalid
+          or memory could not be allocated
+ *@param fileName - the file to read
+         obj - receives the new card
+ **/
+VCardErrorCode loadCardBinary(const char* fileName, Card** obj);
+
+/** Function to pack every .vcf file of a directory into one binary archive.
+ *  The files are listed with scanCardDirectory and parsed with loadCards.  Files that fail
+ *  to parse are left out.  Each card is stored under its file name within the directory, in
+ *  directory order.
+ *@return OK on success, INV_FILE if the directory cannot be read, WRITE_ERROR if the archive
+          could not be written, OTHER_ERROR if the arguments are invalid or memory could not
+          be allocated
+ *@param dirPath - the directory to pack
+         archiveName - the archive file to create
+         numPacked - receives the number of cards stored, may be NULL
+ **/
+VCardErrorCode packCardDirectory(const char* dirPath, const char* archiveName, int* numPacked);
+
+/** Function to open a binary archive.
+ *  The file is mapped into memory and its header, name table and directory are checked;
+ *  card records are only checked as they are read.
+ *@post On success archive points to an open archive that must be released with closeCardArchive
+ *@return OK on success, INV_FILE if the file cannot be read or is not a binary archive,
+          OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param fileName - the archive to open
+         archive - receives the open archive
+ **/
+VCardErrorCode openCardArchive(const char* fileName, CardArchive** archive);
+
+/** Function to close an archive and unmap its file.
+ *  Strings returned by cardArchiveName and cardArchiveFN are invalid afterwards.
+ *@param archive - the archive to close, may be NULL
+ **/
+void closeCardArchive(CardArchive* archive);
+
+/** Function to get the number of cards in an archive.
+ *@return the number of cards, 0 if archive is NULL
+ **/
+int cardArchiveCount(const CardArchive* archive);
+
+/** Function to get the name a card was stored under, without copying it.
+ *@return a string inside the mapped archive, or NULL if index is out of range or the record is damaged
+ *@param archive - an open archive
+         index - the card, from 0 to cardArchiveCount - 1
+ **/
+const char* cardArchiveName(const CardArchive* archive, int index);
+
+/** Function to get the first value of a card's FN property, without copying it or building the card.
+ *@return a string inside the mapped archive, or NULL if index is out of range, the card has
+          no FN or the record is damaged
+ *@param archive - an open archive
+         index - the card, from 0 to cardArchiveCount - 1
+ **/
+const char* cardArchiveFN(const CardArchive* archive, int index);
+
+/** Function to build one card of an archive.
+ *@post On success obj points to a new card that must be released with deleteCard.  It does
+        not refer to the archive, which may be closed afterwards.
+ *@return OK on success, INV_CARD if the record is damaged, OTHER_ERROR if the arguments are
+          invalid or memory could not be allocated
+ *@param archive - an open archive
+         index - the card, from 0 to cardArchiveCount - 1
+         obj - receives the new card
+ **/
+VCardErrorCode loadArchiveCard(const CardArchive* archive, int index, Card** obj);
+
+#endif
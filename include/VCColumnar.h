@@ -0,0 +1,79 @@
+#ifndef _CARDCOLUMNAR_H
+#define _CARDCOLUMNAR_H
+
+#include <stdint.h>
+
+#include "VCParser.h"
+
+/*  Arrow C data interface structures.  These are copied verbatim from the Arrow
+    specification, which declares them ABI-stable and guards them with the same macro,
+    so this header can be included alongside arrow/c/abi.h.
+*/
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    //Array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    //Release callback
+    void (*release)(struct ArrowSchema*);
+
+    //Opaque producer-specific data
+    void* private_data;
+};
+
+struct ArrowArray {
+    //Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    //Release callback
+    void (*release)(struct ArrowArray*);
+
+    //Opaque producer-specific data
+    void* private_data;
+};
+
+#endif
+
+
+/** Function to parse a set of vCard files into an Arrow struct array with one utf8 column
+ *  per requested property name.
+ *  Column values are the property values joined with ';', exactly as they appear in the file.
+ *  "FN" reads the Card's fn property, "BDAY" and "ANNIVERSARY" read the Card's DateTime fields,
+ *  and any other name reads the first optional property with that name (case-insensitive).
+ *  A missing property is a null entry; a file that fails createCard is a null row.
+ *@pre fileNames contains numFiles file names, propNames contains numProps property names.
+       schema and array point to caller-owned, uninitialized structs.
+ *@post On success schema and array are initialized and must be released through their
+        release callbacks.  On failure they are left untouched.
+ *@return OK on success, OTHER_ERROR if the arguments are invalid, memory could not be
+          allocated, or a column exceeds 2GB of character data
+ *@param fileNames - array of file names
+         numFiles - number of entries in fileNames
+         propNames - array of property names, one per column
+         numProps - number of entries in propNames
+         schema - receives the exported schema
+         array - receives the exported data
+ **/
+VCardErrorCode exportCardColumns(char** fileNames, int numFiles, char** propNames, int numProps,
+                                 struct ArrowSchema* schema, struct ArrowArray* array);
+
+#endif
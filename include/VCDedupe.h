@@ -0,0 +1,60 @@
+#ifndef _CARDDEDUPE_H
+#define _CARDDEDUPE_H
+
+#include <stdint.h>
+
+#include "VCParser.h"
+
+//Default similarity a pair of cards needs to be reported as duplicates
+#define DEFAULT_DUPLICATE_THRESHOLD 0.5
+
+//One group of cards that appear to describe the same contact
+typedef struct cardCluster {
+    //Position of the cluster's first member in the report's members array
+    int32_t     first;
+
+    //Number of members, always at least 2
+    int32_t     count;
+
+    //Lowest similarity among the pairs that joined the cluster, between 0 and 1
+    double      score;
+
+} CardCluster;
+
+
+/*  Result of findDuplicateCards.  The struct, the clusters and the members array live in
+    a single allocation.  Members are indexes into the input array, in increasing order
+    within each cluster, and clusters are ordered by their first member.
+*/
+typedef struct duplicateReport {
+    int32_t         numClusters;
+    CardCluster*    clusters;
+    int32_t*        members;
+
+} DuplicateReport;
+
+
+/** Function to group cards that describe the same contact.
+ *  Each card is reduced to normalized fingerprints: its name (FN, and the family and given
+ *  names of N, as case-folded words in sorted order), every EMAIL lowercased, the last ten
+ *  digits of every TEL, and its UID.  Cards are only compared when they share a fingerprint,
+ *  so the work grows with the number of cards rather than the number of pairs.  Similarity is
+ *  the weighted Jaccard index of the two fingerprint sets, except that cards with the same UID
+ *  always match and cards with different UIDs never do.  Matching pairs are merged
+ *  transitively into clusters.
+ *@pre cards contains numCards valid Cards
+ *@post report points to a new report that must be released with deleteDuplicateReport
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param cards - the cards to compare
+         numCards - number of entries in cards
+         threshold - similarity needed to link two cards, or 0 for DEFAULT_DUPLICATE_THRESHOLD
+         report - receives the clusters
+ **/
+VCardErrorCode findDuplicateCards(Card** cards, int numCards, double threshold, DuplicateReport** report);
+
+/** Function to release a report created by findDuplicateCards.
+ *@param report - the report to release, may be NULL
+ **/
+void deleteDuplicateReport(DuplicateReport* report);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _CARDDIFF_H
+#define _CARDDIFF_H
+
+#include "VCParser.h"
+
+//What happened to the thing a change describes
+typedef enum diffKind {
+    DIFF_ADDED,
+    DIFF_REMOVED,
+    DIFF_CHANGED
+} DiffKind;
+
+//What a change describes
+typedef enum diffTarget {
+    //A whole property.  Never DIFF_CHANGED; a changed property is reported by its parts
+    DIFF_PROPERTY,
+
+    //One parameter of a property that is in both cards
+    DIFF_PARAMETER,
+
+    //One value of a property that is in both cards
+    DIFF_VALUE,
+
+    //The birthday or anniversary
+    DIFF_BIRTHDAY,
+    DIFF_ANNIVERSARY
+} DiffTarget;
+
+/*  One difference between two cards.  Every pointer borrows from the cards that were
+    compared, so a diff is only usable while both cards are alive and unchanged.
+*/
+typedef struct cardChange {
+    DiffKind        kind;
+    DiffTarget      target;
+
+    //The property in the first and second card.  before is NULL for an added property and
+    //after is NULL for a removed one.  Both are NULL for date changes
+    const Property* before;
+    const Property* after;
+
+    //Position of the value in its property for DIFF_VALUE, otherwise -1.  For an added value
+    //it is the position in after, otherwise the position in before
+    int             index;
+
+    //Old and new value for DIFF_VALUE, or parameter value for DIFF_PARAMETER.  NULL on the
+    //side where it does not exist
+    const char*     oldText;
+    const char*     newText;
+
+    //Parameter name for DIFF_PARAMETER, otherwise NULL
+    const char*     paramName;
+
+    //Old and new date for DIFF_BIRTHDAY and DIFF_ANNIVERSARY, NULL where absent
+    const DateTime* oldDate;
+    const DateTime* newDate;
+
+} CardChange;
+
+//Every difference between two cards
+typedef struct cardDiff {
+    int             numChanges;
+    CardChange*     changes;
+
+} CardDiff;
+
+
+/** Function to list the differences between two cards.
+ *  Properties (the FN field included) are paired first by identical name, group and values,
+ *  and the rest by name and group in order of appearance, both through hash tables, so the
+ *  work is linear in the size of the cards.  Paired properties are then compared parameter by
+ *  parameter, matched by name and occurrence, and value by value, by position.
+ *  Changes to properties of the second card are listed in its order, followed by the
+ *  properties only the first card has, then the dates.
+ *@pre a and b are valid Cards
+ *@post out points to a new diff that must be released with deleteCardDiff.  It has no
+        changes if the cards are equivalent.
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param a - the original card
+         b - the edited card
+         out - receives the differences
+ **/
+VCardErrorCode diffCards(const Card* a, const Card* b, CardDiff** out);
+
+/** Function to release a diff created by diffCards.
+ *@param diff - the diff to release, may be NULL
+ **/
+void deleteCardDiff(CardDiff* diff);
+
+#endif
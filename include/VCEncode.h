@@ -0,0 +1,50 @@
+#ifndef _CARDENCODE_H
+#define _CARDENCODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Byte buffers, LEB128 varints and hashing shared by the binary archive and index file formats.
+*/
+
+//Growable byte buffer, empty when zero-initialized
+typedef struct byteBuffer {
+    unsigned char*  data;
+    size_t          length;
+    size_t          capacity;
+} ByteBuffer;
+
+/** Function to append bytes to a buffer, growing it as needed.
+ *@post on success the bytes follow the buffer's previous contents
+ *@return true on success, false if memory ran out, leaving the buffer unchanged
+ *@param buffer - the buffer to append to
+         data - the bytes to append
+         len - the number of bytes
+ **/
+bool appendBuffer(ByteBuffer* buffer, const void* data, size_t len);
+
+/** Function to append an unsigned LEB128 varint to a buffer.
+ *@return true on success, false if memory ran out
+ *@param buffer - the buffer to append to
+         value - the value to encode
+ **/
+bool appendVarint(ByteBuffer* buffer, uint64_t value);
+
+/** Function to read an unsigned LEB128 varint.
+ *@post on success *pos points just past the varint
+ *@return true on success, false if the varint runs past end or is longer than 64 bits
+ *@param pos - the read position, advanced over the varint
+         end - the end of the readable bytes
+         value - set to the decoded value
+ **/
+bool readVarint(const unsigned char** pos, const unsigned char* end, uint64_t* value);
+
+/** Function to hash a byte string with 32-bit FNV-1a.
+ *@return the hash
+ *@param str - the bytes to hash
+         len - the number of bytes
+ **/
+uint32_t hashBytes(const char* str, size_t len);
+
+#endif
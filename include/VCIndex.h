@@ -0,0 +1,125 @@
+#ifndef _CARDINDEX_H
+#define _CARDINDEX_H
+
+#include <stdint.h>
+
+#include "VCParser.h"
+
+/*  Fields a term can be found in.  Each posting records a bit mask of these,
+    and search results are ranked by the most important field that matched.
+*/
+typedef enum fld {
+    FIELD_FN,       //FN and NICKNAME
+    FIELD_N,        //N
+    FIELD_ORG,      //ORG and TITLE
+    FIELD_EMAIL,    //EMAIL
+    FIELD_TEL,      //TEL, including digit-only fragments of the number
+    FIELD_NOTE,     //NOTE
+    FIELD_OTHER,    //Every other property
+    NUM_FIELDS
+} IndexField;
+
+//Inverted index over the contents of many cards.  The layout is private to VCIndex.c
+typedef struct cardIndex CardIndex;
+
+//One search hit
+typedef struct searchResult {
+    //File name the card was indexed under.  Owned by the result array
+    char*       fileName;
+
+    //Relevance, higher is better
+    double      score;
+
+    //Bit mask of (1 << IndexField) for the fields that matched
+    uint32_t    fields;
+
+} SearchResult;
+
+
+/** Function to create an empty index.
+ *@return the new index, or NULL if memory could not be allocated.  Release it with deleteCardIndex.
+ **/
+CardIndex* createCardIndex(void);
+
+/** Function to release an index and everything it holds.
+ *@param index - the index to release, may be NULL
+ **/
+void deleteCardIndex(CardIndex* index);
+
+/** Function to add a card to the index, replacing whatever was indexed under the same file name.
+ *  Values are split into tokens of letters, digits and non-ASCII characters, and ASCII letters
+ *  are case-folded.  Telephone numbers are also indexed as digit strings and their suffixes.
+ *  Replaced and removed cards are dropped from memory once they make up a quarter of the index,
+ *  so re-indexing the same files keeps the index at a size proportional to the live cards.
+ *@pre index and card are not NULL, card is a valid Card
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param index - the index to update
+         fileName - the name the card is found under in search results
+         card - the card to index
+ **/
+VCardErrorCode indexCard(CardIndex* index, const char* fileName, const Card* card);
+
+/** Function to remove a file from the index.  Does nothing if the file is not indexed.
+ *@param index - the index to update
+         fileName - the file to remove
+ **/
+void removeCardFromIndex(CardIndex* index, const char* fileName);
+
+/** Function to keep an index in step with every card file the library writes.
+ *  The index becomes the write hook (see setCardWriteHook): each file written by writeCard
+ *  is re-indexed from its card, and each file edited by updateCardProperty is read back and
+ *  re-indexed.  A file that cannot be read or indexed is removed from the index.  Files are
+ *  indexed under the names they were written with.  Only one index is attached at a time;
+ *  deleteCardIndex detaches it.
+ *@param index - the index to attach, or NULL to detach the current one
+ **/
+void attachCardIndex(CardIndex* index);
+
+/** Function to write a card with writeCard and, if that succeeds, re-index it.
+ *  Needed only for an index that is not attached, which writeCard does not update.
+ *@return the error from writeCard, or OTHER_ERROR if indexing failed
+ *@param index - the index to update
+         fileName - the file to write
+         card - the card to write
+ **/
+VCardErrorCode writeIndexedCard(CardIndex* index, const char* fileName, const Card* card);
+
+/** Function to search the index.
+ *  The query is tokenized like card values.  A card matches if every query token is a prefix of
+ *  one of its terms.  Results are ordered by score, then by file name.
+ *@post results points to a new array of count results that must be released with
+        deleteSearchResults.  It may be NULL if count is 0.
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param index - the index to search
+         query - the text to search for
+         maxResults - the maximum number of results, or 0 for no limit
+         results - receives the results
+         count - receives the number of results
+ **/
+VCardErrorCode searchCardIndex(CardIndex* index, const char* query, int maxResults, SearchResult** results, int* count);
+
+/** Function to release an array created by searchCardIndex.
+ *@param results - the array to release, may be NULL
+         count - the number of results in the array
+ **/
+void deleteSearchResults(SearchResult* results, int count);
+
+/** Function to save an index to a compact file.
+ *  Terms are front-coded and postings are delta-encoded varints.  Removed cards are dropped.
+ *@return OK on success, WRITE_ERROR if the file could not be written, OTHER_ERROR if the
+          arguments are invalid or memory could not be allocated
+ *@param index - the index to save
+         fileName - the file to write
+ **/
+VCardErrorCode saveCardIndex(CardIndex* index, const char* fileName);
+
+/** Function to load an index saved by saveCardIndex.
+ *@post On success index points to a new index that must be released with deleteCardIndex
+ *@return OK on success, INV_FILE if the file cannot be read or is not a valid index,
+          OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param fileName - the file to read
+         index - receives the loaded index
+ **/
+VCardErrorCode loadCardIndex(const char* fileName, CardIndex** index);
+
+#endif
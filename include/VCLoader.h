@@ -0,0 +1,65 @@
+#ifndef _CARDLOADER_H
+#define _CARDLOADER_H
+
+#include <stdint.h>
+
+#include "VCParser.h"
+
+//One .vcf or .vcf.gz file found by scanCardDirectory
+typedef struct cardFileEntry {
+    //File name within the directory, NUL-terminated
+    char        name[256];
+
+    //File size in bytes
+    int64_t     size;
+
+    //Last modification time, as seconds and nanoseconds since the epoch
+    int64_t     mtimeSec;
+    int32_t     mtimeNsec;
+
+} CardFileEntry;
+
+/*  Called once per input file, on the thread that called loadCards, in completion order.
+    card is NULL unless err is OK; the callback takes ownership of it and must release it
+    with deleteCard.
+*/
+typedef void (*CardLoadCallback)(int index, const char* fileName, VCardErrorCode err, Card* card, void* context);
+
+/** Function to read and parse many vCard files, overlapping file I/O with parsing.
+ *  A pool of reader threads opens and reads the files with pread while the calling thread
+ *  parses each completed buffer as soon as it is available.  At most a fixed number of read
+ *  buffers are in flight, so memory stays bounded however many files are loaded.
+ *@pre fileNames contains numFiles file names, callback is not NULL
+ *@post callback has been called exactly once for every file
+ *@return OK once every file has been delivered, OTHER_ERROR if the arguments are invalid or
+          the reader threads could not be started
+ *@param fileNames - array of file names
+         numFiles - number of entries in fileNames
+         numThreads - number of reader threads, or 0 to use the default
+         callback - called with each parsed card or error
+         context - passed through to callback
+ **/
+VCardErrorCode loadCards(char** fileNames, int numFiles, int numThreads, CardLoadCallback callback, void* context);
+
+/** Function to list the .vcf and .vcf.gz files of a directory with their sizes and modification times.
+ *  Reads the directory in large getdents64 batches and stats each match with statx relative
+ *  to the directory, so no path is resolved twice.  Only regular files (or links to them)
+ *  whose names end in ".vcf" or ".vcf.gz" are returned, in directory order.  The parser
+ *  decompresses gzip files as it reads them.
+ *@pre dirPath names a readable directory
+ *@post entries points to a new array of count entries that must be released with
+        deleteCardDirectory.  It may be NULL if count is 0.
+ *@return OK on success, INV_FILE if the directory cannot be read, OTHER_ERROR if the
+          arguments are invalid or memory could not be allocated
+ *@param dirPath - the directory to scan
+         entries - receives the array of entries
+         count - receives the number of entries
+ **/
+VCardErrorCode scanCardDirectory(const char* dirPath, CardFileEntry** entries, int* count);
+
+/** Function to release an array created by scanCardDirectory.
+ *@param entries - the array to release, may be NULL
+ **/
+void deleteCardDirectory(CardFileEntry* entries);
+
+#endif
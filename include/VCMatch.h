@@ -0,0 +1,41 @@
+#ifndef _CARDMATCH_H
+#define _CARDMATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "VCParser.h"
+
+/*  Hashing and equality of properties, shared by mergeCards and diffCards so that both agree
+    on when two properties are the same.  Names and groups compare without regard to ASCII
+    case; values compare exactly and in order.  Parameters are not looked at.
+*/
+
+/** Function to hash a property's name and group.
+ *@return the hash, which is equal for properties that samePropertyName finds the same
+ *@param prop - the property to hash
+ **/
+uint64_t hashPropertyName(const Property* prop);
+
+/** Function to hash a property's values onto the hash of its name and group.
+ *@return the hash, which is equal for properties that samePropertyContent finds the same
+ *@param prop - the property to hash
+         nameHash - the property's hash from hashPropertyName
+ **/
+uint64_t hashPropertyContent(const Property* prop, uint64_t nameHash);
+
+/** Function to check whether two properties have the same name and group.
+ *@return true if they do, false otherwise
+ *@param a - the first property
+         b - the second property
+ **/
+bool samePropertyName(const Property* a, const Property* b);
+
+/** Function to check whether two properties have the same name, group and values.
+ *@return true if they do, false otherwise
+ *@param a - the first property
+         b - the second property
+ **/
+bool samePropertyContent(const Property* a, const Property* b);
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _CARDMEDIA_H
+#define _CARDMEDIA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "VCParser.h"
+
+//How the binary data of a property is encoded in its value
+typedef enum mediaEncoding {MEDIA_BASE64, MEDIA_QUOTED_PRINTABLE} MediaEncoding;
+
+/*  Binary data embedded in a property such as PHOTO, LOGO or SOUND, found by findCardMedia.
+    The encoded text stays in the card and is decoded only as readCardMedia is called, so the
+    card must outlive the CardMedia and must not be changed while it is read.  The card itself
+    already holds every value as a string; to extract media from a large file without parsing
+    it into cards, use scanCardMedia.
+*/
+typedef struct cardMedia {
+    MediaEncoding   encoding;
+
+    //MIME type from the data: URI or the MEDIATYPE or TYPE parameter, or "" if none is given.
+    //Points into the card
+    const char*     mediaType;
+
+    //The encoded text inside the card and its length
+    const char*     data;
+    size_t          length;
+
+    //Most bytes the data can decode to, for sizing a buffer
+    size_t          maxSize;
+
+    //Set once readCardMedia has met text that is not validly encoded
+    bool            invalid;
+
+    //Read state, private to VCMedia.c
+    size_t          position;
+    unsigned char   pending[3];
+    int             numPending;
+    bool            finished;
+
+} CardMedia;
+
+
+/** Function to find the binary data embedded in a property.
+ *  Recognizes ENCODING=b or BASE64 values, ENCODING=QUOTED-PRINTABLE values and
+ *  data: URIs with ;base64.  Nothing is decoded or copied.  Quoted-printable data is taken
+ *  from the first value, as the parser splits values at semicolons.
+ *@pre prop is a valid Property
+ *@post On success media is ready to be read from the start
+ *@return true if prop holds encoded binary data, false otherwise
+ *@param prop - the property to look at
+         media - receives the location of the data
+ **/
+bool findCardMedia(const Property* prop, CardMedia* media);
+
+/** Function to decode the next part of a property's binary data.
+ *  Base64 is decoded four characters at a time through a lookup table, straight into buffer,
+ *  and whitespace in the encoded text is skipped.
+ *@pre media was filled by findCardMedia
+ *@post media has advanced past the bytes returned.  If the text is not validly encoded,
+        media->invalid is set and decoding stops.
+ *@return the number of bytes stored in buffer, 0 once all data has been read
+ *@param media - the data to read
+         buffer - receives the decoded bytes
+         size - the size of buffer
+ **/
+size_t readCardMedia(CardMedia* media, void* buffer, size_t size);
+
+/** Function to decode a property's binary data into a stream, a buffer at a time.
+ *@pre media was filled by findCardMedia
+ *@return OK on success, INV_PROP if the data is not validly encoded, WRITE_ERROR if an
+          argument is NULL or writing failed, OTHER_ERROR if memory could not be allocated
+ *@param media - the data to decode, read from its current position
+         fptr - the stream to write to, e.g. a file opened with "wb"
+ **/
+VCardErrorCode writeCardMedia(CardMedia* media, FILE* fptr);
+
+/*  One media property met by scanCardMedia.  The strings point into the scan's own buffers
+    and are only valid during the call that receives them.
+*/
+typedef struct cardMediaInfo {
+    //Index of the card in the file, counting BEGIN lines from 0, and of the media in the file
+    int             cardIndex;
+    int             mediaIndex;
+
+    //Property name without its group, e.g. "PHOTO"
+    const char*     name;
+
+    //MIME type from the data: URI or the MEDIATYPE or TYPE parameter, or "" if none is given
+    const char*     mediaType;
+
+    MediaEncoding   encoding;
+
+    //Set once the text has been found not to be validly encoded, after which nothing more of
+    //this property is decoded
+    bool            invalid;
+
+} CardMediaInfo;
+
+/** Function to decode every embedded media property of a vCard file straight from the file.
+ *  No Card is built and no value is held whole: the file is read and decoded 64 KiB at a
+ *  time, unfolding lines as it goes, so memory use stays constant however large the file and
+ *  its images are.  Properties are recognized as by findCardMedia, and quoted-printable soft
+ *  line breaks are followed.  The rest of the card is not checked, so malformed cards are
+ *  scanned rather than rejected.  Only plain text files are read, not gzip-compressed ones.
+ *@return OK once the whole file has been scanned, INV_FILE if fileName or sink is NULL or the
+          file cannot be read, WRITE_ERROR if sink returned false, OTHER_ERROR if memory could
+          not be allocated
+ *@param fileName - the file to scan
+         sink - called with each run of decoded bytes of a property, in order, and then once
+                with NULL and 0 at the end of the property.  Returning false stops the scan.
+         context - passed to every call of sink
+ **/
+VCardErrorCode scanCardMedia(const char* fileName, bool (*sink)(const CardMediaInfo* media, const void* bytes, size_t length, void* context),
+                             void* context);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _CARDMERGE_H
+#define _CARDMERGE_H
+
+#include <stddef.h>
+
+#include "VCParser.h"
+
+//How mergeCards chooses between inputs where the result can only hold one value
+typedef enum mpol {
+    //FN, single-instance properties and dates come from the earliest input that has them
+    MERGE_PREFER_FIRST,
+
+    //FN, single-instance properties and dates come from the latest input that has them
+    MERGE_PREFER_LAST,
+
+    //Dates come from the input with the most detail: date and time, then date, then time,
+    //then text.  Ties, FN and single-instance properties go to the earliest input
+    MERGE_PREFER_PRECISE
+} MergePolicy;
+
+
+/** Function to merge several cards that describe the same contact into a new card.
+ *  Properties are unioned.  Two properties are the same if their names and groups match
+ *  case-insensitively and their values match exactly; the parameters of repeats are added
+ *  to the first copy unless it already has them.  N, KIND, GENDER, UID, REV and PRODID are
+ *  kept at most once, and the FN field, BDAY and ANNIVERSARY are chosen by policy.  FN values
+ *  of the other inputs that differ from the chosen one become additional FN properties.
+ *  Each input property is hashed once, so the cost is linear in the size of the inputs.
+ *@pre inputs contains n valid Cards, n is at least 1
+ *@post out points to a new card that shares no memory with the inputs and must be released
+        with deleteCard
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param inputs - the cards to merge
+         n - number of entries in inputs
+         policy - how to choose between inputs for single values
+         out - receives the merged card
+ **/
+VCardErrorCode mergeCards(const Card** inputs, size_t n, MergePolicy policy, Card** out);
+
+#endif
@@ -8,7 +8,8 @@
 
 #include "LinkedListAPI.h"
 
-typedef enum ers {OK, INV_FILE, INV_CARD, INV_PROP, INV_DT, WRITE_ERROR, OTHER_ERROR } VCardErrorCode;
+//INV_ENCODING: the file is not valid UTF-8, and is not in a CHARSET that setCharsetNormalization converts
+typedef enum ers {OK, INV_FILE, INV_CARD, INV_PROP, INV_DT, WRITE_ERROR, OTHER_ERROR, INV_ENCODING } VCardErrorCode;
 
 /*  Represents vCard Date-time, needed for date-related properties, i.e. birthday and anniversary
     We assume that the type of date-related parameters is either unspecified or is "date-and-or-time"
@@ -99,7 +100,50 @@ typedef struct vCard {
 
 } Card;
 
+/*  Memory held by one Card, split into the structure that holds the data and the data itself.
+    Heap objects count at their allocated size, plus the allocator's per-block header in
+    overheadBytes.  Objects inside the block of a packed or cloned card count at their own size,
+    with the block's header and padding in overheadBytes.
+*/
+typedef struct cardMemStats {
+    //Structural: the Card, Property, Parameter and DateTime structs
+    size_t  objectBytes;
+
+    //Structural: List headers
+    size_t  listBytes;
+
+    //Structural: list Nodes
+    size_t  nodeBytes;
+
+    //Structural: per-block headers and, for packed cards, padding
+    size_t  overheadBytes;
+
+    //Payload: property, group and parameter names
+    size_t  nameBytes;
+
+    //Payload: property values and parameter values
+    size_t  valueBytes;
+
+    //Payload: the date, time and text strings of DateTimes
+    size_t  dateBytes;
+
+    //Separate allocations the card is made of
+    size_t  numBlocks;
+
+    //objectBytes + listBytes + nodeBytes + overheadBytes
+    size_t  structuralBytes;
+
+    //nameBytes + valueBytes + dateBytes
+    size_t  payloadBytes;
+
+    //structuralBytes + payloadBytes, the memory deleteCard would release
+    size_t  totalBytes;
+
+} CardMemStats;
+
 // ************* Card parser functions - MUST be implemented ***************
+//createCard and createCardInto also read gzip-compressed files, e.g. card.vcf.gz, decompressing
+//them in 64 KiB chunks as they are parsed.  zstd files are recognized and rejected with INV_FILE.
 VCardErrorCode createCard(char* fileName, Card** obj);
 void deleteCard(Card* obj);
 char* cardToString(const Card* obj);
@@ -107,6 +151,9 @@ char* errorToString(VCardErrorCode err);
 // *************************************************************************
 
 // ************* List helper functions - MUST be implemented *************** 
+//deleteCard and these delete functions release memory with vcFree (see VCAlloc.h).  Anything
+//added to a card must therefore come from vcMalloc, vcCalloc or vcRealloc, or from
+//createProperty and createParameter, never from malloc or strdup.
 void deleteProperty(void* toBeDeleted);
 int compareProperties(const void* first,const void* second);
 char* propertyToString(void* prop);
@@ -124,6 +171,97 @@ int compareDates(const void* first,const void* second);
 char* dateToString(void* date);
 // **************************************************************************
 
+// ************* Property construction functions ****************************
+
+/*  Properties and Parameters made by these functions, by the parser and by the other library
+    functions that build cards keep short names, groups and parameter values inside their own
+    allocation, and only put longer ones on the heap.  Such a string must not be freed or
+    reallocated on its own: use setPropertyStrings, or check it with isInlineString first.
+    deleteProperty and deleteParameter know the difference.
+*/
+
+/** Function to allocate a Property with room for short strings inside it.
+ *@post The property has copies of name and group and empty parameter and value lists.
+        It must be released with deleteProperty.
+ *@return the new property, or NULL if memory could not be allocated
+ *@param name - the property name; NULL is stored as ""
+         group - the group name; NULL is stored as ""
+ **/
+Property* createProperty(const char* name, const char* group);
+
+/** Function to allocate a Parameter with room for short strings inside it.
+ *@post The parameter has copies of name and value, or the shared copy of a vocabulary word.
+        It must be released with deleteParameter.
+ *@return the new parameter, or NULL if memory could not be allocated
+ *@param name - the parameter name; NULL is stored as ""
+         value - the parameter value; NULL is stored as ""
+ **/
+Parameter* createParameter(const char* name, const char* value);
+
+/** Function to replace the name and group of a Property.
+ *@pre prop was made by createProperty or the parser and is not part of a packed card.
+       name and group do not point into prop.
+ *@post The old strings are released.  On failure name and group are NULL.
+ *@return true on success, false if memory could not be allocated
+ *@param prop - the property to change
+         name - the new name; NULL is stored as ""
+         group - the new group; NULL is stored as ""
+ **/
+bool setPropertyStrings(Property* prop, const char* name, const char* group);
+
+/** Function to check whether a string is stored inside the Property or Parameter that holds it.
+ *@pre owner was made by createProperty, createParameter or the parser and is not part of a
+       packed card
+ *@return true if str lies inside owner's allocation, false otherwise or if either is NULL
+ *@param owner - the Property or Parameter
+         str - its name, group or value
+ **/
+bool isInlineString(const void* owner, const char* str);
+// **************************************************************************
+
+// ************* Parameter vocabulary functions *****************************
+
+/*  Common parameter names and values (TYPE, PREF, VALUE, ENCODING, WORK, HOME, CELL, VOICE,
+    INTERNET, pref and the like) are interned: createParameter and the parser point them at one
+    shared copy per spelling instead of storing them, so each has a fixed ID that can be found
+    from the pointer alone.  A comma list of such words, such as TYPE=work,voice, stays one
+    parameter and is shared as spelled, with the IDs of its non-empty items kept alongside, so
+    writeCard writes it back unchanged.  Interned strings must never be freed or changed;
+    deleteParameter knows to leave them.
+*/
+
+/** Function to find the ID of a word of the parameter vocabulary.
+ *@return the word's ID, the same for every spelling of it, or -1 if it is not in the vocabulary
+ *@param word - the word to look up, in any case
+ **/
+int paramVocabularyId(const char* word);
+
+/** Function to get the shared copy of a vocabulary word.
+ *  Only the upper case, lower case and capitalized spellings of a word are shared.
+ *@return the shared string, equal to str, or NULL if str is not a shared spelling
+ *@param str - the word to look up
+ **/
+const char* internParamString(const char* str);
+
+/** Function to check whether a parameter name or value is a shared vocabulary word or list.
+ *@return true if str is one of the shared strings, false otherwise
+ *@param str - the string to check
+ **/
+bool isInternedString(const char* str);
+
+/** Function to check whether a property has a parameter with the given value, such as
+ *  hasParamValue(prop, "TYPE", "WORK").  Names and values match without regard to case, and a
+ *  parameter value that is a comma-separated list matches any of its items.  Interned words and
+ *  lists are compared by ID; passing name and value from internParamString avoids string
+ *  compares entirely.
+ *@return true if a parameter matches, false otherwise or if any argument is NULL
+ *@param prop - the property to search
+         name - the parameter name
+         value - the value to find
+ **/
+bool hasParamValue(const Property* prop, const char* name, const char* value);
+// **************************************************************************
+
 // ************* Assignment 2 functions - MUST be implemented ***************
 
 /** Function to writing a Card object into a file in vCard format.
@@ -137,6 +275,49 @@ char* dateToString(void* date);
  **/
  VCardErrorCode writeCard(const char* fileName, const Card* obj);
 
+/** Function to write a Card in vCard format to an open stream, as writeCard does to a file.
+ *@pre fptr is open for writing
+ *@post The card's text has been written to fptr, which is left open and not flushed
+ *@return OK on success, WRITE_ERROR if an argument is NULL or a write failed
+ *@param fptr - the stream to write to
+         obj - the card to write
+ **/
+ VCardErrorCode writeCardToStream(FILE* fptr, const Card* obj);
+
+/*  Hook told of every card file the library writes, so that something derived from the files,
+    such as a CardIndex, can keep in step.  writeCard calls it with the card it wrote, and
+    updateCardProperty with NULL, as it edits the file without building a Card.  Calls are
+    serialized by a lock, so the hook must not write cards itself.
+*/
+typedef void (*CardWriteHook)(const char* fileName, const Card* obj, void* context);
+
+/** Function to set the hook told of every card file written, replacing any earlier one.
+ *@param hook - the hook, or NULL for none
+         context - passed to every call of hook
+ **/
+void setCardWriteHook(CardWriteHook hook, void* context);
+
+/** Function to tell the write hook, if there is one, that a card file has been written.
+ *  writeCard and updateCardProperty call it; other code that writes card files may too.
+ *@param fileName - the file written
+         obj - the card written, or NULL if the file changed without a Card being built
+ **/
+void notifyCardWritten(const char* fileName, const Card* obj);
+
+//Octets in a content line, the CRLF excluded, after which writeCard folds it
+#define VCARD_FOLD_OCTETS 75
+
+/** Function to find how much of a content line fits before its next fold.
+ *  Folds never split a UTF-8 sequence, except in invalid UTF-8 that has no sequence boundary
+ *  in a whole line.  Every writer of content lines uses this, so all of them fold alike.
+ *@return the number of octets of text to write before folding, which is length if it all fits
+          and may be 0 if the current line has no room left
+ *@param text - the rest of the content line
+         length - the number of octets in text
+         column - the octets already on the current line; 1 after a fold, for its space
+ **/
+ size_t foldOffset(const char* text, size_t length, size_t column);
+
 
  /** Function to writing a Card object into a file in vCard format.
   *@pre Card object exists, and is not NULL.
@@ -147,4 +328,119 @@ char* dateToString(void* date);
   **/
  VCardErrorCode validateCard(const Card* obj);
 
+
+// ************* Card reuse functions ***************************************
+
+/** Function to allocate a Card with no properties, for use with createCardInto.
+ *@post The card has fn, birthday and anniversary set to NULL and an empty optionalProperties list.
+        It must be released with deleteCard.
+ *@return the new card, or NULL if memory could not be allocated
+ **/
+Card* createEmptyCard(void);
+
+/** Function to allocate a Card together with storage for its contents, in one allocation.
+ *  The caller builds the card's properties, lists, nodes, dates and strings inside storage,
+ *  with parameter and value lists from initializePackedList.  deleteCard releases the whole
+ *  block with a single free, and it and resetCard free individually only objects added later
+ *  from outside the block.  The card's lists are BlockLists, so clearList, freeList and
+ *  deleteDataFromList are safe on them, but objects inside the block must not be passed to
+ *  deleteProperty, deleteParameter or deleteValue directly.
+ *@post The card has fn, birthday and anniversary set to NULL and an empty optionalProperties
+        list, which also lives in the block.  storage points to size bytes aligned for any type.
+ *@return the new card, or NULL if memory could not be allocated
+ *@param size - the number of bytes of storage needed
+         storage - receives the storage
+ **/
+Card* createPackedCard(size_t size, void** storage);
+
+/** Function to set up a parameter or value list inside the storage of a packed card.
+ *  Clearing or freeing the list later frees only the nodes, parameters and strings that
+ *  were added to it from outside the block.
+ *@pre card came from createPackedCard and list lies in its storage
+ *@return list as an empty List, or NULL if list is not inside card's block
+ *@param card - the packed card
+         list - storage for the list
+         parameters - true for a list of Parameters, false for a list of value strings
+ **/
+List* initializePackedList(const Card* card, BlockList* list, bool parameters);
+
+/** Function to make a deep copy of a Card in a single allocation.
+ *  The size of every property, parameter, value and date is added up first, then the copy is
+ *  built inside one block from createPackedCard, with all of its pointers into that block.
+ *  NULL strings in the original become empty strings and missing lists become empty lists.
+ *@pre obj is a Card, which may itself be a clone
+ *@post The copy shares nothing with obj and must be released with deleteCard.  The same
+        restrictions as for createPackedCard apply to it.
+ *@return the copy, or NULL if obj is NULL or memory could not be allocated
+ *@param obj - the card to copy
+ **/
+Card* cloneCard(const Card* obj);
+
+/** Function to measure the memory a Card holds, by category.
+ *  Every object the card owns is visited once, so the cost is linear in its size.
+ *@pre obj is NULL or a Card built by this library
+ *@post stats holds the card's footprint; all zero if obj is NULL
+ *@param obj - the card to measure
+         stats - receives the totals
+ **/
+void cardMemoryUsage(const Card* obj, CardMemStats* stats);
+
+/** Function to parse a vCard file into an existing Card, reusing its storage.
+ *  Properties, list nodes and DateTime structs released by the card are kept by the calling
+ *  thread and reused, so a loop of createCardInto calls on one card settles at a small,
+ *  constant number of allocations per card.
+ *@pre obj was created by createCard or createEmptyCard
+ *@post On success obj holds the parsed card.  On failure obj is left empty, as after resetCard.
+ *@return the same error codes as createCard
+ *@param fileName - the name of the file to parse
+         obj - the card to parse into
+ **/
+VCardErrorCode createCardInto(const char* fileName, Card* obj);
+
+/** Function to parse a vCard file that has already been read into memory.
+ *  As with createCard, gzip-compressed input is recognized by its magic bytes and
+ *  decompressed in small chunks as it is parsed.
+ *@pre buffer holds length bytes of the file; it does not need to be NUL-terminated
+ *@post Same as createCard.  The buffer is not modified and may be freed afterwards.
+ *@return the same error codes as createCard
+ *@param buffer - the file contents
+         length - the number of bytes in buffer
+         obj - receives the new card
+ **/
+VCardErrorCode createCardFromBuffer(const char* buffer, size_t length, Card** obj);
+
+/** Function to parse an in-memory vCard file into an existing Card, reusing its storage.
+ *@pre obj was created by createCard or createEmptyCard
+ *@post Same as createCardInto
+ *@return the same error codes as createCard
+ *@param buffer - the file contents
+         length - the number of bytes in buffer
+         obj - the card to parse into
+ **/
+VCardErrorCode createCardIntoFromBuffer(const char* buffer, size_t length, Card* obj);
+
+/** Function to empty a Card without freeing it.
+ *  Its properties, nodes and dates are kept by the calling thread for reuse by createCardInto.
+ *@post obj has fn, birthday and anniversary set to NULL and an empty optionalProperties list
+ *@param obj - the card to empty, may be NULL
+ **/
+void resetCard(Card* obj);
+
+/** Function to free the objects the calling thread keeps for reuse.
+ *  Only createCardInto, createCardIntoFromBuffer and resetCard keep objects, and they count
+ *  towards the thread's bytesInUse and memory limit until freed.  They are freed when the
+ *  thread exits; a long-lived thread that is done reusing cards can call this to free them sooner.
+ **/
+void clearCardPool(void);
+
+/** Function to choose how createCard and its variants treat content lines with a legacy
+ *  CHARSET parameter.  Every line is otherwise checked to be valid UTF-8, and a card with any
+ *  invalid line fails with INV_ENCODING.
+ *  When enabled, lines declaring CHARSET=ISO-8859-1 (or LATIN1) or WINDOWS-1252 (or CP1252)
+ *  are converted to UTF-8 before parsing, and the CHARSET parameter is dropped from every
+ *  property.  It is off by default and applies to every thread.
+ *@param enabled - whether to convert legacy charsets
+ **/
+void setCharsetNormalization(bool enabled);
+
 #endif  
@@ -0,0 +1,25 @@
+#ifndef _CARDPATCH_H
+#define _CARDPATCH_H
+
+#include "VCParser.h"
+
+/** Function to replace the value of one property directly in a vCard file.
+ *  The file is scanned for the first content line with the given name, without building a
+ *  Card.  That line is rebuilt from its unfolded group, name and parameters followed by the
+ *  new value, folded at 75 octets without splitting UTF-8 sequences, and spliced between the
+ *  untouched bytes before and after it.  The result is written to a temporary file in the
+ *  same directory, synced and renamed over the original, so readers see either the old or
+ *  the new file.  A gzip-compressed file, such as card.vcf.gz, is decompressed in memory,
+ *  edited the same way and written back compressed as a single gzip member.
+ *@pre newValue is the property's value as it should appear in the file, with any ';' or ','
+       separators already in place
+ *@return OK on success, INV_FILE if the file cannot be read or is not valid gzip data, INV_PROP if the property is not
+          in the file or propName or newValue is empty, contains a line break, or names
+          BEGIN, VERSION or END, WRITE_ERROR if the new file could not be written
+ *@param fileName - the file to edit
+         propName - the property to change, matched case-insensitively and ignoring any group
+         newValue - the new value
+ **/
+VCardErrorCode updateCardProperty(const char* fileName, const char* propName, const char* newValue);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef _CARDSTATS_H
+#define _CARDSTATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Timed phases of the library's work
+typedef enum parserPhase {
+    PHASE_READ,         //Opening a file or buffer and checking its BEGIN, VERSION, FN and END lines
+    PHASE_UNFOLD,       //Reading and unfolding the content lines
+    PHASE_TOKENIZE,     //Parsing content lines into properties, which includes PHASE_DATETIME
+    PHASE_DATETIME,     //Parsing BDAY and ANNIVERSARY values
+    PHASE_VALIDATE,     //validateCard
+    PHASE_WRITE,        //writeCard
+    PHASE_TO_STRING,    //cardToString
+    NUM_PHASES
+} ParserPhase;
+
+//Time spent in one phase
+typedef struct phaseStats {
+    //Number of times the phase ran
+    uint64_t    calls;
+
+    //Total monotonic clock time spent in it
+    uint64_t    nanoseconds;
+
+} PhaseStats;
+
+//Counters of one thread, gathered while statistics are enabled
+typedef struct parserStats {
+    PhaseStats  phases[NUM_PHASES];
+
+    //Bytes of vCard text parsed by createCard and its variants, and written by writeCard
+    uint64_t    bytesRead;
+    uint64_t    bytesWritten;
+
+    //Calls that allocated, resized or freed memory in the parser, helper and list code
+    uint64_t    allocations;
+    uint64_t    reallocations;
+    uint64_t    frees;
+
+} ParserStats;
+
+
+/** Function to turn statistics gathering on or off for every thread.
+ *  It is off by default, which costs one flag check per phase and allocation.
+ *@param enabled - whether to gather statistics
+ **/
+void setParserStatsEnabled(bool enabled);
+
+/** Function to read the statistics the calling thread has gathered since it started or last
+ *  called resetParserStats.
+ *@param stats - receives a copy of the counters
+ **/
+void getParserStats(ParserStats* stats);
+
+/** Function to zero the calling thread's statistics.
+ **/
+void resetParserStats(void);
+
+
+// ************* Used inside the library to record statistics ***************
+
+/** Function to start timing a phase.
+ *@return the start time to pass to endParserPhase, or 0 if statistics are disabled
+ **/
+uint64_t startParserPhase(void);
+
+/** Function to finish timing a phase.
+ *@param phase - the phase that ran
+         start - the value returned by startParserPhase; nothing is recorded if it is 0
+ **/
+void endParserPhase(ParserPhase phase, uint64_t start);
+
+/** Function to count bytes of vCard text read or written, if statistics are enabled.
+ *@param read - bytes read
+         written - bytes written
+ **/
+void addParserBytes(uint64_t read, uint64_t written);
+
+/** Function to count calls to the library's memory functions, if statistics are enabled.
+ *@param allocations - new blocks
+         reallocations - resized blocks
+         frees - released blocks
+ **/
+void addParserAllocations(uint64_t allocations, uint64_t reallocations, uint64_t frees);
+
+#endif
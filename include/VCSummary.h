@@ -0,0 +1,85 @@
+#ifndef _CARDSUMMARY_H
+#define _CARDSUMMARY_H
+
+#include <stdint.h>
+
+#include "VCParser.h"
+
+//Bit flags stored in CardSummary.flags
+#define SUMMARY_HAS_BIRTHDAY        0x01
+#define SUMMARY_BIRTHDAY_UTC        0x02
+#define SUMMARY_BIRTHDAY_TEXT       0x04
+#define SUMMARY_HAS_ANNIVERSARY     0x08
+#define SUMMARY_ANNIVERSARY_UTC     0x10
+#define SUMMARY_ANNIVERSARY_TEXT    0x20
+
+/*  Flat, fixed-layout record describing one card of a summary batch.
+    Every string field is a byte offset into the batch string blob, where the string is
+    NUL-terminated.  Offset 0 always holds the empty string, so absent fields are 0.
+*/
+typedef struct cardSummary {
+    //Error code from createCard, or from validateCard if the card was parsed successfully
+    int32_t     status;
+
+    //Number of properties in the card's optionalProperties list
+    int32_t     numOptionalProperties;
+
+    //Combination of the SUMMARY_* flags
+    uint32_t    flags;
+
+    //File name exactly as it was passed in
+    uint32_t    fileName;
+
+    //First value of the FN property
+    uint32_t    fn;
+
+    //Birthday fields, see DateTime
+    uint32_t    birthdayDate;
+    uint32_t    birthdayTime;
+    uint32_t    birthdayText;
+
+    //Anniversary fields, see DateTime
+    uint32_t    anniversaryDate;
+    uint32_t    anniversaryTime;
+    uint32_t    anniversaryText;
+
+} CardSummary;
+
+
+/*  A batch of card summaries.  The struct, the records array and the string blob live
+    in a single allocation, so the whole batch can be read with one buffer view.
+*/
+typedef struct summaryBatch {
+    //Number of records, equal to the number of files passed in
+    uint32_t        count;
+
+    //Total length of the string blob in bytes, including all terminators
+    uint32_t        stringsLength;
+
+    //Records, one per input file, in input order
+    CardSummary*    records;
+
+    //String blob referenced by the record offsets
+    char*           strings;
+
+} CardSummaryBatch;
+
+
+/** Function to parse and validate a set of vCard files into a flat summary batch.
+ *@pre fileNames contains numFiles non-NULL file names
+ *@post obj points to a newly allocated batch that must be released with deleteCardSummaries.
+        A file that fails to parse or validate still gets a record, with its error in status.
+ *@return OK on success, OTHER_ERROR if the arguments are invalid, memory could not be allocated
+         or the strings of the batch would pass 4 GiB
+ *@param fileNames - array of file names
+         numFiles - number of entries in fileNames
+         obj - receives the new batch
+ **/
+VCardErrorCode createCardSummaries(char** fileNames, int numFiles, CardSummaryBatch** obj);
+
+/** Function to release a batch created by createCardSummaries.
+ *@param obj - the batch to release, may be NULL
+ **/
+void deleteCardSummaries(CardSummaryBatch* obj);
+
+#endif
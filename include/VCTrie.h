@@ -0,0 +1,73 @@
+#ifndef _CARDTRIE_H
+#define _CARDTRIE_H
+
+#include "VCParser.h"
+
+/*  Radix tree over the names of many cards, for type-ahead lookup.
+    Keys are the whole FN value and each word of FN and N, case-folded, with runs of
+    separators collapsed to one space.  The layout is private to VCTrie.c.
+*/
+typedef struct cardTrie CardTrie;
+
+
+/** Function to create an empty trie.
+ *@return the new trie, or NULL if memory could not be allocated.  Release it with deleteCardTrie.
+ **/
+CardTrie* createCardTrie(void);
+
+/** Function to release a trie and everything it holds.
+ *@param trie - the trie to release, may be NULL
+ **/
+void deleteCardTrie(CardTrie* trie);
+
+/** Function to add the names of a card to a trie.
+ *  The card is not visible to lookupCardPrefix until buildCardTrie is called.
+ *@pre trie and card are not NULL, card is a valid Card
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param trie - the trie to add to
+         fileName - the name returned for the card by lookupCardPrefix
+         card - the card whose names are added
+ **/
+VCardErrorCode addCardToTrie(CardTrie* trie, const char* fileName, const Card* card);
+
+/** Function to (re)build the lookup structure from every card added so far.
+ *  Nodes are laid out breadth-first in one array with the children of each node adjacent,
+ *  and each node covers a contiguous range of one shared array of card ids.
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param trie - the trie to build
+ **/
+VCardErrorCode buildCardTrie(CardTrie* trie);
+
+/** Function to parse a set of files and build a trie over the ones that parse.
+ *@post On success trie points to a new, built trie that must be released with deleteCardTrie
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param fileNames - array of file names
+         numFiles - number of entries in fileNames
+         trie - receives the trie
+ **/
+VCardErrorCode createCardTrieFromFiles(char** fileNames, int numFiles, CardTrie** trie);
+
+/** Function to build a trie over names that were read without parsing the cards again, such as
+ *  the FN values of a summary batch.  Each name is added like an FN value: whole and word by word.
+ *@post On success trie points to a new, built trie that must be released with deleteCardTrie
+ *@return OK on success, OTHER_ERROR if the arguments are invalid or memory could not be allocated
+ *@param fileNames - array of file names, returned by lookupCardPrefix
+         names - the name of each file
+         numNames - number of entries in fileNames and names
+         trie - receives the trie
+ **/
+VCardErrorCode createCardTrieFromNames(char** fileNames, char** names, int numNames, CardTrie** trie);
+
+/** Function to find the cards with a name that starts with a prefix.
+ *  The prefix is folded like the keys.  Cards are returned in the order of their first
+ *  matching key, each at most once.  Lookups do not modify the trie, so any number may run
+ *  at once as long as no card is being added or built.
+ *@return the number of file names stored in fileNames
+ *@param trie - a built trie
+         prefix - the text typed so far
+         fileNames - receives up to maxResults file names, owned by the trie
+         maxResults - the size of fileNames
+ **/
+int lookupCardPrefix(const CardTrie* trie, const char* prefix, const char** fileNames, int maxResults);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _CARDWRITER_H
+#define _CARDWRITER_H
+
+#include <stdbool.h>
+
+#include "VCParser.h"
+
+/*  Output file that cards are appended to one after another, opened with openVCardWriter.
+    The file is written through one large buffer and, if requested, gzip-compressed.  The
+    layout is private to VCWriter.c
+*/
+typedef struct vCardWriter VCardWriter;
+
+
+/** Function to create a file that many cards can be written to in turn.
+ *  An existing file is truncated.  Nothing is guaranteed to be on disk until closeVCardWriter.
+ *@post On success writer points to an open writer that must be released with closeVCardWriter
+ *@return OK on success, WRITE_ERROR if the file could not be created, OTHER_ERROR if the
+          arguments are invalid or memory could not be allocated
+ *@param fileName - the file to create
+         compress - whether to gzip the output, for files such as backup.vcf.gz
+         writer - receives the open writer
+ **/
+VCardErrorCode openVCardWriter(const char* fileName, bool compress, VCardWriter** writer);
+
+/** Function to append a card to a writer's file, in the same format as writeCard.
+ *  Each call is timed as PHASE_WRITE.  After a failed write every later call fails too.
+ *@pre obj is a valid Card
+ *@return OK on success, WRITE_ERROR if an argument is NULL or writing failed
+ *@param writer - the writer to append to
+         obj - the card to write
+ **/
+VCardErrorCode appendCard(VCardWriter* writer, const Card* obj);
+
+/** Function to get the number of cards a writer has written.
+ *@return the number of successful appendCard calls, or 0 if writer is NULL
+ *@param writer - the writer
+ **/
+int vcardWriterCount(const VCardWriter* writer);
+
+/** Function to finish a writer's file and release the writer.
+ *  Buffered and compressed data is flushed, then the file is synced to disk once.
+ *@return OK if every card was written and the file reached the disk, WRITE_ERROR otherwise
+ *@param writer - the writer to close, may be NULL
+ **/
+VCardErrorCode closeVCardWriter(VCardWriter* writer);
+
+#endif
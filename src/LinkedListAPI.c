@@ -1,4 +1,7 @@
+#include <stdint.h>
+
 #include "LinkedListAPI.h"
+#include "VCAlloc.h"
 #include "assert.h"
 
 /** Function to initialize the list metadata head to the appropriate function pointers. Allocates memory to the struct.
@@ -13,7 +16,7 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
     assert(deleteFunction != NULL);
     assert(compareFunction != NULL);
 
-    List * tmpList = malloc(sizeof(List));
+    List * tmpList = vcMalloc(sizeof(List));
 	
 	tmpList->head = NULL;
 	tmpList->tail = NULL;
@@ -28,6 +31,42 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 }
 
 
+/** Function to initialize a list inside a larger allocation, whose nodes and data there are never freed on their own.
+*@return pointer to the list head
+**/
+List* initializeBlockList(BlockList* list, const void* blockStart, size_t blockSize, char* (*printFunction)(void* toBePrinted),
+                          void (*deleteItem)(const BlockList* list, void* toBeDeleted), int (*compareFunction)(const void* first,const void* second)){
+
+    list->list = (List){NULL, NULL, 0, keepBlockData, compareFunction, printFunction};
+    list->blockStart = blockStart;
+    list->blockSize = blockSize;
+    list->deleteItem = deleteItem;
+
+    return &list->list;
+}
+
+/** deleteData of a BlockList, which marks it and frees nothing itself
+**/
+void keepBlockData(void* toBeDeleted){
+    (void)toBeDeleted;
+}
+
+/** Checks whether a pointer lies inside the block of a BlockList
+**/
+bool inListBlock(const BlockList* list, const void* ptr){
+
+    return (uintptr_t)ptr >= (uintptr_t)list->blockStart && (uintptr_t)ptr < (uintptr_t)list->blockStart + list->blockSize;
+}
+
+/** Frees a node unless it lies in the block of a BlockList
+**/
+static void freeNode(List* list, Node* node){
+
+    if (list->deleteData != keepBlockData || !inListBlock((BlockList*)list, node)){
+        vcFree(node);
+    }
+}
+
 /** Deletes the entire linked list, freeing all memory.
 * uses the supplied function pointer to release allocated memory for the data
 *@pre 'List' type must exist and be used in order to keep track of the linked list.
@@ -37,7 +76,11 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 void freeList(List* list){	
 
     clearList(list);
-	free(list);
+
+	//The header of a BlockList lies in its block
+	if (list != NULL && list->deleteData != keepBlockData){
+		vcFree(list);
+	}
 }
 
 /** Clears the list: frees the contents of the list - Node structs and data stored in them - 
@@ -60,10 +103,14 @@ void clearList(List* list){
 	Node* tmp;
 	
 	while (list->head != NULL){
-		list->deleteData(list->head->data);
+		if (list->deleteData == keepBlockData){
+			((BlockList*)list)->deleteItem((BlockList*)list, list->head->data);
+		}else{
+			list->deleteData(list->head->data);
+		}
 		tmp = list->head;
 		list->head = list->head->next;
-		free(tmp);
+		freeNode(list, tmp);
 	}
 	
 	list->head = NULL;
@@ -81,7 +128,7 @@ void clearList(List* list){
 * @param data - is a void * pointer to any data type.  Data must be allocated on the heap.
 **/
 Node* initializeNode(void* data){
-	Node* tmpNode = (Node*)malloc(sizeof(Node));
+	Node* tmpNode = (Node*)vcMalloc(sizeof(Node));
 	
 	if (tmpNode == NULL){
 		return NULL;
@@ -195,7 +242,7 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 			}
 			
 			void* data = delNode->data;
-			free(delNode);
+			freeNode(list, delNode);
 			
 			(list->length)--;
 
@@ -244,14 +291,6 @@ void insertSorted(List *list, void *toBeAdded){
 	while (currNode != NULL){
 		if (list->compare(toBeAdded, currNode->data) <= 0){
 		
-			char* currDescr = list->printData(currNode->data); 
-			char* newDescr = list->printData(toBeAdded); 
-		
-			//printf("Inserting %s before %s\n", newDescr, currDescr);
-
-			free(currDescr);
-			free(newDescr);
-		
 			Node* newNode = initializeNode(toBeAdded);
 			newNode->next = currNode;
 			newNode->previous = currNode->previous;
@@ -268,6 +307,86 @@ void insertSorted(List *list, void *toBeAdded){
 	return;
 }
 
+/** Sorts the list in place using the comparison function pointer.
+* Uses a bottom-up merge sort over the node links, so it runs in O(n log n) time,
+* allocates nothing and is stable: nodes that compare equal keep their relative order.
+*@pre List exists and has memory allocated to it.
+*@post The nodes are relinked in ascending order; head, tail and length are correct.
+*@param list a pointer to the dummy head of the list
+**/
+void sortList(List* list){
+	if (list == NULL || list->head == NULL || list->compare == NULL){
+		return;
+	}
+
+	Node* head = list->head;
+	int runSize = 1;
+
+	while (true){
+		Node* left = head;
+		Node* tail = NULL;
+		int merges = 0;
+
+		head = NULL;
+
+		//Merges adjacent pairs of runs of length runSize
+		while (left != NULL){
+			Node* right = left;
+			int leftSize = 0;
+
+			merges++;
+
+			//Finds the start of the right run
+			for (int i = 0; i < runSize && right != NULL; i++){
+				leftSize++;
+				right = right->next;
+			}
+
+			int rightSize = runSize;
+
+			//Takes the smaller head of the two runs until both are exhausted
+			while (leftSize > 0 || (rightSize > 0 && right != NULL)){
+				Node* next;
+
+				if (leftSize == 0){
+					next = right;
+					right = right->next;
+					rightSize--;
+				}else if (rightSize == 0 || right == NULL || list->compare(left->data, right->data) <= 0){
+					next = left;
+					left = left->next;
+					leftSize--;
+				}else{
+					next = right;
+					right = right->next;
+					rightSize--;
+				}
+
+				next->previous = tail;
+				if (tail != NULL){
+					tail->next = next;
+				}else{
+					head = next;
+				}
+				tail = next;
+			}
+
+			left = right;
+		}
+
+		tail->next = NULL;
+
+		//A single merge means the whole list is one sorted run
+		if (merges <= 1){
+			list->head = head;
+			list->tail = tail;
+			return;
+		}
+
+		runSize *= 2;
+	}
+}
+
 /**Returns a string that contains a string representation of the list traversed from  head to tail. 
 Utilize an iterator and the list's printData function pointer to create the string.
 returned string must be freed by the calling function.
@@ -0,0 +1,224 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "VCAlloc.h"
+#include "VCStats.h"
+
+//Placed before every block, recording its size and owner while keeping it aligned for any type
+typedef struct allocHeader {
+    _Alignas(max_align_t) size_t    size;
+    const VCardAllocator*           allocator;
+} AllocHeader;
+
+//malloc, adapted to the allocator interface
+static void* systemAllocate(size_t size, void* context) {
+    (void)context;
+    return malloc(size);
+}
+
+//realloc, adapted to the allocator interface
+static void* systemReallocate(void* ptr, size_t size, void* context) {
+    (void)context;
+    return realloc(ptr, size);
+}
+
+//free, adapted to the allocator interface
+static void systemRelease(void* ptr, void* context) {
+    (void)context;
+    free(ptr);
+}
+
+//Allocator used until setVCardAllocator is called
+static const VCardAllocator systemAllocator = {systemAllocate, systemReallocate, systemRelease, NULL};
+
+//Allocator for new blocks
+static _Atomic(const VCardAllocator*) currentAllocator = &systemAllocator;
+
+//Memory accounting and limit of the calling thread
+static _Thread_local VCardHeapStats heapStats;
+static _Thread_local size_t memoryLimit;
+
+//Sets the allocator for new blocks
+void setVCardAllocator(const VCardAllocator* allocator) {
+
+    if (allocator != NULL && (allocator->allocate == NULL || allocator->release == NULL)) {
+        return;
+    }
+
+    atomic_store(&currentAllocator, allocator != NULL ? allocator : &systemAllocator);
+}
+
+//Sets the calling thread's memory limit
+void setVCardMemoryLimit(size_t limit) {
+
+    memoryLimit = limit;
+}
+
+//Copies the calling thread's accounting
+void getVCardHeapStats(VCardHeapStats* stats) {
+
+    if (stats != NULL) {
+        *stats = heapStats;
+    }
+}
+
+//Restarts peak tracking
+void resetVCardHeapPeak(void) {
+
+    heapStats.peakBytes = heapStats.bytesInUse;
+}
+
+//Checks whether the thread may take bytes more, counting a failure if not
+static bool reserveBytes(size_t bytes) {
+
+    if (memoryLimit != 0 && (heapStats.bytesInUse < 0 ? 0 : (uint64_t)heapStats.bytesInUse) + bytes > memoryLimit) {
+        heapStats.failedAllocations++;
+        return false;
+    }
+
+    return true;
+}
+
+//Adds to the bytes in use and the peak
+static void accountBytes(int64_t delta) {
+
+    heapStats.bytesInUse += delta;
+
+    if (heapStats.bytesInUse > heapStats.peakBytes) {
+        heapStats.peakBytes = heapStats.bytesInUse;
+    }
+}
+
+//Allocates a block with a header from the current allocator
+void* vcMalloc(size_t size) {
+
+    if (size > SIZE_MAX - sizeof(AllocHeader) || !reserveBytes(size + sizeof(AllocHeader))) {
+        return NULL;
+    }
+
+    const VCardAllocator* allocator = atomic_load(&currentAllocator);
+    AllocHeader* header = allocator->allocate(size + sizeof(AllocHeader), allocator->context);
+
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->size = size;
+    header->allocator = allocator;
+
+    accountBytes((int64_t)(size + sizeof(AllocHeader)));
+    addParserAllocations(1, 0, 0);
+
+    return header + 1;
+}
+
+//Allocates a zeroed block
+void* vcCalloc(size_t count, size_t size) {
+
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* ptr = vcMalloc(count * size);
+
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+//Resizes a block with the allocator that created it
+void* vcRealloc(void* ptr, size_t size) {
+
+    if (ptr == NULL) {
+        return vcMalloc(size);
+    }
+
+    if (size == 0) {
+        vcFree(ptr);
+        return NULL;
+    }
+
+    AllocHeader* header = (AllocHeader*)ptr - 1;
+    const VCardAllocator* allocator = header->allocator;
+    size_t oldSize = header->size;
+
+    if (size > SIZE_MAX - sizeof(AllocHeader) || (size > oldSize && !reserveBytes(size - oldSize))) {
+        return NULL;
+    }
+
+    AllocHeader* newHeader;
+
+    if (allocator->reallocate != NULL) {
+        newHeader = allocator->reallocate(header, size + sizeof(AllocHeader), allocator->context);
+    }
+    else {
+        newHeader = allocator->allocate(size + sizeof(AllocHeader), allocator->context);
+
+        if (newHeader != NULL) {
+            memcpy(newHeader + 1, ptr, oldSize < size ? oldSize : size);
+            allocator->release(header, allocator->context);
+        }
+    }
+
+    if (newHeader == NULL) {
+        return NULL;
+    }
+
+    newHeader->size = size;
+    newHeader->allocator = allocator;
+
+    accountBytes((int64_t)size - (int64_t)oldSize);
+    addParserAllocations(0, 1, 0);
+
+    return newHeader + 1;
+}
+
+//Releases a block to the allocator that created it
+void vcFree(void* ptr) {
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    AllocHeader* header = (AllocHeader*)ptr - 1;
+    const VCardAllocator* allocator = header->allocator;
+
+    accountBytes(-(int64_t)(header->size + sizeof(AllocHeader)));
+    addParserAllocations(0, 0, 1);
+
+    allocator->release(header, allocator->context);
+}
+
+//Returns the requested size of a block
+size_t vcAllocatedSize(const void* ptr) {
+
+    return ptr != NULL ? ((const AllocHeader*)ptr - 1)->size : 0;
+}
+
+//Returns the size of the per-block header
+size_t vcHeaderSize(void) {
+
+    return sizeof(AllocHeader);
+}
+
+//zlib's allocation hook
+void* vcZlibAlloc(void* opaque, unsigned int items, unsigned int size) {
+
+    (void)opaque;
+
+    if (size != 0 && items > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    return vcMalloc((size_t)items * size);
+}
+
+//zlib's release hook
+void vcZlibFree(void* opaque, void* address) {
+
+    (void)opaque;
+    vcFree(address);
+}
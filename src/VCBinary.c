@@ -0,0 +1,1059 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCEncode.h"
+#include "VCLoader.h"
+#include "VCBinary.h"
+
+//File format identification
+#define BINARY_MAGIC "VCBA"
+#define BINARY_VERSION 1
+
+/*  Fixed header at the start of every file, all integers little-endian:
+        0   magic
+        4   u32 version
+        8   u32 number of cards
+        12  u32 number of names
+        16  u64 offset of the name table
+        24  u64 offset of the directory, one u64 record offset per card
+        32  u64 file size
+    Card records follow the header, then the name table, then the directory.
+*/
+#define HEADER_SIZE 40
+
+//Card record flags
+#define HAS_FN 0x01
+#define HAS_BIRTHDAY 0x02
+#define HAS_ANNIVERSARY 0x04
+
+//DateTime record flags
+#define DATE_UTC 0x01
+#define DATE_TEXT 0x02
+#define DATE_PACKED 0x04
+#define TIME_PACKED 0x08
+
+//Alignment of the structs carved from a loaded card's storage, which hold only pointers and smaller fields
+#define STRUCT_ALIGN sizeof(void*)
+
+//State of a file being written
+typedef struct binaryWriter {
+    FILE*       fptr;
+
+    //Bytes written so far
+    uint64_t    offset;
+
+    //Record of the card being encoded
+    ByteBuffer  record;
+
+    //Name table in file format, without its leading count
+    ByteBuffer  names;
+
+    //Offset in names of the text of each interned name
+    uint32_t*   nameStarts;
+    uint32_t    numNames;
+    uint32_t    nameCapacity;
+
+    //Open-addressing table of name ids plus one, 0 for an empty slot
+    uint32_t*   slots;
+    uint32_t    numSlots;
+} BinaryWriter;
+
+//An open archive
+struct cardArchive {
+    const unsigned char*    map;
+    size_t                  size;
+
+    uint32_t                numCards;
+    const unsigned char*    directory;
+
+    //Card records end where the name table starts
+    const unsigned char*    recordsEnd;
+
+    //Interned names, pointing into the map
+    uint32_t                numNames;
+    const char**            names;
+    uint32_t*               nameLengths;
+};
+
+//Space needed to build one card: structs first, then the strings they point to
+typedef struct cardSize {
+    size_t  structs;
+    size_t  strings;
+} CardSize;
+
+//Cursors into the storage of a card being built
+typedef struct carver {
+    const Card* card;
+    char*       structs;
+    char*       strings;
+} Carver;
+
+//State of packCardDirectory while cards arrive
+typedef struct packState {
+    BinaryWriter*           writer;
+    const CardFileEntry*    entries;
+
+    //Record offset of each file, 0 for files that were not stored
+    uint64_t*               offsets;
+    bool                    ok;
+} PackState;
+
+//Appends a string as its varint length, its bytes and a NUL, so it can be read in place
+static bool appendString(ByteBuffer* buffer, const char* str, size_t len) {
+
+    return appendVarint(buffer, len) && appendBuffer(buffer, str, len) && appendBuffer(buffer, "", 1);
+}
+
+//Reads a string written by appendString without copying it
+static bool readString(const unsigned char** pos, const unsigned char* end, const char** str, size_t* len) {
+
+    uint64_t length;
+
+    if (!readVarint(pos, end, &length) || length >= (uint64_t)(end - *pos) || (*pos)[length] != '\0') {
+        return false;
+    }
+
+    *str = (const char*)*pos;
+    *len = (size_t)length;
+    *pos += length + 1;
+
+    return true;
+}
+
+//Reads one byte
+static bool readByte(const unsigned char** pos, const unsigned char* end, unsigned char* value) {
+
+    if (*pos >= end) {
+        return false;
+    }
+
+    *value = *(*pos)++;
+
+    return true;
+}
+
+//Stores a little-endian integer of size bytes
+static void putLittle(unsigned char* bytes, uint64_t value, int size) {
+
+    for (int i = 0; i < size; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+//Loads a little-endian integer of size bytes
+static uint64_t getLittle(const unsigned char* bytes, int size) {
+
+    uint64_t value = 0;
+
+    for (int i = 0; i < size; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+
+    return value;
+}
+
+//Doubles the name table of a writer and rehashes every name into it
+static bool growNameSlots(BinaryWriter* writer) {
+
+    uint32_t newCount = writer->numSlots ? writer->numSlots * 2 : 256;
+    uint32_t* newSlots = vcCalloc(newCount, sizeof(uint32_t));
+    if (newSlots == NULL) {
+        return false;
+    }
+
+    for (uint32_t id = 0; id < writer->numNames; id++) {
+        const char* text = (const char*)writer->names.data + writer->nameStarts[id];
+        uint32_t pos = hashBytes(text, strlen(text)) & (newCount - 1);
+
+        while (newSlots[pos] != 0) {
+            pos = (pos + 1) & (newCount - 1);
+        }
+
+        newSlots[pos] = id + 1;
+    }
+
+    vcFree(writer->slots);
+    writer->slots = newSlots;
+    writer->numSlots = newCount;
+
+    return true;
+}
+
+//Finds or adds a name in the writer's name table
+static bool internName(BinaryWriter* writer, const char* str, uint32_t* id) {
+
+    if (str == NULL) {
+        str = "";
+    }
+
+    if ((writer->numNames + 1) * 2 > writer->numSlots && !growNameSlots(writer)) {
+        return false;
+    }
+
+    size_t len = strlen(str);
+    uint32_t pos = hashBytes(str, len) & (writer->numSlots - 1);
+
+    while (writer->slots[pos] != 0) {
+        uint32_t existing = writer->slots[pos] - 1;
+
+        if (strcmp((const char*)writer->names.data + writer->nameStarts[existing], str) == 0) {
+            *id = existing;
+            return true;
+        }
+
+        pos = (pos + 1) & (writer->numSlots - 1);
+    }
+
+    if (writer->numNames == writer->nameCapacity) {
+        uint32_t newCapacity = writer->nameCapacity ? writer->nameCapacity * 2 : 256;
+        uint32_t* newStarts = vcRealloc(writer->nameStarts, newCapacity * sizeof(uint32_t));
+        if (newStarts == NULL) {
+            return false;
+        }
+
+        writer->nameStarts = newStarts;
+        writer->nameCapacity = newCapacity;
+    }
+
+    if (!appendVarint(&writer->names, len) || writer->names.length > UINT32_MAX) {
+        return false;
+    }
+
+    writer->nameStarts[writer->numNames] = (uint32_t)writer->names.length;
+
+    if (!appendBuffer(&writer->names, str, len) || !appendBuffer(&writer->names, "", 1)) {
+        return false;
+    }
+
+    *id = writer->numNames++;
+    writer->slots[pos] = writer->numNames;
+
+    return true;
+}
+
+//Appends the id of an interned name to the record
+static bool appendName(BinaryWriter* writer, const char* str) {
+
+    uint32_t id;
+
+    return internName(writer, str, &id) && appendVarint(&writer->record, id);
+}
+
+//Appends a property: interned name, group and parameters, then its values
+static bool encodeProperty(BinaryWriter* writer, const Property* prop) {
+
+    ByteBuffer* record = &writer->record;
+    bool ok = appendName(writer, prop->name) && appendName(writer, prop->group)
+              && appendVarint(record, prop->parameters ? (uint64_t)getLength(prop->parameters) : 0);
+
+    if (prop->parameters != NULL) {
+        for (Node* node = prop->parameters->head; ok && node != NULL; node = node->next) {
+            Parameter* param = node->data;
+            ok = appendName(writer, param->name) && appendName(writer, param->value);
+        }
+    }
+
+    ok = ok && appendVarint(record, prop->values ? (uint64_t)getLength(prop->values) : 0);
+
+    if (prop->values != NULL) {
+        for (Node* node = prop->values->head; ok && node != NULL; node = node->next) {
+            const char* value = node->data ? node->data : "";
+            ok = appendString(record, value, strlen(value));
+        }
+    }
+
+    return ok;
+}
+
+//Checks whether a string is exactly len decimal digits
+static bool isDigits(const char* str, size_t len) {
+
+    if (str == NULL || strlen(str) != len) {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Appends a DateTime, storing full YYYYMMDD dates and HHMMSS times as integers
+static bool encodeDate(BinaryWriter* writer, const DateTime* dt) {
+
+    ByteBuffer* record = &writer->record;
+    unsigned char flags = (dt->UTC ? DATE_UTC : 0) | (dt->isText ? DATE_TEXT : 0);
+
+    if (dt->isText) {
+        const char* text = dt->text ? dt->text : "";
+        return appendBuffer(record, &flags, 1) && appendString(record, text, strlen(text));
+    }
+
+    bool packDate = isDigits(dt->date, 8);
+    bool packTime = isDigits(dt->time, 6);
+    const char* date = dt->date ? dt->date : "";
+    const char* time = dt->time ? dt->time : "";
+
+    flags |= (packDate ? DATE_PACKED : 0) | (packTime ? TIME_PACKED : 0);
+
+    bool ok = appendBuffer(record, &flags, 1);
+
+    ok = ok && (packDate ? appendVarint(record, strtoul(date, NULL, 10)) : appendString(record, date, strlen(date)));
+    ok = ok && (packTime ? appendVarint(record, strtoul(time, NULL, 10)) : appendString(record, time, strlen(time)));
+
+    return ok;
+}
+
+//Encodes a card and writes its record, returning the record's offset or 0 on failure
+static uint64_t writeRecord(BinaryWriter* writer, const char* name, const Card* card) {
+
+    ByteBuffer* record = &writer->record;
+    unsigned char flags = (card->fn ? HAS_FN : 0) | (card->birthday ? HAS_BIRTHDAY : 0) | (card->anniversary ? HAS_ANNIVERSARY : 0);
+
+    record->length = 0;
+
+    bool ok = appendString(record, name, strlen(name)) && appendBuffer(record, &flags, 1);
+
+    ok = ok && (card->fn == NULL || encodeProperty(writer, card->fn));
+    ok = ok && appendVarint(record, card->optionalProperties ? (uint64_t)getLength(card->optionalProperties) : 0);
+
+    if (card->optionalProperties != NULL) {
+        for (Node* node = card->optionalProperties->head; ok && node != NULL; node = node->next) {
+            ok = encodeProperty(writer, node->data);
+        }
+    }
+
+    ok = ok && (card->birthday == NULL || encodeDate(writer, card->birthday));
+    ok = ok && (card->anniversary == NULL || encodeDate(writer, card->anniversary));
+
+    if (!ok || fwrite(record->data, 1, record->length, writer->fptr) != record->length) {
+        return 0;
+    }
+
+    uint64_t offset = writer->offset;
+    writer->offset += record->length;
+
+    return offset;
+}
+
+//Creates the file and reserves room for its header
+static bool openWriter(BinaryWriter* writer, const char* fileName) {
+
+    memset(writer, 0, sizeof(BinaryWriter));
+
+    unsigned char header[HEADER_SIZE] = {0};
+
+    writer->fptr = fopen(fileName, "wb");
+    if (writer->fptr == NULL) {
+        return false;
+    }
+
+    writer->offset = HEADER_SIZE;
+
+    return fwrite(header, 1, HEADER_SIZE, writer->fptr) == HEADER_SIZE;
+}
+
+//Writes the name table, the directory and the header, then closes the file
+static bool finishWriter(BinaryWriter* writer, const uint64_t* directory, uint32_t numCards) {
+
+    ByteBuffer tail = {NULL, 0, 0};
+    uint64_t namesOffset = writer->offset;
+
+    bool ok = appendVarint(&tail, writer->numNames) && appendBuffer(&tail, writer->names.data, writer->names.length);
+    uint64_t directoryOffset = namesOffset + tail.length;
+
+    for (uint32_t i = 0; ok && i < numCards; i++) {
+        unsigned char entry[8];
+        putLittle(entry, directory[i], 8);
+        ok = appendBuffer(&tail, entry, 8);
+    }
+
+    unsigned char header[HEADER_SIZE];
+    memcpy(header, BINARY_MAGIC, 4);
+    putLittle(header + 4, BINARY_VERSION, 4);
+    putLittle(header + 8, numCards, 4);
+    putLittle(header + 12, writer->numNames, 4);
+    putLittle(header + 16, namesOffset, 8);
+    putLittle(header + 24, directoryOffset, 8);
+    putLittle(header + 32, namesOffset + tail.length, 8);
+
+    ok = ok && fwrite(tail.data, 1, tail.length, writer->fptr) == tail.length;
+    ok = ok && fseek(writer->fptr, 0, SEEK_SET) == 0 && fwrite(header, 1, HEADER_SIZE, writer->fptr) == HEADER_SIZE;
+    ok = fclose(writer->fptr) == 0 && ok;
+
+    writer->fptr = NULL;
+    vcFree(tail.data);
+
+    return ok;
+}
+
+//Releases a writer, closing its file if it is still open
+static void freeWriter(BinaryWriter* writer) {
+
+    if (writer->fptr != NULL) {
+        fclose(writer->fptr);
+    }
+
+    vcFree(writer->record.data);
+    vcFree(writer->names.data);
+    vcFree(writer->nameStarts);
+    vcFree(writer->slots);
+}
+
+//Saves one card in the binary format
+VCardErrorCode saveCardBinary(const char* fileName, const Card* obj) {
+
+    if (fileName == NULL || obj == NULL) {
+        return WRITE_ERROR;
+    }
+
+    BinaryWriter writer;
+
+    if (!openWriter(&writer, fileName)) {
+        freeWriter(&writer);
+        return WRITE_ERROR;
+    }
+
+    uint64_t offset = writeRecord(&writer, "", obj);
+    bool ok = offset != 0 && finishWriter(&writer, &offset, 1);
+
+    freeWriter(&writer);
+
+    return ok ? OK : WRITE_ERROR;
+}
+
+//Encodes each card as loadCards delivers it
+static void packCard(int index, const char* fileName, VCardErrorCode err, Card* card, void* context) {
+
+    PackState* state = context;
+
+    if (err == OK && state->ok) {
+        state->offsets[index] = writeRecord(state->writer, state->entries[index].name, card);
+        state->ok = state->offsets[index] != 0;
+    }
+
+    deleteCard(card);
+}
+
+//Packs the .vcf files of a directory into one archive
+VCardErrorCode packCardDirectory(const char* dirPath, const char* archiveName, int* numPacked) {
+
+    if (numPacked != NULL) {
+        *numPacked = 0;
+    }
+
+    if (dirPath == NULL || archiveName == NULL) {
+        return OTHER_ERROR;
+    }
+
+    CardFileEntry* entries = NULL;
+    int count = 0;
+    VCardErrorCode err = scanCardDirectory(dirPath, &entries, &count);
+
+    if (err != OK) {
+        return err;
+    }
+
+    //Builds the path of every file
+    size_t dirLen = strlen(dirPath);
+    char** paths = vcCalloc(count > 0 ? count : 1, sizeof(char*));
+    uint64_t* offsets = vcCalloc(count > 0 ? count : 1, sizeof(uint64_t));
+    bool ok = paths != NULL && offsets != NULL;
+
+    for (int i = 0; ok && i < count; i++) {
+        paths[i] = vcMalloc(dirLen + strlen(entries[i].name) + 2);
+        ok = paths[i] != NULL;
+
+        if (ok) {
+            sprintf(paths[i], "%s/%s", dirPath, entries[i].name);
+        }
+    }
+
+    err = ok ? OK : OTHER_ERROR;
+
+    BinaryWriter writer;
+    PackState state = {&writer, entries, offsets, true};
+
+    if (err == OK && !openWriter(&writer, archiveName)) {
+        freeWriter(&writer);
+        err = WRITE_ERROR;
+    }
+    else if (err == OK) {
+        err = loadCards(paths, count, 0, packCard, &state);
+
+        //Keeps the stored cards, in directory order
+        uint32_t numCards = 0;
+        for (int i = 0; i < count; i++) {
+            if (offsets[i] != 0) {
+                offsets[numCards++] = offsets[i];
+            }
+        }
+
+        if (err == OK && !state.ok) {
+            err = WRITE_ERROR;
+        }
+
+        if (err == OK && !finishWriter(&writer, offsets, numCards)) {
+            err = WRITE_ERROR;
+        }
+
+        if (err == OK && numPacked != NULL) {
+            *numPacked = (int)numCards;
+        }
+
+        freeWriter(&writer);
+    }
+
+    for (int i = 0; paths != NULL && i < count; i++) {
+        vcFree(paths[i]);
+    }
+
+    vcFree(paths);
+    vcFree(offsets);
+    deleteCardDirectory(entries);
+
+    return err;
+}
+
+//Checks the header of a mapped file and indexes its name table
+static VCardErrorCode readHeader(CardArchive* archive) {
+
+    const unsigned char* map = archive->map;
+
+    if (archive->size < HEADER_SIZE || memcmp(map, BINARY_MAGIC, 4) != 0 || getLittle(map + 4, 4) != BINARY_VERSION
+        || getLittle(map + 32, 8) != archive->size) {
+        return INV_FILE;
+    }
+
+    uint64_t numCards = getLittle(map + 8, 4);
+    uint64_t numNames = getLittle(map + 12, 4);
+    uint64_t namesOffset = getLittle(map + 16, 8);
+    uint64_t directoryOffset = getLittle(map + 24, 8);
+
+    if (namesOffset < HEADER_SIZE || directoryOffset < namesOffset || directoryOffset > archive->size
+        || (archive->size - directoryOffset) / 8 != numCards || (archive->size - directoryOffset) % 8 != 0) {
+        return INV_FILE;
+    }
+
+    archive->numCards = (uint32_t)numCards;
+    archive->directory = map + directoryOffset;
+    archive->recordsEnd = map + namesOffset;
+
+    //Every name takes at least two bytes, which bounds the count before allocating
+    const unsigned char* pos = map + namesOffset;
+    const unsigned char* end = map + directoryOffset;
+    uint64_t count;
+
+    if (!readVarint(&pos, end, &count) || count != numNames || count > (uint64_t)(end - pos) / 2) {
+        return INV_FILE;
+    }
+
+    archive->names = malloc((count > 0 ? count : 1) * sizeof(char*));
+    archive->nameLengths = malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+
+    if (archive->names == NULL || archive->nameLengths == NULL) {
+        return OTHER_ERROR;
+    }
+
+    for (uint32_t id = 0; id < count; id++) {
+        size_t len;
+
+        if (!readString(&pos, end, &archive->names[id], &len) || len > UINT32_MAX) {
+            return INV_FILE;
+        }
+
+        archive->nameLengths[id] = (uint32_t)len;
+    }
+
+    archive->numNames = (uint32_t)count;
+
+    return pos == end ? OK : INV_FILE;
+}
+
+//Opens a binary archive
+VCardErrorCode openCardArchive(const char* fileName, CardArchive** archive) {
+
+    if (fileName == NULL || archive == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *archive = NULL;
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return INV_FILE;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < HEADER_SIZE) {
+        close(fd);
+        return INV_FILE;
+    }
+
+    void* map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return INV_FILE;
+    }
+
+    CardArchive* opened = calloc(1, sizeof(CardArchive));
+    if (opened == NULL) {
+        munmap(map, (size_t)info.st_size);
+        return OTHER_ERROR;
+    }
+
+    opened->map = map;
+    opened->size = (size_t)info.st_size;
+
+    VCardErrorCode err = readHeader(opened);
+
+    if (err != OK) {
+        closeCardArchive(opened);
+        return err;
+    }
+
+    *archive = opened;
+
+    return OK;
+}
+
+//Closes an archive
+void closeCardArchive(CardArchive* archive) {
+
+    if (archive == NULL) {
+        return;
+    }
+
+    munmap((void*)archive->map, archive->size);
+    free(archive->names);
+    free(archive->nameLengths);
+    free(archive);
+}
+
+//Returns the number of cards in an archive
+int cardArchiveCount(const CardArchive* archive) {
+
+    return archive != NULL ? (int)archive->numCards : 0;
+}
+
+//Finds the record of a card, returning false if the index or offset is invalid
+static bool findRecord(const CardArchive* archive, int index, const unsigned char** pos) {
+
+    if (archive == NULL || index < 0 || (uint32_t)index >= archive->numCards) {
+        return false;
+    }
+
+    uint64_t offset = getLittle(archive->directory + 8 * (size_t)index, 8);
+
+    if (offset < HEADER_SIZE || offset >= (uint64_t)(archive->recordsEnd - archive->map)) {
+        return false;
+    }
+
+    *pos = archive->map + offset;
+
+    return true;
+}
+
+//Reads the id of an interned name
+static bool readName(const CardArchive* archive, const unsigned char** pos, const unsigned char* end, uint32_t* id) {
+
+    uint64_t value;
+
+    if (!readVarint(pos, end, &value) || value >= archive->numNames) {
+        return false;
+    }
+
+    *id = (uint32_t)value;
+
+    return true;
+}
+
+//Returns the name a card was stored under
+const char* cardArchiveName(const CardArchive* archive, int index) {
+
+    const unsigned char* pos;
+    const char* name;
+    size_t len;
+
+    if (!findRecord(archive, index, &pos) || !readString(&pos, archive->recordsEnd, &name, &len)) {
+        return NULL;
+    }
+
+    return name;
+}
+
+//Returns the first FN value of a card, skipping over the rest of the FN property
+const char* cardArchiveFN(const CardArchive* archive, int index) {
+
+    const unsigned char* pos;
+    const unsigned char* end = archive != NULL ? archive->recordsEnd : NULL;
+    const char* text;
+    size_t len;
+    unsigned char flags;
+    uint32_t id;
+    uint64_t count;
+
+    if (!findRecord(archive, index, &pos) || !readString(&pos, end, &text, &len) || !readByte(&pos, end, &flags)
+        || (flags & HAS_FN) == 0 || !readName(archive, &pos, end, &id) || !readName(archive, &pos, end, &id)
+        || !readVarint(&pos, end, &count)) {
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (!readName(archive, &pos, end, &id) || !readName(archive, &pos, end, &id)) {
+            return NULL;
+        }
+    }
+
+    if (!readVarint(&pos, end, &count) || count == 0 || !readString(&pos, end, &text, &len)) {
+        return NULL;
+    }
+
+    return text;
+}
+
+//Rounds a struct size up so the next struct carved after it stays aligned
+static size_t aligned(size_t size) {
+
+    return (size + STRUCT_ALIGN - 1) / STRUCT_ALIGN * STRUCT_ALIGN;
+}
+
+//Adds the space a property needs to size, checking its record
+static bool measureProperty(const CardArchive* archive, const unsigned char** pos, const unsigned char* end, bool listed, CardSize* size) {
+
+    uint32_t nameId, groupId, paramName, paramValue;
+    uint64_t count;
+    const char* text;
+    size_t len;
+
+    if (!readName(archive, pos, end, &nameId) || !readName(archive, pos, end, &groupId) || !readVarint(pos, end, &count)) {
+        return false;
+    }
+
+    size->structs += aligned(sizeof(Property)) + 2 * aligned(sizeof(BlockList)) + (listed ? aligned(sizeof(Node)) : 0);
+    size->strings += archive->nameLengths[nameId] + archive->nameLengths[groupId] + 2;
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (!readName(archive, pos, end, &paramName) || !readName(archive, pos, end, &paramValue)) {
+            return false;
+        }
+
+        size->structs += aligned(sizeof(Parameter)) + aligned(sizeof(Node));
+        size->strings += archive->nameLengths[paramName] + archive->nameLengths[paramValue] + 2;
+    }
+
+    if (!readVarint(pos, end, &count)) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (!readString(pos, end, &text, &len)) {
+            return false;
+        }
+
+        size->structs += aligned(sizeof(Node));
+        size->strings += len + 1;
+    }
+
+    return true;
+}
+
+//Adds the space a date or time needs to size, checking its record
+static bool measureDatePart(const unsigned char** pos, const unsigned char* end, bool packed, int width, CardSize* size) {
+
+    uint64_t value;
+    const char* text;
+    size_t len;
+
+    if (packed) {
+        if (!readVarint(pos, end, &value) || value >= (width == 8 ? 100000000u : 1000000u)) {
+            return false;
+        }
+
+        size->strings += (size_t)width + 1;
+    }
+    else {
+        if (!readString(pos, end, &text, &len)) {
+            return false;
+        }
+
+        size->strings += len + 1;
+    }
+
+    return true;
+}
+
+//Adds the space a DateTime needs to size, checking its record
+static bool measureDate(const unsigned char** pos, const unsigned char* end, CardSize* size) {
+
+    unsigned char flags;
+
+    if (!readByte(pos, end, &flags)) {
+        return false;
+    }
+
+    //The unused fields are empty strings
+    size->structs += aligned(sizeof(DateTime));
+    size->strings += 2;
+
+    if (flags & DATE_TEXT) {
+        return measureDatePart(pos, end, false, 0, size);
+    }
+
+    return measureDatePart(pos, end, (flags & DATE_PACKED) != 0, 8, size)
+           && measureDatePart(pos, end, (flags & TIME_PACKED) != 0, 6, size);
+}
+
+//Checks a card record and works out the space needed to build it, starting after its name
+static bool measureRecord(const CardArchive* archive, const unsigned char* pos, const unsigned char* end, CardSize* size) {
+
+    unsigned char flags;
+    uint64_t count;
+
+    if (!readByte(&pos, end, &flags)) {
+        return false;
+    }
+
+    if ((flags & HAS_FN) && !measureProperty(archive, &pos, end, false, size)) {
+        return false;
+    }
+
+    if (!readVarint(&pos, end, &count)) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (!measureProperty(archive, &pos, end, true, size)) {
+            return false;
+        }
+    }
+
+    return (!(flags & HAS_BIRTHDAY) || measureDate(&pos, end, size)) && (!(flags & HAS_ANNIVERSARY) || measureDate(&pos, end, size));
+}
+
+//Takes an uninitialized struct from the front of the storage
+static void* carveStruct(Carver* carver, size_t size) {
+
+    void* ptr = carver->structs;
+    carver->structs += aligned(size);
+
+    return ptr;
+}
+
+//Copies a string into the string area of the storage
+static char* carveString(Carver* carver, const char* str, size_t len) {
+
+    char* copy = carver->strings;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    carver->strings += len + 1;
+
+    return copy;
+}
+
+//Creates an empty parameter or value list in the storage
+static List* carveList(Carver* carver, bool parameters) {
+
+    return initializePackedList(carver->card, carveStruct(carver, sizeof(BlockList)), parameters);
+}
+
+//Appends data to a list with a node from the storage
+static void carveNode(Carver* carver, List* list, void* data) {
+
+    Node* node = carveStruct(carver, sizeof(Node));
+    *node = (Node){data, list->tail, NULL};
+
+    if (list->tail != NULL) {
+        list->tail->next = node;
+    }
+    else {
+        list->head = node;
+    }
+
+    list->tail = node;
+    list->length++;
+}
+
+//Builds a property whose record has already been checked
+static Property* buildProperty(const CardArchive* archive, const unsigned char** pos, const unsigned char* end, Carver* carver) {
+
+    uint32_t nameId, groupId, paramName, paramValue;
+    uint64_t count;
+    const char* text;
+    size_t len;
+
+    readName(archive, pos, end, &nameId);
+    readName(archive, pos, end, &groupId);
+
+    Property* prop = carveStruct(carver, sizeof(Property));
+    prop->name = carveString(carver, archive->names[nameId], archive->nameLengths[nameId]);
+    prop->group = carveString(carver, archive->names[groupId], archive->nameLengths[groupId]);
+    prop->parameters = carveList(carver, true);
+    prop->values = carveList(carver, false);
+
+    readVarint(pos, end, &count);
+
+    for (uint64_t i = 0; i < count; i++) {
+        readName(archive, pos, end, &paramName);
+        readName(archive, pos, end, &paramValue);
+
+        Parameter* param = carveStruct(carver, sizeof(Parameter));
+        param->name = carveString(carver, archive->names[paramName], archive->nameLengths[paramName]);
+        param->value = carveString(carver, archive->names[paramValue], archive->nameLengths[paramValue]);
+
+        carveNode(carver, prop->parameters, param);
+    }
+
+    readVarint(pos, end, &count);
+
+    for (uint64_t i = 0; i < count; i++) {
+        readString(pos, end, &text, &len);
+        carveNode(carver, prop->values, carveString(carver, text, len));
+    }
+
+    return prop;
+}
+
+//Builds a date or time that is either a packed integer of the given width or a string
+static char* buildDatePart(const unsigned char** pos, const unsigned char* end, bool packed, int width, Carver* carver) {
+
+    uint64_t value;
+    const char* text;
+    size_t len;
+
+    if (packed) {
+        char digits[16];
+
+        readVarint(pos, end, &value);
+        snprintf(digits, sizeof(digits), "%0*u", width, (unsigned)value);
+
+        return carveString(carver, digits, (size_t)width);
+    }
+
+    readString(pos, end, &text, &len);
+
+    return carveString(carver, text, len);
+}
+
+//Builds a DateTime whose record has already been checked
+static DateTime* buildDate(const unsigned char** pos, const unsigned char* end, Carver* carver) {
+
+    unsigned char flags;
+    readByte(pos, end, &flags);
+
+    DateTime* dt = carveStruct(carver, sizeof(DateTime));
+    dt->UTC = (flags & DATE_UTC) != 0;
+    dt->isText = (flags & DATE_TEXT) != 0;
+
+    if (dt->isText) {
+        dt->text = buildDatePart(pos, end, false, 0, carver);
+        dt->date = carveString(carver, "", 0);
+        dt->time = carveString(carver, "", 0);
+    }
+    else {
+        dt->date = buildDatePart(pos, end, (flags & DATE_PACKED) != 0, 8, carver);
+        dt->time = buildDatePart(pos, end, (flags & TIME_PACKED) != 0, 6, carver);
+        dt->text = carveString(carver, "", 0);
+    }
+
+    return dt;
+}
+
+//Builds one card of an archive in a single allocation
+VCardErrorCode loadArchiveCard(const CardArchive* archive, int index, Card** obj) {
+
+    if (obj == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *obj = NULL;
+
+    const unsigned char* pos;
+    const char* name;
+    size_t len;
+
+    if (!findRecord(archive, index, &pos)) {
+        return OTHER_ERROR;
+    }
+
+    //Checks the whole record before anything is built from it
+    const unsigned char* end = archive->recordsEnd;
+    CardSize size = {0, 0};
+
+    if (!readString(&pos, end, &name, &len) || !measureRecord(archive, pos, end, &size)) {
+        return INV_CARD;
+    }
+
+    void* storage;
+    Card* card = createPackedCard(size.structs + size.strings, &storage);
+
+    if (card == NULL) {
+        return OTHER_ERROR;
+    }
+
+    Carver carver = {card, storage, (char*)storage + size.structs};
+    unsigned char flags;
+    uint64_t count;
+
+    readByte(&pos, end, &flags);
+
+    if (flags & HAS_FN) {
+        card->fn = buildProperty(archive, &pos, end, &carver);
+    }
+
+    readVarint(&pos, end, &count);
+
+    for (uint64_t i = 0; i < count; i++) {
+        carveNode(&carver, card->optionalProperties, buildProperty(archive, &pos, end, &carver));
+    }
+
+    if (flags & HAS_BIRTHDAY) {
+        card->birthday = buildDate(&pos, end, &carver);
+    }
+
+    if (flags & HAS_ANNIVERSARY) {
+        card->anniversary = buildDate(&pos, end, &carver);
+    }
+
+    *obj = card;
+
+    return OK;
+}
+
+//Loads a card saved by saveCardBinary
+VCardErrorCode loadCardBinary(const char* fileName, Card** obj) {
+
+    if (obj == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *obj = NULL;
+
+    if (fileName == NULL) {
+        return INV_FILE;
+    }
+
+    CardArchive* archive;
+    VCardErrorCode err = openCardArchive(fileName, &archive);
+
+    if (err != OK) {
+        return err;
+    }
+
+    err = cardArchiveCount(archive) == 1 ? loadArchiveCard(archive, 0, obj) : INV_FILE;
+    closeCardArchive(archive);
+
+    return err;
+}
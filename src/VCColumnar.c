@@ -0,0 +1,352 @@
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCColumnar.h"
+
+//Buffers backing one exported utf8 column
+typedef struct column {
+    uint8_t*    validity;
+    int32_t*    offsets;
+    char*       data;
+    size_t      dataLength;
+    size_t      dataCapacity;
+    int64_t     nullCount;
+} Column;
+
+//Frees the buffers of a column
+static void freeColumn(Column* col) {
+
+    if (col == NULL) {
+        return;
+    }
+
+    free(col->validity);
+    free(col->offsets);
+    free(col->data);
+    free(col);
+}
+
+//Appends raw bytes to the current entry of a column
+static bool appendBytes(Column* col, const char* str, size_t len) {
+
+    //Offsets are 32 bits wide, so a column cannot hold more than 2GB of characters
+    if (col->dataLength + len > INT32_MAX) {
+        return false;
+    }
+
+    //Grows the character buffer geometrically
+    if (col->dataLength + len > col->dataCapacity) {
+        size_t newCapacity = col->dataCapacity * 2;
+
+        while (newCapacity < col->dataLength + len) {
+            newCapacity *= 2;
+        }
+
+        char* newData = realloc(col->data, newCapacity);
+        if (newData == NULL) {
+            return false;
+        }
+
+        col->data = newData;
+        col->dataCapacity = newCapacity;
+    }
+
+    memcpy(col->data + col->dataLength, str, len);
+    col->dataLength += len;
+
+    return true;
+}
+
+//Appends all values of a property, joined with ';'
+static bool appendProperty(Column* col, const Property* prop) {
+
+    ListIterator valIter = createIterator(prop->values);
+    char* value;
+    bool first = true;
+
+    while ((value = nextElement(&valIter)) != NULL) {
+        if (!first && !appendBytes(col, ";", 1)) {
+            return false;
+        }
+        if (!appendBytes(col, value, strlen(value))) {
+            return false;
+        }
+        first = false;
+    }
+
+    return true;
+}
+
+//Appends a DateTime in its vCard form
+static bool appendDate(Column* col, const DateTime* dt) {
+
+    //Text dates are stored verbatim
+    if (dt->isText) {
+        return appendBytes(col, dt->text, strlen(dt->text));
+    }
+
+    if (!appendBytes(col, dt->date, strlen(dt->date))) {
+        return false;
+    }
+
+    //Only adds the time designator if there is a time
+    if (dt->time[0] != '\0') {
+        if (!appendBytes(col, "T", 1) || !appendBytes(col, dt->time, strlen(dt->time))) {
+            return false;
+        }
+        if (dt->UTC && !appendBytes(col, "Z", 1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Finds the first optional property with the given name
+static const Property* findProperty(const Card* card, const char* name) {
+
+    ListIterator propIter = createIterator(card->optionalProperties);
+    Property* prop;
+
+    while ((prop = nextElement(&propIter)) != NULL) {
+        if (strcasecmp(prop->name, name) == 0) {
+            return prop;
+        }
+    }
+
+    return NULL;
+}
+
+//Appends one row of a column, which is null if card is NULL or lacks the property
+static bool appendRow(Column* col, int64_t row, const Card* card, const char* name) {
+
+    bool valid = false;
+    bool ok = true;
+
+    if (card != NULL) {
+        //FN, BDAY and ANNIVERSARY have their own fields in the Card
+        if (strcasecmp(name, "FN") == 0) {
+            valid = card->fn != NULL;
+            ok = !valid || appendProperty(col, card->fn);
+        }
+        else if (strcasecmp(name, "BDAY") == 0) {
+            valid = card->birthday != NULL;
+            ok = !valid || appendDate(col, card->birthday);
+        }
+        else if (strcasecmp(name, "ANNIVERSARY") == 0) {
+            valid = card->anniversary != NULL;
+            ok = !valid || appendDate(col, card->anniversary);
+        }
+        else {
+            const Property* prop = findProperty(card, name);
+            valid = prop != NULL;
+            ok = !valid || appendProperty(col, prop);
+        }
+    }
+
+    //Sets the validity bit, or counts the null
+    if (valid) {
+        col->validity[row / 8] |= (uint8_t)(1 << (row % 8));
+    }
+    else {
+        col->nullCount++;
+    }
+
+    col->offsets[row + 1] = (int32_t)col->dataLength;
+
+    return ok;
+}
+
+//Releases a child column array
+static void releaseColumnArray(struct ArrowArray* array) {
+
+    freeColumn(array->private_data);
+    free(array->buffers);
+    array->release = NULL;
+}
+
+//Releases the top-level struct array and all of its children
+static void releaseStructArray(struct ArrowArray* array) {
+
+    for (int64_t i = 0; i < array->n_children; i++) {
+        if (array->children[i]->release != NULL) {
+            array->children[i]->release(array->children[i]);
+        }
+        free(array->children[i]);
+    }
+
+    free(array->children);
+    free(array->private_data);
+    free(array->buffers);
+    array->release = NULL;
+}
+
+//Releases a child column schema
+static void releaseColumnSchema(struct ArrowSchema* schema) {
+
+    free((char*)schema->name);
+    schema->release = NULL;
+}
+
+//Releases the top-level struct schema and all of its children
+static void releaseStructSchema(struct ArrowSchema* schema) {
+
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        if (schema->children[i]->release != NULL) {
+            schema->children[i]->release(schema->children[i]);
+        }
+        free(schema->children[i]);
+    }
+
+    free(schema->children);
+    schema->release = NULL;
+}
+
+//Builds the struct schema describing the exported columns
+static bool buildSchema(char** propNames, int numProps, struct ArrowSchema* schema) {
+
+    struct ArrowSchema** children = calloc(numProps > 0 ? numProps : 1, sizeof(struct ArrowSchema*));
+    if (children == NULL) {
+        return false;
+    }
+
+    *schema = (struct ArrowSchema){"+s", "", NULL, 0, numProps, children, NULL, releaseStructSchema, NULL};
+
+    for (int i = 0; i < numProps; i++) {
+        children[i] = malloc(sizeof(struct ArrowSchema));
+        char* name = malloc(strlen(propNames[i]) + 1);
+
+        if (children[i] == NULL || name == NULL) {
+            free(children[i]);
+            free(name);
+            schema->n_children = i;
+            releaseStructSchema(schema);
+            return false;
+        }
+
+        strcpy(name, propNames[i]);
+        *children[i] = (struct ArrowSchema){"u", name, NULL, ARROW_FLAG_NULLABLE, 0, NULL, NULL, releaseColumnSchema, NULL};
+    }
+
+    return true;
+}
+
+//Wraps a filled column into a child array
+static struct ArrowArray* columnToArray(Column* col, int64_t length) {
+
+    struct ArrowArray* child = malloc(sizeof(struct ArrowArray));
+    const void** buffers = malloc(3 * sizeof(void*));
+
+    if (child == NULL || buffers == NULL) {
+        free(child);
+        free(buffers);
+        return NULL;
+    }
+
+    buffers[0] = col->validity;
+    buffers[1] = col->offsets;
+    buffers[2] = col->data;
+
+    *child = (struct ArrowArray){length, col->nullCount, 0, 3, 0, buffers, NULL, NULL, releaseColumnArray, col};
+
+    return child;
+}
+
+//Parses a set of files into an Arrow struct array of utf8 columns
+VCardErrorCode exportCardColumns(char** fileNames, int numFiles, char** propNames, int numProps,
+                                 struct ArrowSchema* schema, struct ArrowArray* array) {
+
+    if (fileNames == NULL || numFiles < 0 || propNames == NULL || numProps < 0 || schema == NULL || array == NULL) {
+        return OTHER_ERROR;
+    }
+
+    size_t bitmapSize = (size_t)numFiles / 8 + 1;
+
+    //Allocates the row validity bitmap and the column buffers
+    uint8_t* rowValidity = calloc(bitmapSize, 1);
+    Column** cols = calloc(numProps > 0 ? numProps : 1, sizeof(Column*));
+    bool ok = rowValidity != NULL && cols != NULL;
+
+    for (int i = 0; ok && i < numProps; i++) {
+        cols[i] = calloc(1, sizeof(Column));
+        if (cols[i] == NULL) {
+            ok = false;
+            break;
+        }
+
+        cols[i]->validity = calloc(bitmapSize, 1);
+        cols[i]->offsets = calloc((size_t)numFiles + 1, sizeof(int32_t));
+        cols[i]->data = malloc(1024);
+        cols[i]->dataCapacity = 1024;
+        ok = cols[i]->validity != NULL && cols[i]->offsets != NULL && cols[i]->data != NULL;
+    }
+
+    //Parses each file once, into one reused card, and fills every column from it
+    int64_t rowNulls = 0;
+    Card* card = ok ? createEmptyCard() : NULL;
+    ok = ok && card != NULL;
+
+    for (int row = 0; ok && row < numFiles; row++) {
+        bool parsed = createCardInto(fileNames[row], card) == OK;
+
+        if (parsed) {
+            rowValidity[row / 8] |= (uint8_t)(1 << (row % 8));
+        }
+        else {
+            rowNulls++;
+        }
+
+        for (int i = 0; ok && i < numProps; i++) {
+            ok = appendRow(cols[i], row, parsed ? card : NULL, propNames[i]);
+        }
+    }
+
+    deleteCard(card);
+
+    //Wraps the columns into child arrays, which take ownership of them
+    struct ArrowArray** children = ok ? calloc(numProps > 0 ? numProps : 1, sizeof(struct ArrowArray*)) : NULL;
+    const void** buffers = ok ? malloc(sizeof(void*)) : NULL;
+    ok = ok && children != NULL && buffers != NULL;
+
+    for (int i = 0; ok && i < numProps; i++) {
+        children[i] = columnToArray(cols[i], numFiles);
+        if (children[i] == NULL) {
+            ok = false;
+            break;
+        }
+        cols[i] = NULL;
+    }
+
+    //Builds the schema last, so a failure leaves the caller's structs untouched
+    if (ok && !buildSchema(propNames, numProps, schema)) {
+        ok = false;
+    }
+
+    if (!ok) {
+        for (int i = 0; cols != NULL && i < numProps; i++) {
+            if (children != NULL && children[i] != NULL) {
+                children[i]->release(children[i]);
+                free(children[i]);
+            }
+            else {
+                freeColumn(cols[i]);
+            }
+        }
+
+        free(children);
+        free(buffers);
+        free(cols);
+        free(rowValidity);
+
+        return OTHER_ERROR;
+    }
+
+    buffers[0] = rowValidity;
+
+    *array = (struct ArrowArray){numFiles, rowNulls, 0, 1, numProps, buffers, children, NULL, releaseStructArray, rowValidity};
+
+    free(cols);
+
+    return OK;
+}
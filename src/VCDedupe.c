@@ -0,0 +1,549 @@
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCDedupe.h"
+
+//Longest normalized value; longer values are truncated
+#define MAX_NORMALIZED 256
+
+//Most words of a name that are sorted into its canonical form
+#define MAX_NAME_WORDS 32
+
+//Number of telephone digits compared, so country and trunk prefixes are ignored
+#define TEL_DIGITS 10
+
+//Shortest digit string treated as a telephone number
+#define MIN_TEL_DIGITS 7
+
+//Number of earlier cards remembered per fingerprint.  Bounds the comparisons for values
+//shared by many cards, such as a switchboard number
+#define BUCKET_SIZE 8
+
+//What a fingerprint was derived from
+typedef enum fpKind {
+    FP_NAME,
+    FP_EMAIL,
+    FP_TEL,
+    FP_UID,
+    NUM_FP_KINDS
+} FingerprintKind;
+
+//Weight of each kind in the similarity.  UIDs are compared separately
+static const double kindWeights[NUM_FP_KINDS] = {2.0, 3.0, 2.0, 0.0};
+
+typedef struct fingerprint {
+    uint64_t            hash;
+    FingerprintKind     kind;
+} Fingerprint;
+
+//Fingerprints of every card, each card's sorted by hash and stored contiguously
+typedef struct fingerprintSet {
+    Fingerprint*    items;
+    size_t          count;
+    size_t          capacity;
+    size_t*         cardStart;
+    uint64_t*       uid;
+} FingerprintSet;
+
+//Cards seen so far with one fingerprint
+typedef struct bucket {
+    uint64_t    hash;
+    int32_t     count;
+    int32_t     members[BUCKET_SIZE];
+} Bucket;
+
+//FNV-1a hash of a normalized value, seeded with its kind so kinds never collide
+static uint64_t hashValue(FingerprintKind kind, const char* str, size_t len) {
+
+    uint64_t hash = 14695981039346656037ull;
+
+    hash ^= (uint64_t)kind;
+    hash *= 1099511628211ull;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ull;
+    }
+
+    //0 marks an empty bucket
+    return hash != 0 ? hash : 1;
+}
+
+//Adds a fingerprint for the card being processed
+static bool addFingerprint(FingerprintSet* set, FingerprintKind kind, const char* str, size_t len) {
+
+    if (len == 0) {
+        return true;
+    }
+
+    if (set->count == set->capacity) {
+        size_t newCapacity = set->capacity ? set->capacity * 2 : 1024;
+        Fingerprint* newItems = realloc(set->items, newCapacity * sizeof(Fingerprint));
+
+        if (newItems == NULL) {
+            return false;
+        }
+
+        set->items = newItems;
+        set->capacity = newCapacity;
+    }
+
+    set->items[set->count++] = (Fingerprint){hashValue(kind, str, len), kind};
+
+    return true;
+}
+
+//Checks whether a byte belongs in a word
+static bool isWordByte(unsigned char c) {
+
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+//Orders word pointers alphabetically
+static int compareWords(const void* first, const void* second) {
+
+    return strcmp(*(char* const*)first, *(char* const*)second);
+}
+
+//Reduces a name to its case-folded words in sorted order, so word order and punctuation do not matter
+static size_t canonicalName(const char* text, char* out) {
+
+    char folded[MAX_NORMALIZED];
+    char* words[MAX_NAME_WORDS];
+    int numWords = 0;
+    size_t len = 0;
+    const unsigned char* pos = (const unsigned char*)text;
+
+    //Splits the text into NUL-terminated, lowercased words
+    while (*pos != '\0' && numWords < MAX_NAME_WORDS) {
+        if (!isWordByte(*pos)) {
+            pos++;
+            continue;
+        }
+
+        if (len + 1 >= sizeof(folded)) {
+            break;
+        }
+
+        words[numWords++] = folded + len;
+
+        while (*pos != '\0' && isWordByte(*pos)) {
+            if (len + 1 < sizeof(folded)) {
+                folded[len++] = (*pos >= 'A' && *pos <= 'Z') ? (char)(*pos + ('a' - 'A')) : (char)*pos;
+            }
+            pos++;
+        }
+
+        folded[len++] = '\0';
+    }
+
+    qsort(words, numWords, sizeof(char*), compareWords);
+
+    //Joins the sorted words with single spaces
+    size_t outLen = 0;
+    for (int i = 0; i < numWords; i++) {
+        size_t wordLen = strlen(words[i]);
+
+        if (i > 0) {
+            out[outLen++] = ' ';
+        }
+
+        memcpy(out + outLen, words[i], wordLen);
+        outLen += wordLen;
+    }
+
+    return outLen;
+}
+
+//Lowercases an address and drops any mailto: scheme and surrounding blanks
+static size_t canonicalEmail(const char* text, char* out) {
+
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+
+    if (strncasecmp(text, "mailto:", 7) == 0) {
+        text += 7;
+    }
+
+    size_t len = 0;
+    for (; *text != '\0' && len < MAX_NORMALIZED; text++) {
+        out[len++] = (*text >= 'A' && *text <= 'Z') ? (char)(*text + ('a' - 'A')) : *text;
+    }
+
+    while (len > 0 && (out[len - 1] == ' ' || out[len - 1] == '\t')) {
+        len--;
+    }
+
+    return len;
+}
+
+//Keeps the last digits of a telephone number, so formatting and country prefixes do not matter
+static size_t canonicalTel(const char* text, char* out) {
+
+    char digits[MAX_NORMALIZED];
+    size_t numDigits = 0;
+
+    for (; *text != '\0' && numDigits < MAX_NORMALIZED; text++) {
+        if (*text >= '0' && *text <= '9') {
+            digits[numDigits++] = *text;
+        }
+    }
+
+    if (numDigits < MIN_TEL_DIGITS) {
+        return 0;
+    }
+
+    size_t start = numDigits > TEL_DIGITS ? numDigits - TEL_DIGITS : 0;
+    memcpy(out, digits + start, numDigits - start);
+
+    return numDigits - start;
+}
+
+//Lowercases a UID and drops a urn:uuid: prefix
+static size_t canonicalUid(const char* text, char* out) {
+
+    if (strncasecmp(text, "urn:uuid:", 9) == 0) {
+        text += 9;
+    }
+
+    size_t len = 0;
+    for (; *text != '\0' && len < MAX_NORMALIZED; text++) {
+        out[len++] = (*text >= 'A' && *text <= 'Z') ? (char)(*text + ('a' - 'A')) : *text;
+    }
+
+    return len;
+}
+
+//Returns the value at a position of a property's value list, or ""
+static const char* valueAt(const Property* prop, int position) {
+
+    ListIterator valIter = createIterator(prop->values);
+    char* value;
+
+    for (int i = 0; (value = nextElement(&valIter)) != NULL; i++) {
+        if (i == position) {
+            return value;
+        }
+    }
+
+    return "";
+}
+
+//Orders fingerprints by hash
+static int compareFingerprints(const void* first, const void* second) {
+
+    uint64_t a = ((const Fingerprint*)first)->hash;
+    uint64_t b = ((const Fingerprint*)second)->hash;
+
+    return (a > b) - (a < b);
+}
+
+//Computes the fingerprints of one card and appends them, sorted and unique
+static bool fingerprintCard(FingerprintSet* set, int index, const Card* card) {
+
+    char normal[MAX_NORMALIZED + 1];
+    size_t start = set->count;
+    bool ok = true;
+
+    set->uid[index] = 0;
+
+    if (card->fn != NULL) {
+        ok = addFingerprint(set, FP_NAME, normal, canonicalName(valueAt(card->fn, 0), normal));
+    }
+
+    ListIterator propIter = createIterator(card->optionalProperties);
+    Property* prop;
+
+    while (ok && (prop = nextElement(&propIter)) != NULL) {
+        if (strcasecmp(prop->name, "N") == 0) {
+            //Family and given names only, so honorifics do not split a contact
+            char name[2 * MAX_NORMALIZED];
+            snprintf(name, sizeof(name), "%s %s", valueAt(prop, 0), valueAt(prop, 1));
+            ok = addFingerprint(set, FP_NAME, normal, canonicalName(name, normal));
+        }
+        else if (strcasecmp(prop->name, "EMAIL") == 0) {
+            ok = addFingerprint(set, FP_EMAIL, normal, canonicalEmail(valueAt(prop, 0), normal));
+        }
+        else if (strcasecmp(prop->name, "TEL") == 0) {
+            ok = addFingerprint(set, FP_TEL, normal, canonicalTel(valueAt(prop, 0), normal));
+        }
+        else if (strcasecmp(prop->name, "UID") == 0) {
+            size_t len = canonicalUid(valueAt(prop, 0), normal);
+            ok = addFingerprint(set, FP_UID, normal, len);
+
+            if (len > 0) {
+                set->uid[index] = hashValue(FP_UID, normal, len);
+            }
+        }
+    }
+
+    if (!ok) {
+        return false;
+    }
+
+    //Sorts the card's fingerprints and drops repeats
+    qsort(set->items + start, set->count - start, sizeof(Fingerprint), compareFingerprints);
+
+    size_t end = start;
+    for (size_t i = start; i < set->count; i++) {
+        if (end == start || set->items[end - 1].hash != set->items[i].hash) {
+            set->items[end++] = set->items[i];
+        }
+    }
+
+    set->count = end;
+    set->cardStart[index + 1] = end;
+
+    return true;
+}
+
+//Weighted Jaccard similarity of two cards' fingerprints
+static double similarity(const FingerprintSet* set, int a, int b) {
+
+    //A UID on both sides settles the question
+    if (set->uid[a] != 0 && set->uid[b] != 0) {
+        return set->uid[a] == set->uid[b] ? 1.0 : 0.0;
+    }
+
+    size_t i = set->cardStart[a];
+    size_t j = set->cardStart[b];
+    size_t endA = set->cardStart[a + 1];
+    size_t endB = set->cardStart[b + 1];
+    double shared = 0;
+    double total = 0;
+
+    //Merges the two sorted lists
+    while (i < endA || j < endB) {
+        if (j == endB || (i < endA && set->items[i].hash < set->items[j].hash)) {
+            total += kindWeights[set->items[i++].kind];
+        }
+        else if (i == endA || set->items[j].hash < set->items[i].hash) {
+            total += kindWeights[set->items[j++].kind];
+        }
+        else {
+            shared += kindWeights[set->items[i].kind];
+            total += kindWeights[set->items[i].kind];
+            i++;
+            j++;
+        }
+    }
+
+    return total > 0 ? shared / total : 0.0;
+}
+
+//Finds the root of a card's cluster, halving the path as it goes
+static int32_t findRoot(int32_t* parent, int32_t card) {
+
+    while (parent[card] != card) {
+        parent[card] = parent[parent[card]];
+        card = parent[card];
+    }
+
+    return card;
+}
+
+//Returns the bucket of a fingerprint, claiming an empty one if it is new
+static Bucket* findBucket(Bucket* buckets, size_t numBuckets, uint64_t hash) {
+
+    size_t pos = hash & (numBuckets - 1);
+
+    while (buckets[pos].hash != 0 && buckets[pos].hash != hash) {
+        pos = (pos + 1) & (numBuckets - 1);
+    }
+
+    buckets[pos].hash = hash;
+
+    return &buckets[pos];
+}
+
+//Clustering scratch state, one entry per card
+typedef struct clusterState {
+    int32_t*    parent;
+    int32_t*    size;
+    double*     score;
+    uint64_t*   uid;
+    int32_t*    lastCompared;
+} ClusterState;
+
+//Compares a card with the earlier cards sharing each of its fingerprints and links the matches
+static void linkCard(const FingerprintSet* set, Bucket* buckets, size_t numBuckets, ClusterState* state, int32_t card, double threshold) {
+
+    for (size_t f = set->cardStart[card]; f < set->cardStart[card + 1]; f++) {
+        Bucket* bucket = findBucket(buckets, numBuckets, set->items[f].hash);
+
+        for (int32_t m = 0; m < bucket->count; m++) {
+            int32_t other = bucket->members[m];
+
+            //Each pair is scored once, however many fingerprints it shares
+            if (state->lastCompared[other] == card) {
+                continue;
+            }
+            state->lastCompared[other] = card;
+
+            int32_t rootA = findRoot(state->parent, card);
+            int32_t rootB = findRoot(state->parent, other);
+            if (rootA == rootB) {
+                continue;
+            }
+
+            //Never joins two clusters that already hold different UIDs
+            if (state->uid[rootA] != 0 && state->uid[rootB] != 0 && state->uid[rootA] != state->uid[rootB]) {
+                continue;
+            }
+
+            double sim = similarity(set, card, other);
+            if (sim < threshold) {
+                continue;
+            }
+
+            //Unions by size, keeping the weakest link as the cluster's score
+            if (state->size[rootA] < state->size[rootB]) {
+                int32_t swap = rootA;
+                rootA = rootB;
+                rootB = swap;
+            }
+
+            double weakest = state->score[rootA] < state->score[rootB] ? state->score[rootA] : state->score[rootB];
+            state->parent[rootB] = rootA;
+            state->size[rootA] += state->size[rootB];
+            state->score[rootA] = sim < weakest ? sim : weakest;
+
+            if (state->uid[rootA] == 0) {
+                state->uid[rootA] = state->uid[rootB];
+            }
+        }
+
+        if (bucket->count < BUCKET_SIZE) {
+            bucket->members[bucket->count++] = card;
+        }
+    }
+}
+
+//Packs the clusters of two or more cards into one report allocation
+static DuplicateReport* buildReport(ClusterState* state, int numCards) {
+
+    int32_t numClusters = 0;
+    int32_t numMembers = 0;
+
+    for (int32_t i = 0; i < numCards; i++) {
+        if (findRoot(state->parent, i) == i && state->size[i] > 1) {
+            numClusters++;
+            numMembers += state->size[i];
+        }
+    }
+
+    DuplicateReport* report = malloc(sizeof(DuplicateReport) + numClusters * sizeof(CardCluster) + numMembers * sizeof(int32_t));
+    if (report == NULL) {
+        return NULL;
+    }
+
+    report->numClusters = numClusters;
+    report->clusters = (CardCluster*)(report + 1);
+    report->members = (int32_t*)(report->clusters + numClusters);
+
+    //Numbers the clusters in order of their first member, reusing lastCompared as the cluster id
+    int32_t next = 0;
+    int32_t offset = 0;
+
+    for (int32_t i = 0; i < numCards; i++) {
+        state->lastCompared[i] = -1;
+    }
+
+    for (int32_t i = 0; i < numCards; i++) {
+        int32_t root = findRoot(state->parent, i);
+
+        if (state->size[root] < 2) {
+            continue;
+        }
+
+        if (state->lastCompared[root] == -1) {
+            state->lastCompared[root] = next;
+            report->clusters[next] = (CardCluster){offset, 0, state->score[root]};
+            offset += state->size[root];
+            next++;
+        }
+
+        CardCluster* cluster = &report->clusters[state->lastCompared[root]];
+        report->members[cluster->first + cluster->count++] = i;
+    }
+
+    return report;
+}
+
+//Finds groups of cards that describe the same contact
+VCardErrorCode findDuplicateCards(Card** cards, int numCards, double threshold, DuplicateReport** report) {
+
+    if (cards == NULL || numCards < 0 || threshold < 0 || threshold > 1 || report == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *report = NULL;
+
+    if (threshold == 0) {
+        threshold = DEFAULT_DUPLICATE_THRESHOLD;
+    }
+
+    size_t count = numCards > 0 ? numCards : 1;
+    FingerprintSet set = {NULL, 0, 0, calloc(count + 1, sizeof(size_t)), malloc(count * sizeof(uint64_t))};
+    ClusterState state = {
+        malloc(count * sizeof(int32_t)),
+        malloc(count * sizeof(int32_t)),
+        malloc(count * sizeof(double)),
+        malloc(count * sizeof(uint64_t)),
+        malloc(count * sizeof(int32_t))
+    };
+    Bucket* buckets = NULL;
+    bool ok = set.cardStart != NULL && set.uid != NULL && state.parent != NULL && state.size != NULL
+              && state.score != NULL && state.uid != NULL && state.lastCompared != NULL;
+
+    //Fingerprints every card
+    for (int i = 0; ok && i < numCards; i++) {
+        ok = cards[i] != NULL && fingerprintCard(&set, i, cards[i]);
+
+        state.parent[i] = i;
+        state.size[i] = 1;
+        state.score[i] = 1.0;
+        state.uid[i] = ok ? set.uid[i] : 0;
+        state.lastCompared[i] = -1;
+    }
+
+    //Sizes the bucket table to at most half full
+    size_t numBuckets = 16;
+    while (ok && numBuckets < set.count * 2) {
+        numBuckets *= 2;
+    }
+
+    if (ok) {
+        buckets = calloc(numBuckets, sizeof(Bucket));
+        ok = buckets != NULL;
+    }
+
+    for (int32_t i = 0; ok && i < numCards; i++) {
+        linkCard(&set, buckets, numBuckets, &state, i, threshold);
+    }
+
+    if (ok) {
+        *report = buildReport(&state, numCards);
+        ok = *report != NULL;
+    }
+
+    free(buckets);
+    free(set.items);
+    free(set.cardStart);
+    free(set.uid);
+    free(state.parent);
+    free(state.size);
+    free(state.score);
+    free(state.uid);
+    free(state.lastCompared);
+
+    return ok ? OK : OTHER_ERROR;
+}
+
+//Releases a report
+void deleteDuplicateReport(DuplicateReport* report) {
+
+    free(report);
+}
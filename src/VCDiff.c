@@ -0,0 +1,397 @@
+#include <stdint.h>
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCMatch.h"
+#include "VCDiff.h"
+
+//Properties of one card, with the hashes used to pair them
+typedef struct propertySet {
+    const Property**    props;
+    uint64_t*           contentHash;
+    uint64_t*           nameHash;
+    int32_t*            match;
+    int32_t*            next;
+    int                 count;
+} PropertySet;
+
+//Head of a chain of first-card properties sharing a hash, in order of appearance
+typedef struct chainSlot {
+    uint64_t    hash;
+    int32_t     head;
+    int32_t     tail;
+} ChainSlot;
+
+//Open-addressing table of chains
+typedef struct chainTable {
+    ChainSlot*  slots;
+    size_t      numSlots;
+} ChainTable;
+
+//Frees the arrays of a property set
+static void freePropertySet(PropertySet* set) {
+
+    vcFree(set->props);
+    vcFree(set->contentHash);
+    vcFree(set->nameHash);
+    vcFree(set->match);
+    vcFree(set->next);
+}
+
+//Lists a card's properties, the FN field first, and hashes them
+static bool collectProperties(const Card* card, PropertySet* set) {
+
+    int count = (card->fn != NULL) + getLength(card->optionalProperties);
+    size_t size = count > 0 ? count : 1;
+
+    set->count = 0;
+    set->props = vcMalloc(size * sizeof(Property*));
+    set->contentHash = vcMalloc(size * sizeof(uint64_t));
+    set->nameHash = vcMalloc(size * sizeof(uint64_t));
+    set->match = vcMalloc(size * sizeof(int32_t));
+    set->next = vcMalloc(size * sizeof(int32_t));
+
+    if (set->props == NULL || set->contentHash == NULL || set->nameHash == NULL || set->match == NULL || set->next == NULL) {
+        return false;
+    }
+
+    if (card->fn != NULL) {
+        set->props[set->count++] = card->fn;
+    }
+
+    ListIterator propIter = createIterator(card->optionalProperties);
+    Property* prop;
+
+    while ((prop = nextElement(&propIter)) != NULL) {
+        set->props[set->count++] = prop;
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        set->nameHash[i] = hashPropertyName(set->props[i]);
+        set->contentHash[i] = hashPropertyContent(set->props[i], set->nameHash[i]);
+        set->match[i] = -1;
+        set->next[i] = -1;
+    }
+
+    return true;
+}
+
+//Returns the chain slot for a hash, claiming an empty one if it is new
+static ChainSlot* findChain(ChainTable* table, uint64_t hash) {
+
+    size_t pos = hash & (table->numSlots - 1);
+
+    //A slot is in use once it has a tail, even if every property in its chain has been paired
+    while (table->slots[pos].tail != -1 && table->slots[pos].hash != hash) {
+        pos = (pos + 1) & (table->numSlots - 1);
+    }
+
+    table->slots[pos].hash = hash;
+
+    return &table->slots[pos];
+}
+
+//Builds chains of the first card's properties keyed by one of their hashes
+static bool buildChains(ChainTable* table, PropertySet* set, const uint64_t* hashes) {
+
+    table->numSlots = 16;
+    while (table->numSlots < (size_t)set->count * 2) {
+        table->numSlots *= 2;
+    }
+
+    table->slots = vcMalloc(table->numSlots * sizeof(ChainSlot));
+    if (table->slots == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < table->numSlots; i++) {
+        table->slots[i] = (ChainSlot){0, -1, -1};
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        ChainSlot* slot = findChain(table, hashes[i]);
+        set->next[i] = -1;
+
+        if (slot->tail == -1) {
+            slot->head = i;
+        }
+        else {
+            set->next[slot->tail] = i;
+        }
+
+        slot->tail = i;
+    }
+
+    return true;
+}
+
+//Pairs a second-card property with the first unpaired property of its chain that satisfies same
+static int32_t takeFromChain(ChainTable* table, PropertySet* set, uint64_t hash, const Property* prop,
+                             bool (*same)(const Property* a, const Property* b)) {
+
+    ChainSlot* slot = findChain(table, hash);
+
+    //Drops already paired properties from the front, so each is skipped only once
+    while (slot->head != -1 && set->match[slot->head] != -1) {
+        slot->head = set->next[slot->head];
+    }
+
+    for (int32_t i = slot->head; i != -1; i = set->next[i]) {
+        if (set->match[i] == -1 && same(set->props[i], prop)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+//Appends a change to the diff
+static bool addChange(CardDiff* diff, int* capacity, CardChange change) {
+
+    if (diff->numChanges == *capacity) {
+        int newCapacity = *capacity ? *capacity * 2 : 16;
+        CardChange* newChanges = vcRealloc(diff->changes, newCapacity * sizeof(CardChange));
+
+        if (newChanges == NULL) {
+            return false;
+        }
+
+        diff->changes = newChanges;
+        *capacity = newCapacity;
+    }
+
+    diff->changes[diff->numChanges++] = change;
+
+    return true;
+}
+
+//Returns the occurrence-th parameter of a list with the given name, or NULL
+static const Parameter* findParameter(List* params, const char* name, int occurrence) {
+
+    ListIterator paramIter = createIterator(params);
+    Parameter* param;
+
+    while ((param = nextElement(&paramIter)) != NULL) {
+        if (strcasecmp(param->name, name) == 0 && occurrence-- == 0) {
+            return param;
+        }
+    }
+
+    return NULL;
+}
+
+//Counts the parameters before param that have the same name
+static int occurrenceOf(List* params, const Parameter* param) {
+
+    ListIterator paramIter = createIterator(params);
+    Parameter* other;
+    int occurrence = 0;
+
+    while ((other = nextElement(&paramIter)) != NULL && other != param) {
+        occurrence += strcasecmp(other->name, param->name) == 0;
+    }
+
+    return occurrence;
+}
+
+//Lists the parameter and value differences of two paired properties
+static bool diffProperty(CardDiff* diff, int* capacity, const Property* before, const Property* after) {
+
+    CardChange change = {DIFF_CHANGED, DIFF_PARAMETER, before, after, -1, NULL, NULL, NULL, NULL, NULL};
+    ListIterator paramIter = createIterator(after->parameters);
+    Parameter* param;
+
+    //Parameters of the second property, matched by name and occurrence
+    while ((param = nextElement(&paramIter)) != NULL) {
+        const Parameter* old = findParameter(before->parameters, param->name, occurrenceOf(after->parameters, param));
+
+        if (old != NULL && strcmp(old->value, param->value) == 0) {
+            continue;
+        }
+
+        change.kind = old != NULL ? DIFF_CHANGED : DIFF_ADDED;
+        change.oldText = old != NULL ? old->value : NULL;
+        change.newText = param->value;
+        change.paramName = param->name;
+
+        if (!addChange(diff, capacity, change)) {
+            return false;
+        }
+    }
+
+    //Parameters only the first property has
+    paramIter = createIterator(before->parameters);
+
+    while ((param = nextElement(&paramIter)) != NULL) {
+        if (findParameter(after->parameters, param->name, occurrenceOf(before->parameters, param)) != NULL) {
+            continue;
+        }
+
+        change.kind = DIFF_REMOVED;
+        change.oldText = param->value;
+        change.newText = NULL;
+        change.paramName = param->name;
+
+        if (!addChange(diff, capacity, change)) {
+            return false;
+        }
+    }
+
+    //Values, by position
+    change.target = DIFF_VALUE;
+    change.paramName = NULL;
+
+    Node* x = before->values->head;
+    Node* y = after->values->head;
+
+    for (int i = 0; x != NULL || y != NULL; i++) {
+        change.index = i;
+        change.oldText = x != NULL ? x->data : NULL;
+        change.newText = y != NULL ? y->data : NULL;
+        change.kind = x == NULL ? DIFF_ADDED : y == NULL ? DIFF_REMOVED : DIFF_CHANGED;
+
+        if ((x == NULL || y == NULL || strcmp(x->data, y->data) != 0) && !addChange(diff, capacity, change)) {
+            return false;
+        }
+
+        x = x != NULL ? x->next : NULL;
+        y = y != NULL ? y->next : NULL;
+    }
+
+    return true;
+}
+
+//Compares two possibly NULL strings, treating NULL as ""
+static bool sameText(const char* a, const char* b) {
+
+    return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+//Checks whether two DateTimes hold the same value
+static bool sameDate(const DateTime* a, const DateTime* b) {
+
+    return a->isText == b->isText && a->UTC == b->UTC && sameText(a->date, b->date)
+           && sameText(a->time, b->time) && sameText(a->text, b->text);
+}
+
+//Records a change to a date
+static bool diffDate(CardDiff* diff, int* capacity, DiffTarget target, const DateTime* before, const DateTime* after) {
+
+    if (before == NULL && after == NULL) {
+        return true;
+    }
+
+    if (before != NULL && after != NULL && sameDate(before, after)) {
+        return true;
+    }
+
+    DiffKind kind = before == NULL ? DIFF_ADDED : after == NULL ? DIFF_REMOVED : DIFF_CHANGED;
+    CardChange change = {kind, target, NULL, NULL, -1, NULL, NULL, NULL, before, after};
+
+    return addChange(diff, capacity, change);
+}
+
+//Pairs the properties of two cards and lists every difference
+static bool diffProperties(CardDiff* diff, int* capacity, PropertySet* a, PropertySet* b) {
+
+    ChainTable content = {NULL, 0};
+    ChainTable names = {NULL, 0};
+    bool ok = true;
+
+    //First pass: identical name, group and values
+    ok = buildChains(&content, a, a->contentHash);
+
+    for (int i = 0; ok && i < b->count; i++) {
+        int32_t match = takeFromChain(&content, a, b->contentHash[i], b->props[i], samePropertyContent);
+
+        if (match != -1) {
+            a->match[match] = i;
+            b->match[i] = match;
+        }
+    }
+
+    //Second pass: the remaining properties by name and group, in order
+    ok = ok && buildChains(&names, a, a->nameHash);
+
+    for (int i = 0; ok && i < b->count; i++) {
+        if (b->match[i] != -1) {
+            continue;
+        }
+
+        int32_t match = takeFromChain(&names, a, b->nameHash[i], b->props[i], samePropertyName);
+
+        if (match != -1) {
+            a->match[match] = i;
+            b->match[i] = match;
+        }
+    }
+
+    //Changes in the second card's order, then what the first card alone has
+    for (int i = 0; ok && i < b->count; i++) {
+        if (b->match[i] == -1) {
+            CardChange change = {DIFF_ADDED, DIFF_PROPERTY, NULL, b->props[i], -1, NULL, NULL, NULL, NULL, NULL};
+            ok = addChange(diff, capacity, change);
+        }
+        else {
+            ok = diffProperty(diff, capacity, a->props[b->match[i]], b->props[i]);
+        }
+    }
+
+    for (int i = 0; ok && i < a->count; i++) {
+        if (a->match[i] == -1) {
+            CardChange change = {DIFF_REMOVED, DIFF_PROPERTY, a->props[i], NULL, -1, NULL, NULL, NULL, NULL, NULL};
+            ok = addChange(diff, capacity, change);
+        }
+    }
+
+    vcFree(content.slots);
+    vcFree(names.slots);
+
+    return ok;
+}
+
+//Lists the differences between two cards
+VCardErrorCode diffCards(const Card* a, const Card* b, CardDiff** out) {
+
+    if (a == NULL || b == NULL || out == NULL || a->optionalProperties == NULL || b->optionalProperties == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *out = NULL;
+
+    CardDiff* diff = vcCalloc(1, sizeof(CardDiff));
+    PropertySet setA = {NULL, NULL, NULL, NULL, NULL, 0};
+    PropertySet setB = {NULL, NULL, NULL, NULL, NULL, 0};
+    int capacity = 0;
+
+    bool ok = diff != NULL && collectProperties(a, &setA) && collectProperties(b, &setB);
+
+    ok = ok && diffProperties(diff, &capacity, &setA, &setB);
+    ok = ok && diffDate(diff, &capacity, DIFF_BIRTHDAY, a->birthday, b->birthday);
+    ok = ok && diffDate(diff, &capacity, DIFF_ANNIVERSARY, a->anniversary, b->anniversary);
+
+    freePropertySet(&setA);
+    freePropertySet(&setB);
+
+    if (!ok) {
+        deleteCardDiff(diff);
+        return OTHER_ERROR;
+    }
+
+    *out = diff;
+
+    return OK;
+}
+
+//Releases a diff
+void deleteCardDiff(CardDiff* diff) {
+
+    if (diff == NULL) {
+        return;
+    }
+
+    vcFree(diff->changes);
+    vcFree(diff);
+}
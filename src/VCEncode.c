@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "VCAlloc.h"
+#include "VCEncode.h"
+
+//Smallest capacity a buffer grows to
+#define MIN_BUFFER_CAPACITY 4096
+
+//Appends bytes to a buffer
+bool appendBuffer(ByteBuffer* buffer, const void* data, size_t len) {
+
+    if (buffer->length + len > buffer->capacity) {
+        size_t newCapacity = buffer->capacity ? buffer->capacity * 2 : MIN_BUFFER_CAPACITY;
+
+        while (newCapacity < buffer->length + len) {
+            newCapacity *= 2;
+        }
+
+        unsigned char* newData = vcRealloc(buffer->data, newCapacity);
+        if (newData == NULL) {
+            return false;
+        }
+
+        buffer->data = newData;
+        buffer->capacity = newCapacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, len);
+    buffer->length += len;
+
+    return true;
+}
+
+//Appends an unsigned LEB128 varint
+bool appendVarint(ByteBuffer* buffer, uint64_t value) {
+
+    unsigned char bytes[10];
+    size_t len = 0;
+
+    do {
+        bytes[len] = value & 0x7f;
+        value >>= 7;
+        if (value != 0) {
+            bytes[len] |= 0x80;
+        }
+        len++;
+    } while (value != 0);
+
+    return appendBuffer(buffer, bytes, len);
+}
+
+//Reads an unsigned LEB128 varint, failing if it runs past the end
+bool readVarint(const unsigned char** pos, const unsigned char* end, uint64_t* value) {
+
+    *value = 0;
+
+    for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+        unsigned char byte = *(*pos)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//Hashes a byte string with FNV-1a
+uint32_t hashBytes(const char* str, size_t len) {
+
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
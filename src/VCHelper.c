@@ -1,5 +1,502 @@
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <strings.h>
+
 #include "LinkedListAPI.h"
 #include "VCParser.h"
+#include "VCAlloc.h"
+
+//Compares two lists element by element with the given comparator, then by length
+static int compareLists(List* first, List* second, int (*compare)(const void* first, const void* second)) {
+
+    Node* a = first ? first->head : NULL;
+    Node* b = second ? second->head : NULL;
+
+    while (a != NULL && b != NULL) {
+        int result = compare(a->data, b->data);
+
+        if (result != 0) {
+            return result;
+        }
+
+        a = a->next;
+        b = b->next;
+    }
+
+    //The shorter list sorts first
+    if (a == NULL && b == NULL) {
+        return 0;
+    }
+
+    return a == NULL ? -1 : 1;
+}
+
+//Compares two possibly NULL strings, with NULL sorting first
+static int compareStrings(const char* first, const char* second, bool ignoreCase) {
+
+    if (first == NULL || second == NULL) {
+        return (first != NULL) - (second != NULL);
+    }
+
+    return ignoreCase ? strcasecmp(first, second) : strcmp(first, second);
+}
+
+//Bytes for short strings allocated behind every Property and Parameter
+#define PROPERTY_INLINE_BYTES 32
+#define PARAMETER_INLINE_BYTES 24
+
+//Checks whether a string lies inside its owner's allocation
+bool isInlineString(const void* owner, const char* str) {
+
+    if (owner == NULL || str == NULL) {
+        return false;
+    }
+
+    uintptr_t start = (uintptr_t)owner;
+
+    return (uintptr_t)str >= start && (uintptr_t)str < start + vcAllocatedSize(owner);
+}
+
+//Words of the parameter vocabulary; a word's index is its ID
+static const char* const paramVocabulary[] = {
+    "TYPE", "PREF", "VALUE", "ENCODING", "CHARSET", "MEDIATYPE", "LANGUAGE", "LABEL", "ALTID", "PID",
+    "CALSCALE", "SORT-AS", "GEO", "TZ", "WORK", "HOME", "CELL", "VOICE", "FAX", "MSG", "TEXT",
+    "VIDEO", "PAGER", "TEXTPHONE", "INTERNET", "X400", "DOM", "INTL", "POSTAL", "PARCEL", "BBS",
+    "MODEM", "CAR", "ISDN", "PCS", "URI", "DATE", "DATE-TIME", "DATE-AND-OR-TIME", "TIME",
+    "TIMESTAMP", "BOOLEAN", "INTEGER", "FLOAT", "UTC-OFFSET", "LANGUAGE-TAG", "B", "BASE64",
+    "QUOTED-PRINTABLE", "8BIT", "UTF-8", "US-ASCII", "ISO-8859-1", "JPEG", "PNG", "GIF",
+    "GREGORIAN", "1", "2", "3"
+};
+
+#define NUM_PARAM_WORDS ((int)(sizeof(paramVocabulary) / sizeof(paramVocabulary[0])))
+
+//Interned spellings of each word: upper case, lower case and capitalized
+#define SPELLINGS_PER_WORD 3
+#define INTERNED_SLOT_BYTES 24
+
+//Open-addressed table from the case-folded hash of a word to its ID plus one
+#define VOCABULARY_BUCKETS 256
+
+static char internedSpellings[NUM_PARAM_WORDS * SPELLINGS_PER_WORD][INTERNED_SLOT_BYTES];
+static int16_t vocabularyTable[VOCABULARY_BUCKETS];
+static pthread_once_t vocabularyOnce = PTHREAD_ONCE_INIT;
+
+//Hashes a string without regard to case
+static unsigned hashWord(const char* str) {
+
+    unsigned hash = 2166136261u;
+
+    for (; *str != '\0'; str++) {
+        hash = (hash ^ (unsigned char)toupper((unsigned char)*str)) * 16777619u;
+    }
+
+    return hash;
+}
+
+//Fills the spellings and the lookup table, once per process
+static void buildVocabulary(void) {
+
+    for (int id = 0; id < NUM_PARAM_WORDS; id++) {
+        const char* word = paramVocabulary[id];
+        char* spellings = internedSpellings[id * SPELLINGS_PER_WORD];
+
+        for (int i = 0; word[i] != '\0'; i++) {
+            spellings[i] = (char)toupper((unsigned char)word[i]);
+            spellings[INTERNED_SLOT_BYTES + i] = (char)tolower((unsigned char)word[i]);
+            spellings[2 * INTERNED_SLOT_BYTES + i] = (char)(i == 0 ? toupper((unsigned char)word[i]) : tolower((unsigned char)word[i]));
+        }
+
+        unsigned bucket = hashWord(word) % VOCABULARY_BUCKETS;
+
+        while (vocabularyTable[bucket] != 0) {
+            bucket = (bucket + 1) % VOCABULARY_BUCKETS;
+        }
+
+        vocabularyTable[bucket] = (int16_t)(id + 1);
+    }
+}
+
+/*  Comma lists of vocabulary words, such as TYPE=work,voice, are interned too, exactly as
+    spelled.  Each sits in the arena after the IDs of its non-empty items and a count byte:
+
+        int16_t ids[count], uint8_t count, char list[]
+
+    so, as with single words, the pointer alone leads to the IDs.  The arena only grows; once
+    it or the table is full, further lists are stored in their parameters as before.
+*/
+#define LIST_ARENA_BYTES (16 * 1024)
+#define LIST_BUCKETS 1024
+#define MAX_LIST_ITEMS 8
+#define MAX_LIST_BYTES 96
+
+static char internedLists[LIST_ARENA_BYTES];
+static size_t listArenaUsed;
+static pthread_mutex_t listLock = PTHREAD_MUTEX_INITIALIZER;
+
+//Offset of each list in the arena plus one, found by its exact hash; written under listLock
+static _Atomic uint16_t listTable[LIST_BUCKETS];
+
+//Checks whether a string is one of the shared spellings of a single word
+static bool isInternedWord(const char* str) {
+
+    uintptr_t start = (uintptr_t)internedSpellings;
+
+    return (uintptr_t)str >= start && (uintptr_t)str < start + sizeof(internedSpellings);
+}
+
+//Checks whether a string is a shared list of words
+static bool isInternedList(const char* str) {
+
+    uintptr_t start = (uintptr_t)internedLists;
+
+    return (uintptr_t)str >= start && (uintptr_t)str < start + sizeof(internedLists);
+}
+
+//Checks whether a string is one of the shared spellings or lists of the vocabulary
+bool isInternedString(const char* str) {
+
+    return isInternedWord(str) || isInternedList(str);
+}
+
+//Returns the ID of a vocabulary word, whatever its case
+int paramVocabularyId(const char* word) {
+
+    if (word == NULL) {
+        return -1;
+    }
+
+    //Shared spellings know their ID from where they are stored, and lists have none
+    if (isInternedWord(word)) {
+        return (int)(((uintptr_t)word - (uintptr_t)internedSpellings) / INTERNED_SLOT_BYTES / SPELLINGS_PER_WORD);
+    }
+
+    if (isInternedList(word) || strlen(word) >= INTERNED_SLOT_BYTES) {
+        return -1;
+    }
+
+    pthread_once(&vocabularyOnce, buildVocabulary);
+
+    for (unsigned bucket = hashWord(word) % VOCABULARY_BUCKETS; vocabularyTable[bucket] != 0; bucket = (bucket + 1) % VOCABULARY_BUCKETS) {
+        int id = vocabularyTable[bucket] - 1;
+
+        if (strcasecmp(paramVocabulary[id], word) == 0) {
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+//Returns the shared copy of a vocabulary word spelled exactly as str
+const char* internParamString(const char* str) {
+
+    int id = paramVocabularyId(str);
+
+    if (id < 0) {
+        return NULL;
+    }
+
+    for (int i = 0; i < SPELLINGS_PER_WORD; i++) {
+        const char* spelling = internedSpellings[id * SPELLINGS_PER_WORD + i];
+
+        if (strcmp(spelling, str) == 0) {
+            return spelling;
+        }
+    }
+
+    return NULL;
+}
+
+//Returns the number of item IDs stored in front of a shared list, and where they are
+static int internedListIds(const char* list, const char** ids) {
+
+    int count = (unsigned char)list[-1];
+    *ids = list - 1 - count * sizeof(int16_t);
+
+    return count;
+}
+
+//Hashes a string exactly as spelled
+static unsigned hashList(const char* str) {
+
+    unsigned hash = 2166136261u;
+
+    for (; *str != '\0'; str++) {
+        hash = (hash ^ (unsigned char)*str) * 16777619u;
+    }
+
+    return hash;
+}
+
+//Returns the shared copy of a comma list whose items are all vocabulary words, adding it to the
+//arena if it is new, or NULL if str is not such a list or there is no room left
+static const char* internParamList(const char* str) {
+
+    size_t length = strlen(str);
+
+    if (strchr(str, ',') == NULL || length >= MAX_LIST_BYTES) {
+        return NULL;
+    }
+
+    //Empty items are allowed and skipped, as in TYPE=work,
+    int16_t ids[MAX_LIST_ITEMS];
+    int count = 0;
+    char item[INTERNED_SLOT_BYTES];
+
+    for (const char* start = str; start != NULL; ) {
+        const char* comma = strchr(start, ',');
+        size_t itemLength = comma != NULL ? (size_t)(comma - start) : strlen(start);
+
+        if (itemLength > 0) {
+            if (itemLength >= INTERNED_SLOT_BYTES || count == MAX_LIST_ITEMS) {
+                return NULL;
+            }
+
+            memcpy(item, start, itemLength);
+            item[itemLength] = '\0';
+
+            int id = paramVocabularyId(item);
+            if (id < 0) {
+                return NULL;
+            }
+
+            ids[count++] = (int16_t)id;
+        }
+
+        start = comma != NULL ? comma + 1 : NULL;
+    }
+
+    unsigned first = hashList(str) % LIST_BUCKETS;
+
+    //Lists already in the arena are found without taking the lock
+    for (unsigned bucket = first, probes = 0; probes < LIST_BUCKETS; bucket = (bucket + 1) % LIST_BUCKETS, probes++) {
+        uint16_t offset = atomic_load_explicit(&listTable[bucket], memory_order_acquire);
+
+        if (offset == 0) {
+            break;
+        }
+        if (strcmp(internedLists + offset - 1, str) == 0) {
+            return internedLists + offset - 1;
+        }
+    }
+
+    const char* shared = NULL;
+    size_t entrySize = count * sizeof(int16_t) + 1 + length + 1;
+
+    pthread_mutex_lock(&listLock);
+
+    for (unsigned bucket = first, probes = 0; probes < LIST_BUCKETS; bucket = (bucket + 1) % LIST_BUCKETS, probes++) {
+        uint16_t offset = atomic_load_explicit(&listTable[bucket], memory_order_relaxed);
+
+        //Another thread may have added the list since the search above
+        if (offset != 0) {
+            if (strcmp(internedLists + offset - 1, str) == 0) {
+                shared = internedLists + offset - 1;
+                break;
+            }
+            continue;
+        }
+
+        if (listArenaUsed + entrySize > LIST_ARENA_BYTES) {
+            break;
+        }
+
+        char* entry = internedLists + listArenaUsed;
+        memcpy(entry, ids, count * sizeof(int16_t));
+        entry[count * sizeof(int16_t)] = (char)count;
+
+        char* list = entry + count * sizeof(int16_t) + 1;
+        memcpy(list, str, length + 1);
+
+        listArenaUsed += entrySize;
+        atomic_store_explicit(&listTable[bucket], (uint16_t)(list - internedLists + 1), memory_order_release);
+        shared = list;
+        break;
+    }
+
+    pthread_mutex_unlock(&listLock);
+
+    return shared;
+}
+
+//Frees a string unless it is stored inside its owner or shared by the vocabulary
+static void releaseString(const void* owner, char* str) {
+
+    if (!isInlineString(owner, str) && !isInternedString(str)) {
+        vcFree(str);
+    }
+}
+
+//Copies a string into the unused bytes behind its owner's struct, or onto the heap if it does not fit
+static char* placeString(void* owner, size_t structSize, size_t* used, const char* str) {
+
+    if (str == NULL) {
+        str = "";
+    }
+
+    size_t length = strlen(str) + 1;
+    size_t capacity = vcAllocatedSize(owner) - structSize;
+    char* copy;
+
+    if (length <= capacity - *used) {
+        copy = (char*)owner + structSize + *used;
+        *used += length;
+    }
+    else {
+        copy = vcMalloc(length);
+
+        if (copy == NULL) {
+            return NULL;
+        }
+    }
+
+    memcpy(copy, str, length);
+
+    return copy;
+}
+
+//Replaces the name and group of a property
+bool setPropertyStrings(Property* prop, const char* name, const char* group) {
+
+    if (prop == NULL) {
+        return false;
+    }
+
+    releaseString(prop, prop->name);
+    releaseString(prop, prop->group);
+
+    size_t used = 0;
+
+    prop->name = placeString(prop, sizeof(Property), &used, name);
+    prop->group = placeString(prop, sizeof(Property), &used, group);
+
+    if (prop->name == NULL || prop->group == NULL) {
+        releaseString(prop, prop->name);
+        releaseString(prop, prop->group);
+        prop->name = NULL;
+        prop->group = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+//Allocates a property with inline storage for its name and group
+Property* createProperty(const char* name, const char* group) {
+
+    Property* prop = vcCalloc(1, sizeof(Property) + PROPERTY_INLINE_BYTES);
+    if (prop == NULL) {
+        return NULL;
+    }
+
+    prop->parameters = initializeList(parameterToString, deleteParameter, compareParameters);
+    prop->values = initializeList(valueToString, deleteValue, compareValues);
+
+    if (prop->parameters == NULL || prop->values == NULL || !setPropertyStrings(prop, name, group)) {
+        deleteProperty(prop);
+        return NULL;
+    }
+
+    return prop;
+}
+
+//Allocates a parameter with inline storage for its name and value
+Parameter* createParameter(const char* name, const char* value) {
+
+    Parameter* param = vcMalloc(sizeof(Parameter) + PARAMETER_INLINE_BYTES);
+    if (param == NULL) {
+        return NULL;
+    }
+
+    size_t used = 0;
+    const char* sharedName = internParamString(name);
+    const char* sharedValue = internParamString(value);
+
+    if (sharedValue == NULL && value != NULL) {
+        sharedValue = internParamList(value);
+    }
+
+    //Vocabulary words and lists point to their shared copy, leaving the inline bytes to the rest
+    param->name = sharedName != NULL ? (char*)sharedName : placeString(param, sizeof(Parameter), &used, name);
+    param->value = sharedValue != NULL ? (char*)sharedValue : placeString(param, sizeof(Parameter), &used, value);
+
+    if (param->name == NULL || param->value == NULL) {
+        deleteParameter(param);
+        return NULL;
+    }
+
+    return param;
+}
+
+//Checks whether a comma-separated value list holds an item, without regard to case
+static bool listHasItem(const char* list, const char* item, size_t itemLength) {
+
+    while (list != NULL) {
+        const char* comma = strchr(list, ',');
+        size_t length = comma != NULL ? (size_t)(comma - list) : strlen(list);
+
+        //Empty items are skipped, as in the IDs of a shared list
+        if (length > 0 && length == itemLength && strncasecmp(list, item, length) == 0) {
+            return true;
+        }
+
+        list = comma != NULL ? comma + 1 : NULL;
+    }
+
+    return false;
+}
+
+//Checks whether a property has a parameter value, comparing vocabulary words by ID
+bool hasParamValue(const Property* prop, const char* name, const char* value) {
+
+    if (prop == NULL || prop->parameters == NULL || name == NULL || value == NULL) {
+        return false;
+    }
+
+    int nameId = paramVocabularyId(name);
+    int valueId = paramVocabularyId(value);
+    size_t valueLength = strlen(value);
+
+    for (const Node* node = prop->parameters->head; node != NULL; node = node->next) {
+        const Parameter* param = node->data;
+
+        //Interned strings settle the comparison without reading them
+        if (isInternedWord(param->name) && nameId >= 0) {
+            if (paramVocabularyId(param->name) != nameId) {
+                continue;
+            }
+        }
+        else if (param->name == NULL || strcasecmp(param->name, name) != 0) {
+            continue;
+        }
+
+        if (isInternedWord(param->value) && valueId >= 0) {
+            if (paramVocabularyId(param->value) == valueId) {
+                return true;
+            }
+        }
+        else if (isInternedList(param->value) && valueId >= 0) {
+            const char* ids;
+            int count = internedListIds(param->value, &ids);
+
+            for (int i = 0; i < count; i++) {
+                int16_t id;
+                memcpy(&id, ids + i * sizeof(int16_t), sizeof(int16_t));
+
+                if (id == valueId) {
+                    return true;
+                }
+            }
+        }
+        else if (listHasItem(param->value, value, valueLength)) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
 //Deletes a property
 void deleteProperty(void* toBeDeleted) {
@@ -11,9 +508,9 @@ void deleteProperty(void* toBeDeleted) {
     //Initializes property
     Property *p = (Property *)toBeDeleted;
 
-    //Frees name and group fields
-    free(p->name);
-    free(p->group);
+    //Frees name and group fields unless they are stored in the property
+    releaseString(p, p->name);
+    releaseString(p, p->group);
 
     //Frees any parameters
     if (p->parameters) {
@@ -27,12 +524,36 @@ void deleteProperty(void* toBeDeleted) {
         freeList(p->values);
     }
 
-    free(p);
+    vcFree(p);
 }
 
+//Orders properties by name, group, values and parameters
 int compareProperties(const void* first,const void* second) {
 
-    return 0;
+    if (first == NULL || second == NULL) {
+        return (first != NULL) - (second != NULL);
+    }
+
+    const Property* a = (const Property*)first;
+    const Property* b = (const Property*)second;
+
+    //Property names and groups are case-insensitive
+    int result = compareStrings(a->name, b->name, true);
+    if (result != 0) {
+        return result;
+    }
+
+    result = compareStrings(a->group, b->group, true);
+    if (result != 0) {
+        return result;
+    }
+
+    result = compareLists(a->values, b->values, compareValues);
+    if (result != 0) {
+        return result;
+    }
+
+    return compareLists(a->parameters, b->parameters, compareParameters);
 }
 
 //Converts properties to a string
@@ -119,15 +640,29 @@ void deleteParameter(void* toBeDeleted) {
     //Initializes the parameter
     Parameter *p = (Parameter *)toBeDeleted;
 
-    //Frees the name and value, and parameter
-    free(p->name);
-    free(p->value);
-    free(p);
+    //Frees the name and value unless they are stored in the parameter, and the parameter
+    releaseString(p, p->name);
+    releaseString(p, p->value);
+    vcFree(p);
 }
 
+//Orders parameters by name, then by value
 int compareParameters(const void* first,const void* second) {
 
-    return 0;
+    if (first == NULL || second == NULL) {
+        return (first != NULL) - (second != NULL);
+    }
+
+    const Parameter* a = (const Parameter*)first;
+    const Parameter* b = (const Parameter*)second;
+
+    //Parameter names are case-insensitive
+    int result = compareStrings(a->name, b->name, true);
+    if (result != 0) {
+        return result;
+    }
+
+    return compareStrings(a->value, b->value, false);
 }
 
 //Converts parameters to a readable string
@@ -163,13 +698,14 @@ char* parameterToString(void* param) {
 void deleteValue(void* toBeDeleted) {
 
     if (toBeDeleted != NULL) {
-        free(toBeDeleted);
+        vcFree(toBeDeleted);
     }
 }
 
+//Orders values as plain strings
 int compareValues(const void* first,const void* second) {
 
-    return 0;
+    return compareStrings((const char*)first, (const char*)second, false);
 }
 
 //Converts values to a readable string
@@ -211,16 +747,43 @@ void deleteDate(void* toBeDeleted) {
         DateTime *date = (DateTime *)toBeDeleted;
 
         //Frees all elements of the date struct
-        free(date->date);
-        free(date->time);
-        free(date->text);
-        free(date);
+        vcFree(date->date);
+        vcFree(date->time);
+        vcFree(date->text);
+        vcFree(date);
     }
 }
 
+//Orders dates chronologically, with text dates after all others
 int compareDates(const void* first,const void* second) {
 
-    return 0;
+    if (first == NULL || second == NULL) {
+        return (first != NULL) - (second != NULL);
+    }
+
+    const DateTime* a = (const DateTime*)first;
+    const DateTime* b = (const DateTime*)second;
+
+    //Text dates have no chronological order, so they sort last by their text
+    if (a->isText || b->isText) {
+        if (a->isText != b->isText) {
+            return a->isText ? 1 : -1;
+        }
+        return compareStrings(a->text, b->text, false);
+    }
+
+    //YYYYMMDD and HHMMSS are fixed width, so string order is chronological order
+    int result = compareStrings(a->date, b->date, false);
+    if (result != 0) {
+        return result;
+    }
+
+    result = compareStrings(a->time, b->time, false);
+    if (result != 0) {
+        return result;
+    }
+
+    return (int)a->UTC - (int)b->UTC;
 }
 
 //Converts the date to a readable string
@@ -0,0 +1,1105 @@
+#include <stdatomic.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCEncode.h"
+#include "VCIndex.h"
+
+//Tokens longer than this are truncated, both when indexing and when searching
+#define MAX_TOKEN 64
+
+//Shortest telephone digit suffix that is indexed
+#define MIN_DIGIT_SUFFIX 4
+
+//Replaced and removed documents are dropped from memory once there are at least this many and
+//they make up a quarter of all documents
+#define COMPACT_MIN_DEAD 64
+
+//File format identification
+#define INDEX_MAGIC "VCIX"
+#define INDEX_VERSION 1
+
+//Ranking weight of each field, in IndexField order
+static const double fieldWeights[NUM_FIELDS] = {10.0, 8.0, 5.0, 6.0, 5.0, 2.0, 1.0};
+
+//One document that contains a term, with the fields it was found in
+typedef struct posting {
+    uint32_t    doc;
+    uint32_t    fields;
+} Posting;
+
+//One distinct term and the documents containing it, in increasing document order
+typedef struct term {
+    char*       text;
+    Posting*    postings;
+    uint32_t    count;
+    uint32_t    capacity;
+} Term;
+
+//One indexed file.  Re-indexing a file marks the old document dead and appends a new one; dead
+//documents stay until the index is compacted
+typedef struct document {
+    char*       fileName;
+    bool        live;
+} Document;
+
+struct cardIndex {
+    //Terms, and an open-addressing table of term id + 1 keyed by term text
+    Term*       terms;
+    uint32_t    numTerms;
+    uint32_t    termCapacity;
+    uint32_t*   termSlots;
+    uint32_t    numTermSlots;
+
+    //Documents, and an open-addressing table of document id + 1 keyed by file name
+    Document*   docs;
+    uint32_t    numDocs;
+    uint32_t    docCapacity;
+    uint32_t*   docSlots;
+    uint32_t    numDocSlots;
+    uint32_t    numDead;
+
+    //Term ids sorted by text, rebuilt lazily for prefix searches
+    uint32_t*   sortedTerms;
+    uint32_t    numSorted;
+};
+
+//Copies len bytes of str into a new NUL-terminated string
+static char* copyBytes(const char* str, size_t len) {
+
+    char* copy = malloc(len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+//Returns the slot for a term: either the slot holding it, or the empty slot where it belongs
+static uint32_t* findTermSlot(const CardIndex* index, const char* text, size_t len) {
+
+    uint32_t mask = index->numTermSlots - 1;
+    uint32_t pos = hashBytes(text, len) & mask;
+
+    while (index->termSlots[pos] != 0) {
+        const char* other = index->terms[index->termSlots[pos] - 1].text;
+
+        if (strncmp(other, text, len) == 0 && other[len] == '\0') {
+            break;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    return &index->termSlots[pos];
+}
+
+//Returns the slot for a file name: either the slot holding it, or the empty slot where it belongs
+static uint32_t* findDocSlot(const CardIndex* index, const char* fileName) {
+
+    uint32_t mask = index->numDocSlots - 1;
+    uint32_t pos = hashBytes(fileName, strlen(fileName)) & mask;
+
+    while (index->docSlots[pos] != 0) {
+        if (strcmp(index->docs[index->docSlots[pos] - 1].fileName, fileName) == 0) {
+            break;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    return &index->docSlots[pos];
+}
+
+//Doubles the term table once it is 70% full
+static bool growTermSlots(CardIndex* index) {
+
+    if ((uint64_t)(index->numTerms + 1) * 10 < (uint64_t)index->numTermSlots * 7) {
+        return true;
+    }
+
+    uint32_t* oldSlots = index->termSlots;
+    uint32_t oldCount = index->numTermSlots;
+
+    index->numTermSlots = oldCount * 2;
+    index->termSlots = calloc(index->numTermSlots, sizeof(uint32_t));
+
+    if (index->termSlots == NULL) {
+        index->termSlots = oldSlots;
+        index->numTermSlots = oldCount;
+        return false;
+    }
+
+    //Reinserts every term
+    for (uint32_t i = 0; i < oldCount; i++) {
+        if (oldSlots[i] != 0) {
+            const char* text = index->terms[oldSlots[i] - 1].text;
+            *findTermSlot(index, text, strlen(text)) = oldSlots[i];
+        }
+    }
+
+    free(oldSlots);
+
+    return true;
+}
+
+//Doubles the document table once it is 70% full
+static bool growDocSlots(CardIndex* index) {
+
+    if ((uint64_t)(index->numDocs + 1) * 10 < (uint64_t)index->numDocSlots * 7) {
+        return true;
+    }
+
+    uint32_t* oldSlots = index->docSlots;
+    uint32_t oldCount = index->numDocSlots;
+
+    index->numDocSlots = oldCount * 2;
+    index->docSlots = calloc(index->numDocSlots, sizeof(uint32_t));
+
+    if (index->docSlots == NULL) {
+        index->docSlots = oldSlots;
+        index->numDocSlots = oldCount;
+        return false;
+    }
+
+    //Reinserts every file name
+    for (uint32_t i = 0; i < oldCount; i++) {
+        if (oldSlots[i] != 0) {
+            *findDocSlot(index, index->docs[oldSlots[i] - 1].fileName) = oldSlots[i];
+        }
+    }
+
+    free(oldSlots);
+
+    return true;
+}
+
+//Returns the id of a term, adding it if it is new, or UINT32_MAX on failure
+static uint32_t getTerm(CardIndex* index, const char* text, size_t len) {
+
+    uint32_t* slot = findTermSlot(index, text, len);
+
+    if (*slot != 0) {
+        return *slot - 1;
+    }
+
+    //Makes room in the table and the term array
+    if (!growTermSlots(index)) {
+        return UINT32_MAX;
+    }
+
+    if (index->numTerms == index->termCapacity) {
+        uint32_t newCapacity = index->termCapacity ? index->termCapacity * 2 : 1024;
+        Term* newTerms = realloc(index->terms, newCapacity * sizeof(Term));
+
+        if (newTerms == NULL) {
+            return UINT32_MAX;
+        }
+
+        index->terms = newTerms;
+        index->termCapacity = newCapacity;
+    }
+
+    Term* term = &index->terms[index->numTerms];
+    term->text = copyBytes(text, len);
+    term->postings = NULL;
+    term->count = 0;
+    term->capacity = 0;
+
+    if (term->text == NULL) {
+        return UINT32_MAX;
+    }
+
+    //The table may have been rebuilt, so the slot is looked up again
+    *findTermSlot(index, text, len) = index->numTerms + 1;
+
+    //New terms invalidate the sorted order
+    index->numSorted = 0;
+
+    return index->numTerms++;
+}
+
+//Records that a document contains a term in a field
+static bool addPosting(CardIndex* index, const char* text, size_t len, uint32_t doc, IndexField field) {
+
+    uint32_t id = getTerm(index, text, len);
+    if (id == UINT32_MAX) {
+        return false;
+    }
+
+    Term* term = &index->terms[id];
+
+    //Documents are indexed one at a time, so a repeat can only be the last posting
+    if (term->count > 0 && term->postings[term->count - 1].doc == doc) {
+        term->postings[term->count - 1].fields |= 1u << field;
+        return true;
+    }
+
+    if (term->count == term->capacity) {
+        uint32_t newCapacity = term->capacity ? term->capacity * 2 : 4;
+        Posting* newPostings = realloc(term->postings, newCapacity * sizeof(Posting));
+
+        if (newPostings == NULL) {
+            return false;
+        }
+
+        term->postings = newPostings;
+        term->capacity = newCapacity;
+    }
+
+    term->postings[term->count++] = (Posting){doc, 1u << field};
+
+    return true;
+}
+
+//Checks whether a byte belongs in a token
+static bool isTokenByte(unsigned char c) {
+
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+//Reads the next case-folded token from *text into token, returning its length or 0 at the end
+static size_t nextToken(const char** text, char* token) {
+
+    const unsigned char* pos = (const unsigned char*)*text;
+    size_t len = 0;
+
+    //Skips separators
+    while (*pos != '\0' && !isTokenByte(*pos)) {
+        pos++;
+    }
+
+    //Copies the token, folding ASCII letters and truncating long tokens
+    while (*pos != '\0' && isTokenByte(*pos)) {
+        if (len < MAX_TOKEN) {
+            token[len++] = (*pos >= 'A' && *pos <= 'Z') ? (char)(*pos + ('a' - 'A')) : (char)*pos;
+        }
+        pos++;
+    }
+
+    *text = (const char*)pos;
+
+    return len;
+}
+
+//Maps a property name to the field it is indexed under
+static IndexField fieldForProperty(const char* name) {
+
+    if (strcmp(name, "FN") == 0 || strcmp(name, "NICKNAME") == 0) {
+        return FIELD_FN;
+    }
+    if (strcmp(name, "N") == 0) {
+        return FIELD_N;
+    }
+    if (strcmp(name, "ORG") == 0 || strcmp(name, "TITLE") == 0) {
+        return FIELD_ORG;
+    }
+    if (strcmp(name, "EMAIL") == 0) {
+        return FIELD_EMAIL;
+    }
+    if (strcmp(name, "TEL") == 0) {
+        return FIELD_TEL;
+    }
+    if (strcmp(name, "NOTE") == 0) {
+        return FIELD_NOTE;
+    }
+
+    return FIELD_OTHER;
+}
+
+//Indexes the tokens of one value, plus digit fragments for telephone numbers
+static bool indexValue(CardIndex* index, const char* value, uint32_t doc, IndexField field) {
+
+    char token[MAX_TOKEN];
+    size_t len;
+    const char* pos = value;
+
+    while ((len = nextToken(&pos, token)) > 0) {
+        if (!addPosting(index, token, len, doc, field)) {
+            return false;
+        }
+    }
+
+    if (field != FIELD_TEL) {
+        return true;
+    }
+
+    //Indexes the digits of the number and their suffixes, so any trailing fragment matches
+    char digits[MAX_TOKEN];
+    size_t numDigits = 0;
+
+    for (const char* c = value; *c != '\0' && numDigits < MAX_TOKEN; c++) {
+        if (*c >= '0' && *c <= '9') {
+            digits[numDigits++] = *c;
+        }
+    }
+
+    for (size_t start = 0; numDigits >= MIN_DIGIT_SUFFIX && start <= numDigits - MIN_DIGIT_SUFFIX; start++) {
+        if (!addPosting(index, digits + start, numDigits - start, doc, FIELD_TEL)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Indexes every value of a property
+static bool indexProperty(CardIndex* index, const Property* prop, uint32_t doc) {
+
+    IndexField field = fieldForProperty(prop->name);
+    ListIterator valIter = createIterator(prop->values);
+    char* value;
+
+    while ((value = nextElement(&valIter)) != NULL) {
+        if (!indexValue(index, value, doc, field)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Marks a document dead
+static void killDocument(CardIndex* index, uint32_t doc) {
+
+    if (index->docs[doc].live) {
+        index->docs[doc].live = false;
+        index->numDead++;
+    }
+}
+
+//Drops dead documents, their postings and any terms left without postings, renumbering the
+//live documents densely.  Does nothing if memory for the renumbering cannot be allocated
+static void compactIndex(CardIndex* index) {
+
+    uint32_t* newIds = malloc((index->numDocs > 0 ? index->numDocs : 1) * sizeof(uint32_t));
+    if (newIds == NULL) {
+        return;
+    }
+
+    uint32_t numLive = 0;
+    for (uint32_t doc = 0; doc < index->numDocs; doc++) {
+        if (index->docs[doc].live) {
+            newIds[doc] = numLive;
+            index->docs[numLive++] = index->docs[doc];
+        }
+        else {
+            newIds[doc] = UINT32_MAX;
+            free(index->docs[doc].fileName);
+        }
+    }
+
+    //Renumbering keeps each term's postings in increasing document order
+    uint32_t numTerms = 0;
+    for (uint32_t i = 0; i < index->numTerms; i++) {
+        Term term = index->terms[i];
+        uint32_t count = 0;
+
+        for (uint32_t j = 0; j < term.count; j++) {
+            uint32_t doc = newIds[term.postings[j].doc];
+
+            if (doc != UINT32_MAX) {
+                term.postings[count++] = (Posting){doc, term.postings[j].fields};
+            }
+        }
+
+        if (count == 0) {
+            free(term.text);
+            free(term.postings);
+            continue;
+        }
+
+        //Gives back posting arrays that are mostly empty
+        if (count < term.capacity / 4) {
+            Posting* smaller = realloc(term.postings, count * sizeof(Posting));
+
+            if (smaller != NULL) {
+                term.postings = smaller;
+                term.capacity = count;
+            }
+        }
+
+        term.count = count;
+        index->terms[numTerms++] = term;
+    }
+
+    free(newIds);
+
+    index->numDocs = numLive;
+    index->numTerms = numTerms;
+    index->numDead = 0;
+    index->numSorted = 0;
+
+    //Rebuilds both tables for the new ids
+    memset(index->termSlots, 0, index->numTermSlots * sizeof(uint32_t));
+    for (uint32_t i = 0; i < numTerms; i++) {
+        *findTermSlot(index, index->terms[i].text, strlen(index->terms[i].text)) = i + 1;
+    }
+
+    memset(index->docSlots, 0, index->numDocSlots * sizeof(uint32_t));
+    for (uint32_t doc = 0; doc < numLive; doc++) {
+        *findDocSlot(index, index->docs[doc].fileName) = doc + 1;
+    }
+}
+
+//Compacts the index once dead documents pass the threshold
+static void compactIfNeeded(CardIndex* index) {
+
+    if (index->numDead >= COMPACT_MIN_DEAD && (uint64_t)index->numDead * 4 >= index->numDocs) {
+        compactIndex(index);
+    }
+}
+
+//Appends a document, replacing any live document with the same file name
+static uint32_t addDocument(CardIndex* index, const char* fileName) {
+
+    if (!growDocSlots(index)) {
+        return UINT32_MAX;
+    }
+
+    if (index->numDocs == index->docCapacity) {
+        uint32_t newCapacity = index->docCapacity ? index->docCapacity * 2 : 256;
+        Document* newDocs = realloc(index->docs, newCapacity * sizeof(Document));
+
+        if (newDocs == NULL) {
+            return UINT32_MAX;
+        }
+
+        index->docs = newDocs;
+        index->docCapacity = newCapacity;
+    }
+
+    char* name = copyBytes(fileName, strlen(fileName));
+    if (name == NULL) {
+        return UINT32_MAX;
+    }
+
+    //The old document stays in place as a tombstone until the index is compacted or saved
+    uint32_t* slot = findDocSlot(index, fileName);
+    if (*slot != 0) {
+        killDocument(index, *slot - 1);
+    }
+
+    index->docs[index->numDocs] = (Document){name, true};
+    *slot = index->numDocs + 1;
+
+    return index->numDocs++;
+}
+
+//Index kept in step with every card file written, if any
+static _Atomic(CardIndex*) attachedIndex;
+
+//Creates an empty index
+CardIndex* createCardIndex(void) {
+
+    CardIndex* index = calloc(1, sizeof(CardIndex));
+    if (index == NULL) {
+        return NULL;
+    }
+
+    index->numTermSlots = 1024;
+    index->numDocSlots = 256;
+    index->termSlots = calloc(index->numTermSlots, sizeof(uint32_t));
+    index->docSlots = calloc(index->numDocSlots, sizeof(uint32_t));
+
+    if (index->termSlots == NULL || index->docSlots == NULL) {
+        deleteCardIndex(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+//Releases an index
+void deleteCardIndex(CardIndex* index) {
+
+    if (index == NULL) {
+        return;
+    }
+
+    if (atomic_load(&attachedIndex) == index) {
+        attachCardIndex(NULL);
+    }
+
+    for (uint32_t i = 0; i < index->numTerms; i++) {
+        free(index->terms[i].text);
+        free(index->terms[i].postings);
+    }
+
+    for (uint32_t i = 0; i < index->numDocs; i++) {
+        free(index->docs[i].fileName);
+    }
+
+    free(index->terms);
+    free(index->termSlots);
+    free(index->docs);
+    free(index->docSlots);
+    free(index->sortedTerms);
+    free(index);
+}
+
+//Adds a card to the index under a file name
+VCardErrorCode indexCard(CardIndex* index, const char* fileName, const Card* card) {
+
+    if (index == NULL || fileName == NULL || card == NULL) {
+        return OTHER_ERROR;
+    }
+
+    uint32_t doc = addDocument(index, fileName);
+    if (doc == UINT32_MAX) {
+        return OTHER_ERROR;
+    }
+
+    bool ok = card->fn == NULL || indexProperty(index, card->fn, doc);
+
+    ListIterator propIter = createIterator(card->optionalProperties);
+    Property* prop;
+
+    while (ok && (prop = nextElement(&propIter)) != NULL) {
+        ok = indexProperty(index, prop, doc);
+    }
+
+    //A half-indexed card is not searchable
+    if (!ok) {
+        killDocument(index, doc);
+    }
+
+    compactIfNeeded(index);
+
+    return ok ? OK : OTHER_ERROR;
+}
+
+//Removes a file from the index
+void removeCardFromIndex(CardIndex* index, const char* fileName) {
+
+    if (index == NULL || fileName == NULL) {
+        return;
+    }
+
+    uint32_t* slot = findDocSlot(index, fileName);
+    if (*slot != 0) {
+        killDocument(index, *slot - 1);
+        compactIfNeeded(index);
+    }
+}
+
+//Write hook of an attached index: re-indexes the file, reading it if no card is given
+static void reindexWrittenCard(const char* fileName, const Card* card, void* context) {
+
+    CardIndex* index = context;
+    Card* parsed = NULL;
+
+    if (card == NULL && createCard((char*)fileName, &parsed) == OK) {
+        card = parsed;
+    }
+
+    //A file that cannot be indexed must not keep matching on its old contents
+    if (card == NULL || indexCard(index, fileName, card) != OK) {
+        removeCardFromIndex(index, fileName);
+    }
+
+    deleteCard(parsed);
+}
+
+//Keeps an index in step with every card file the library writes
+void attachCardIndex(CardIndex* index) {
+
+    atomic_store(&attachedIndex, index);
+    setCardWriteHook(index != NULL ? reindexWrittenCard : NULL, index);
+}
+
+//Writes a card and keeps the index in step with it
+VCardErrorCode writeIndexedCard(CardIndex* index, const char* fileName, const Card* card) {
+
+    VCardErrorCode err = writeCard(fileName, card);
+    if (err != OK) {
+        return err;
+    }
+
+    //An attached index was already updated by writeCard
+    if (index == atomic_load(&attachedIndex)) {
+        return OK;
+    }
+
+    return indexCard(index, fileName, card);
+}
+
+//Index used by the term sort, since qsort has no context argument
+static _Thread_local const CardIndex* sortingIndex;
+
+//Orders term ids by term text
+static int compareTermIds(const void* first, const void* second) {
+
+    const Term* terms = sortingIndex->terms;
+
+    return strcmp(terms[*(const uint32_t*)first].text, terms[*(const uint32_t*)second].text);
+}
+
+//Rebuilds the sorted term order if terms were added since the last search
+static bool sortTerms(CardIndex* index) {
+
+    if (index->numSorted == index->numTerms) {
+        return true;
+    }
+
+    uint32_t* sorted = realloc(index->sortedTerms, (index->numTerms > 0 ? index->numTerms : 1) * sizeof(uint32_t));
+    if (sorted == NULL) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < index->numTerms; i++) {
+        sorted[i] = i;
+    }
+
+    sortingIndex = index;
+    qsort(sorted, index->numTerms, sizeof(uint32_t), compareTermIds);
+
+    index->sortedTerms = sorted;
+    index->numSorted = index->numTerms;
+
+    return true;
+}
+
+//Returns the first position in the sorted terms whose text is not less than token
+static uint32_t lowerBound(const CardIndex* index, const char* token) {
+
+    uint32_t low = 0;
+    uint32_t high = index->numSorted;
+
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+
+        if (strcmp(index->terms[index->sortedTerms[mid]].text, token) < 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+//Orders results by descending score, then by file name
+static int compareResults(const void* first, const void* second) {
+
+    const SearchResult* a = (const SearchResult*)first;
+    const SearchResult* b = (const SearchResult*)second;
+
+    if (a->score != b->score) {
+        return a->score < b->score ? 1 : -1;
+    }
+
+    return strcmp(a->fileName, b->fileName);
+}
+
+//Per-search scratch state, one slot per document
+typedef struct searchState {
+    double*     tokenScore;
+    double*     totalScore;
+    uint32_t*   fields;
+    uint32_t*   matches;
+    uint32_t*   touched;
+    uint32_t    numTouched;
+} SearchState;
+
+//Frees the scratch state of a search
+static void freeSearchState(SearchState* state) {
+
+    free(state->tokenScore);
+    free(state->totalScore);
+    free(state->fields);
+    free(state->matches);
+    free(state->touched);
+}
+
+//Scores every live document against one query token
+static void scoreToken(const CardIndex* index, const char* token, size_t len, SearchState* state) {
+
+    state->numTouched = 0;
+
+    //Walks every term that starts with the token
+    for (uint32_t pos = lowerBound(index, token); pos < index->numSorted; pos++) {
+        const Term* term = &index->terms[index->sortedTerms[pos]];
+
+        if (strncmp(term->text, token, len) != 0) {
+            break;
+        }
+
+        //Whole-term matches count double
+        double factor = term->text[len] == '\0' ? 2.0 : 1.0;
+
+        for (uint32_t i = 0; i < term->count; i++) {
+            const Posting* posting = &term->postings[i];
+
+            if (!index->docs[posting->doc].live) {
+                continue;
+            }
+
+            //Takes the weight of the most important field the term is in
+            double best = 0;
+            for (int f = 0; f < NUM_FIELDS; f++) {
+                if ((posting->fields & (1u << f)) && fieldWeights[f] > best) {
+                    best = fieldWeights[f];
+                }
+            }
+
+            if (state->tokenScore[posting->doc] == 0) {
+                state->touched[state->numTouched++] = posting->doc;
+            }
+            if (best * factor > state->tokenScore[posting->doc]) {
+                state->tokenScore[posting->doc] = best * factor;
+            }
+
+            state->fields[posting->doc] |= posting->fields;
+        }
+    }
+
+    //Folds the token's scores into the totals and clears them for the next token
+    for (uint32_t i = 0; i < state->numTouched; i++) {
+        uint32_t doc = state->touched[i];
+
+        state->totalScore[doc] += state->tokenScore[doc];
+        state->matches[doc]++;
+        state->tokenScore[doc] = 0;
+    }
+}
+
+//Searches the index
+VCardErrorCode searchCardIndex(CardIndex* index, const char* query, int maxResults, SearchResult** results, int* count) {
+
+    if (index == NULL || query == NULL || maxResults < 0 || results == NULL || count == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *results = NULL;
+    *count = 0;
+
+    if (!sortTerms(index)) {
+        return OTHER_ERROR;
+    }
+
+    uint32_t numDocs = index->numDocs > 0 ? index->numDocs : 1;
+    SearchState state = {
+        calloc(numDocs, sizeof(double)),
+        calloc(numDocs, sizeof(double)),
+        calloc(numDocs, sizeof(uint32_t)),
+        calloc(numDocs, sizeof(uint32_t)),
+        malloc(numDocs * sizeof(uint32_t)),
+        0
+    };
+
+    if (state.tokenScore == NULL || state.totalScore == NULL || state.fields == NULL || state.matches == NULL || state.touched == NULL) {
+        freeSearchState(&state);
+        return OTHER_ERROR;
+    }
+
+    //Scores each query token in turn
+    char token[MAX_TOKEN + 1];
+    size_t len;
+    uint32_t numTokens = 0;
+    const char* pos = query;
+
+    while ((len = nextToken(&pos, token)) > 0) {
+        token[len] = '\0';
+        scoreToken(index, token, len, &state);
+        numTokens++;
+    }
+
+    //Keeps the documents that matched every token
+    int numResults = 0;
+    for (uint32_t doc = 0; numTokens > 0 && doc < index->numDocs; doc++) {
+        if (state.matches[doc] == numTokens) {
+            numResults++;
+        }
+    }
+
+    SearchResult* list = numResults > 0 ? malloc(numResults * sizeof(SearchResult)) : NULL;
+    if (numResults > 0 && list == NULL) {
+        freeSearchState(&state);
+        return OTHER_ERROR;
+    }
+
+    int filled = 0;
+    for (uint32_t doc = 0; numTokens > 0 && doc < index->numDocs; doc++) {
+        if (state.matches[doc] == numTokens) {
+            list[filled++] = (SearchResult){index->docs[doc].fileName, state.totalScore[doc], state.fields[doc]};
+        }
+    }
+
+    freeSearchState(&state);
+
+    if (numResults > 1) {
+        qsort(list, numResults, sizeof(SearchResult), compareResults);
+    }
+
+    if (maxResults > 0 && numResults > maxResults) {
+        numResults = maxResults;
+    }
+
+    //Copies the names of the results that are returned
+    for (int i = 0; i < numResults; i++) {
+        list[i].fileName = copyBytes(list[i].fileName, strlen(list[i].fileName));
+
+        if (list[i].fileName == NULL) {
+            deleteSearchResults(list, i);
+            return OTHER_ERROR;
+        }
+    }
+
+    *results = list;
+    *count = numResults;
+
+    return OK;
+}
+
+//Releases search results
+void deleteSearchResults(SearchResult* results, int count) {
+
+    if (results == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(results[i].fileName);
+    }
+
+    free(results);
+}
+
+//Saves an index to a compact file
+VCardErrorCode saveCardIndex(CardIndex* index, const char* fileName) {
+
+    if (index == NULL || fileName == NULL || !sortTerms(index)) {
+        return OTHER_ERROR;
+    }
+
+    //Renumbers the live documents densely
+    uint32_t* newIds = malloc((index->numDocs > 0 ? index->numDocs : 1) * sizeof(uint32_t));
+    if (newIds == NULL) {
+        return OTHER_ERROR;
+    }
+
+    uint32_t numLive = 0;
+    for (uint32_t doc = 0; doc < index->numDocs; doc++) {
+        newIds[doc] = index->docs[doc].live ? numLive++ : UINT32_MAX;
+    }
+
+    ByteBuffer buffer = {NULL, 0, 0};
+    bool ok = appendBuffer(&buffer, INDEX_MAGIC, 4) && appendVarint(&buffer, INDEX_VERSION) && appendVarint(&buffer, numLive);
+
+    //Writes the file names of the live documents
+    for (uint32_t doc = 0; ok && doc < index->numDocs; doc++) {
+        if (index->docs[doc].live) {
+            size_t len = strlen(index->docs[doc].fileName);
+            ok = appendVarint(&buffer, len) && appendBuffer(&buffer, index->docs[doc].fileName, len);
+        }
+    }
+
+    //Counts the terms that still have a live posting
+    uint32_t numLiveTerms = 0;
+    for (uint32_t i = 0; i < index->numSorted; i++) {
+        const Term* term = &index->terms[index->sortedTerms[i]];
+
+        for (uint32_t j = 0; j < term->count; j++) {
+            if (newIds[term->postings[j].doc] != UINT32_MAX) {
+                numLiveTerms++;
+                break;
+            }
+        }
+    }
+
+    ok = ok && appendVarint(&buffer, numLiveTerms);
+
+    //Writes front-coded terms with delta-coded postings
+    const char* previous = "";
+
+    for (uint32_t i = 0; ok && i < index->numSorted; i++) {
+        const Term* term = &index->terms[index->sortedTerms[i]];
+        uint32_t numPostings = 0;
+
+        for (uint32_t j = 0; j < term->count; j++) {
+            numPostings += newIds[term->postings[j].doc] != UINT32_MAX;
+        }
+
+        if (numPostings == 0) {
+            continue;
+        }
+
+        size_t shared = 0;
+        while (previous[shared] != '\0' && previous[shared] == term->text[shared]) {
+            shared++;
+        }
+
+        size_t suffix = strlen(term->text) - shared;
+        ok = appendVarint(&buffer, shared) && appendVarint(&buffer, suffix) && appendBuffer(&buffer, term->text + shared, suffix)
+             && appendVarint(&buffer, numPostings);
+
+        uint32_t lastDoc = 0;
+        for (uint32_t j = 0; ok && j < term->count; j++) {
+            uint32_t doc = newIds[term->postings[j].doc];
+
+            if (doc != UINT32_MAX) {
+                ok = appendVarint(&buffer, doc - lastDoc) && appendVarint(&buffer, term->postings[j].fields);
+                lastDoc = doc;
+            }
+        }
+
+        previous = term->text;
+    }
+
+    free(newIds);
+
+    if (!ok) {
+        vcFree(buffer.data);
+        return OTHER_ERROR;
+    }
+
+    //Writes the whole file at once
+    FILE* fptr = fopen(fileName, "wb");
+    if (fptr == NULL) {
+        vcFree(buffer.data);
+        return WRITE_ERROR;
+    }
+
+    size_t written = fwrite(buffer.data, 1, buffer.length, fptr);
+    int closed = fclose(fptr);
+    vcFree(buffer.data);
+
+    return (written == buffer.length && closed == 0) ? OK : WRITE_ERROR;
+}
+
+//Rebuilds an index from the contents of an index file
+static VCardErrorCode decodeIndex(const unsigned char* pos, const unsigned char* end, CardIndex* index) {
+
+    uint64_t version, numDocs, numTerms;
+
+    if (end - pos < 4 || memcmp(pos, INDEX_MAGIC, 4) != 0) {
+        return INV_FILE;
+    }
+    pos += 4;
+
+    if (!readVarint(&pos, end, &version) || version != INDEX_VERSION || !readVarint(&pos, end, &numDocs) || numDocs >= UINT32_MAX) {
+        return INV_FILE;
+    }
+
+    //Reads the file names, which are as long as they were when saved
+    for (uint64_t doc = 0; doc < numDocs; doc++) {
+        uint64_t len;
+
+        if (!readVarint(&pos, end, &len) || len > (uint64_t)(end - pos)) {
+            return INV_FILE;
+        }
+
+        char* name = copyBytes((const char*)pos, (size_t)len);
+        if (name == NULL) {
+            return OTHER_ERROR;
+        }
+
+        pos += len;
+
+        uint32_t added = addDocument(index, name);
+        free(name);
+
+        if (added != doc) {
+            return OTHER_ERROR;
+        }
+    }
+
+    if (!readVarint(&pos, end, &numTerms)) {
+        return INV_FILE;
+    }
+
+    //Reads the terms, rebuilding each one from the previous
+    char text[MAX_TOKEN + 1] = "";
+    for (uint64_t i = 0; i < numTerms; i++) {
+        uint64_t shared, suffix, numPostings;
+
+        if (!readVarint(&pos, end, &shared) || !readVarint(&pos, end, &suffix) || shared > strlen(text)
+            || shared + suffix > MAX_TOKEN || suffix > (uint64_t)(end - pos)) {
+            return INV_FILE;
+        }
+
+        memcpy(text + shared, pos, suffix);
+        text[shared + suffix] = '\0';
+        pos += suffix;
+
+        if (!readVarint(&pos, end, &numPostings)) {
+            return INV_FILE;
+        }
+
+        uint64_t doc = 0;
+        for (uint64_t j = 0; j < numPostings; j++) {
+            uint64_t delta, fields;
+
+            if (!readVarint(&pos, end, &delta) || !readVarint(&pos, end, &fields) || doc + delta >= numDocs) {
+                return INV_FILE;
+            }
+
+            doc += delta;
+
+            //Sets every field bit of the posting
+            for (int f = 0; f < NUM_FIELDS; f++) {
+                if ((fields & (1u << f)) && !addPosting(index, text, shared + suffix, (uint32_t)doc, f)) {
+                    return OTHER_ERROR;
+                }
+            }
+        }
+    }
+
+    return OK;
+}
+
+//Loads an index saved by saveCardIndex
+VCardErrorCode loadCardIndex(const char* fileName, CardIndex** index) {
+
+    if (fileName == NULL || index == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *index = NULL;
+
+    //Reads the whole file
+    FILE* fptr = fopen(fileName, "rb");
+    if (fptr == NULL) {
+        return INV_FILE;
+    }
+
+    ByteBuffer buffer = {NULL, 0, 0};
+    unsigned char chunk[65536];
+    size_t got;
+    bool ok = true;
+
+    while (ok && (got = fread(chunk, 1, sizeof(chunk), fptr)) > 0) {
+        ok = appendBuffer(&buffer, chunk, got);
+    }
+
+    fclose(fptr);
+
+    if (!ok) {
+        vcFree(buffer.data);
+        return OTHER_ERROR;
+    }
+
+    CardIndex* loaded = createCardIndex();
+    if (loaded == NULL) {
+        vcFree(buffer.data);
+        return OTHER_ERROR;
+    }
+
+    VCardErrorCode err = decodeIndex(buffer.data, buffer.data + buffer.length, loaded);
+    vcFree(buffer.data);
+
+    if (err != OK) {
+        deleteCardIndex(loaded);
+        return err;
+    }
+
+    *index = loaded;
+
+    return OK;
+}
@@ -0,0 +1,350 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCLoader.h"
+
+//Default and maximum number of reader threads
+#define DEFAULT_READERS 8
+#define MAX_READERS 64
+
+//Number of completed buffers that may wait for the parser per reader thread
+#define BUFFERS_PER_READER 4
+
+//One file read by a reader thread
+typedef struct loadedFile {
+    int             index;
+    VCardErrorCode  err;
+    char*           data;
+    size_t          length;
+} LoadedFile;
+
+//State shared between the reader threads and the parsing thread
+typedef struct loader {
+    char**          fileNames;
+    int             numFiles;
+
+    //Next file index for the readers to claim
+    atomic_int      nextIndex;
+
+    //Ring buffer of completed reads, protected by lock
+    LoadedFile*     queue;
+    int             capacity;
+    int             head;
+    int             count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  notEmpty;
+    pthread_cond_t  notFull;
+} Loader;
+
+//Reads a whole file with pread, sizing the buffer from fstat
+static VCardErrorCode readWholeFile(const char* fileName, char** data, size_t* length) {
+
+    *data = NULL;
+    *length = 0;
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return INV_FILE;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return INV_FILE;
+    }
+
+    size_t size = (size_t)info.st_size;
+    char* buffer = vcMalloc(size > 0 ? size : 1);
+    if (buffer == NULL) {
+        close(fd);
+        return OTHER_ERROR;
+    }
+
+    //Keeps reading until the whole file is in, since pread may return short counts
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = pread(fd, buffer + done, size - done, (off_t)done);
+
+        if (got < 0) {
+            vcFree(buffer);
+            close(fd);
+            return INV_FILE;
+        }
+        if (got == 0) {
+            break;
+        }
+
+        done += (size_t)got;
+    }
+
+    close(fd);
+
+    *data = buffer;
+    *length = done;
+
+    return OK;
+}
+
+//Reader thread: claims files, reads them and queues the buffers for the parser
+static void* readerMain(void* arg) {
+
+    Loader* loader = (Loader*)arg;
+    int index;
+
+    while ((index = atomic_fetch_add(&loader->nextIndex, 1)) < loader->numFiles) {
+        LoadedFile file = {index, OK, NULL, 0};
+        file.err = readWholeFile(loader->fileNames[index], &file.data, &file.length);
+
+        //Waits for room in the queue, which bounds the memory held by unparsed buffers
+        pthread_mutex_lock(&loader->lock);
+
+        while (loader->count == loader->capacity) {
+            pthread_cond_wait(&loader->notFull, &loader->lock);
+        }
+
+        loader->queue[(loader->head + loader->count) % loader->capacity] = file;
+        loader->count++;
+
+        pthread_cond_signal(&loader->notEmpty);
+        pthread_mutex_unlock(&loader->lock);
+    }
+
+    return NULL;
+}
+
+//Reads and parses many files, overlapping I/O with parsing
+VCardErrorCode loadCards(char** fileNames, int numFiles, int numThreads, CardLoadCallback callback, void* context) {
+
+    if (fileNames == NULL || numFiles < 0 || numThreads < 0 || callback == NULL) {
+        return OTHER_ERROR;
+    }
+
+    if (numFiles == 0) {
+        return OK;
+    }
+
+    //Never starts more readers than there are files
+    if (numThreads == 0) {
+        numThreads = DEFAULT_READERS;
+    }
+    if (numThreads > MAX_READERS) {
+        numThreads = MAX_READERS;
+    }
+    if (numThreads > numFiles) {
+        numThreads = numFiles;
+    }
+
+    Loader loader;
+    loader.fileNames = fileNames;
+    loader.numFiles = numFiles;
+    atomic_init(&loader.nextIndex, 0);
+    loader.capacity = numThreads * BUFFERS_PER_READER;
+    loader.head = 0;
+    loader.count = 0;
+    loader.queue = malloc(loader.capacity * sizeof(LoadedFile));
+
+    if (loader.queue == NULL) {
+        return OTHER_ERROR;
+    }
+
+    pthread_mutex_init(&loader.lock, NULL);
+    pthread_cond_init(&loader.notEmpty, NULL);
+    pthread_cond_init(&loader.notFull, NULL);
+
+    //Starts the readers
+    pthread_t threads[MAX_READERS];
+    int started = 0;
+
+    for (int i = 0; i < numThreads; i++) {
+        if (pthread_create(&threads[i], NULL, readerMain, &loader) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    VCardErrorCode result = OK;
+
+    //Without any reader nothing would ever be delivered
+    if (started == 0) {
+        result = OTHER_ERROR;
+    }
+
+    //Parses buffers in completion order until every file has been delivered
+    for (int delivered = 0; started > 0 && delivered < numFiles; delivered++) {
+        pthread_mutex_lock(&loader.lock);
+
+        while (loader.count == 0) {
+            pthread_cond_wait(&loader.notEmpty, &loader.lock);
+        }
+
+        LoadedFile file = loader.queue[loader.head];
+        loader.head = (loader.head + 1) % loader.capacity;
+        loader.count--;
+
+        pthread_cond_signal(&loader.notFull);
+        pthread_mutex_unlock(&loader.lock);
+
+        Card* card = NULL;
+
+        if (file.err == OK) {
+            file.err = createCardFromBuffer(file.data, file.length, &card);
+        }
+
+        vcFree(file.data);
+
+        callback(file.index, fileNames[file.index], file.err, card, context);
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&loader.notFull);
+    pthread_cond_destroy(&loader.notEmpty);
+    pthread_mutex_destroy(&loader.lock);
+    free(loader.queue);
+
+    return result;
+}
+
+//Size of the buffer handed to each getdents64 call
+#define DIRENT_BUFFER_SIZE (64 * 1024)
+
+//Checks whether a file name ends in .vcf or .vcf.gz
+static bool hasCardExtension(const char* name) {
+
+    size_t length = strlen(name);
+
+    return (length > 4 && strcmp(name + length - 4, ".vcf") == 0)
+        || (length > 7 && strcmp(name + length - 7, ".vcf.gz") == 0);
+}
+
+//Fills in the size and modification time of a directory entry
+static bool statEntry(int dirFd, const char* name, CardFileEntry* entry) {
+
+    struct statx info;
+
+    //Uses statx where the kernel has it, fstatat otherwise
+    if (statx(dirFd, name, 0, STATX_TYPE | STATX_SIZE | STATX_MTIME, &info) == 0) {
+        if (!S_ISREG(info.stx_mode)) {
+            return false;
+        }
+
+        entry->size = (int64_t)info.stx_size;
+        entry->mtimeSec = info.stx_mtime.tv_sec;
+        entry->mtimeNsec = (int32_t)info.stx_mtime.tv_nsec;
+        return true;
+    }
+
+    struct stat fallback;
+
+    if (errno != ENOSYS || fstatat(dirFd, name, &fallback, 0) != 0 || !S_ISREG(fallback.st_mode)) {
+        return false;
+    }
+
+    entry->size = (int64_t)fallback.st_size;
+    entry->mtimeSec = fallback.st_mtim.tv_sec;
+    entry->mtimeNsec = (int32_t)fallback.st_mtim.tv_nsec;
+    return true;
+}
+
+//Lists the .vcf and .vcf.gz files of a directory with their sizes and modification times
+VCardErrorCode scanCardDirectory(const char* dirPath, CardFileEntry** entries, int* count) {
+
+    if (dirPath == NULL || entries == NULL || count == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *entries = NULL;
+    *count = 0;
+
+    int dirFd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return INV_FILE;
+    }
+
+    char* buffer = malloc(DIRENT_BUFFER_SIZE);
+    if (buffer == NULL) {
+        close(dirFd);
+        return OTHER_ERROR;
+    }
+
+    CardFileEntry* list = NULL;
+    int length = 0;
+    int capacity = 0;
+    VCardErrorCode err = OK;
+    ssize_t got;
+
+    //Reads the directory in large batches until it is exhausted
+    while (err == OK && (got = getdents64(dirFd, buffer, DIRENT_BUFFER_SIZE)) > 0) {
+
+        for (ssize_t pos = 0; pos < got; ) {
+            struct dirent64* dent = (struct dirent64*)(buffer + pos);
+            pos += dent->d_reclen;
+
+            //Filters on the name and the type hint before paying for a stat
+            if (!hasCardExtension(dent->d_name) || strlen(dent->d_name) >= sizeof(list->name)) {
+                continue;
+            }
+            if (dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN) {
+                continue;
+            }
+
+            //Grows the array geometrically
+            if (length == capacity) {
+                int newCapacity = capacity ? capacity * 2 : 64;
+                CardFileEntry* newList = realloc(list, newCapacity * sizeof(CardFileEntry));
+
+                if (newList == NULL) {
+                    err = OTHER_ERROR;
+                    break;
+                }
+
+                list = newList;
+                capacity = newCapacity;
+            }
+
+            CardFileEntry* entry = &list[length];
+            memset(entry, 0, sizeof(CardFileEntry));
+            strcpy(entry->name, dent->d_name);
+
+            if (statEntry(dirFd, dent->d_name, entry)) {
+                length++;
+            }
+        }
+    }
+
+    if (err == OK && got < 0) {
+        err = INV_FILE;
+    }
+
+    free(buffer);
+    close(dirFd);
+
+    if (err != OK) {
+        free(list);
+        return err;
+    }
+
+    *entries = list;
+    *count = length;
+
+    return OK;
+}
+
+//Releases an array created by scanCardDirectory
+void deleteCardDirectory(CardFileEntry* entries) {
+
+    free(entries);
+}
@@ -0,0 +1,71 @@
+#include <string.h>
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCMatch.h"
+
+//FNV-1a offset basis and prime
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+//Feeds a string into an FNV-1a hash, optionally ASCII case-folded
+static uint64_t hashString(uint64_t hash, const char* str, bool fold) {
+
+    for (const unsigned char* c = (const unsigned char*)(str ? str : ""); *c != '\0'; c++) {
+        unsigned char byte = (fold && *c >= 'a' && *c <= 'z') ? (unsigned char)(*c - ('a' - 'A')) : *c;
+        hash ^= byte;
+        hash *= FNV_PRIME;
+    }
+
+    //Terminates each field so "ab","c" and "a","bc" differ
+    hash ^= 0x1f;
+    hash *= FNV_PRIME;
+
+    return hash;
+}
+
+//Hashes a property's name and group
+uint64_t hashPropertyName(const Property* prop) {
+
+    return hashString(hashString(FNV_OFFSET, prop->name, true), prop->group, true);
+}
+
+//Hashes a property's values onto the hash of its name and group
+uint64_t hashPropertyContent(const Property* prop, uint64_t nameHash) {
+
+    uint64_t hash = nameHash;
+
+    ListIterator valIter = createIterator(prop->values);
+    char* value;
+
+    while ((value = nextElement(&valIter)) != NULL) {
+        hash = hashString(hash, value, false);
+    }
+
+    return hash;
+}
+
+//Checks whether two properties have the same name and group
+bool samePropertyName(const Property* a, const Property* b) {
+
+    return strcasecmp(a->name, b->name) == 0 && strcasecmp(a->group ? a->group : "", b->group ? b->group : "") == 0;
+}
+
+//Checks whether two properties have the same name, group and values
+bool samePropertyContent(const Property* a, const Property* b) {
+
+    if (!samePropertyName(a, b)) {
+        return false;
+    }
+
+    Node* x = a->values != NULL ? a->values->head : NULL;
+    Node* y = b->values != NULL ? b->values->head : NULL;
+
+    while (x != NULL && y != NULL && strcmp((char*)x->data, (char*)y->data) == 0) {
+        x = x->next;
+        y = y->next;
+    }
+
+    return x == NULL && y == NULL;
+}
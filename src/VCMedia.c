@@ -0,0 +1,853 @@
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCMedia.h"
+
+//Bytes decoded at a time by writeCardMedia
+#define MEDIA_CHUNK_SIZE (64 * 1024)
+
+//Value of every base64 character, from either the standard or the URL-safe alphabet, and 0xff
+//for every other byte, so one OR of four lookups tells whether a whole quad is valid
+static const unsigned char base64Values[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0x3e, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+//Returns the value of the first parameter with the given name, or NULL
+static const char* findParameter(const Property* prop, const char* name) {
+
+    if (prop->parameters == NULL) {
+        return NULL;
+    }
+
+    for (Node* node = prop->parameters->head; node != NULL; node = node->next) {
+        Parameter* param = node->data;
+
+        if (param->name != NULL && strcasecmp(param->name, name) == 0) {
+            return param->value;
+        }
+    }
+
+    return NULL;
+}
+
+//Locates the encoded binary data of a property
+bool findCardMedia(const Property* prop, CardMedia* media) {
+
+    if (prop == NULL || media == NULL || prop->values == NULL || prop->values->head == NULL) {
+        return false;
+    }
+
+    memset(media, 0, sizeof(CardMedia));
+
+    const char* first = prop->values->head->data;
+    const char* encoding = findParameter(prop, "ENCODING");
+
+    if (first == NULL) {
+        return false;
+    }
+
+    //vCard 3.0 and 2.1 style, with the data as the whole value
+    if (encoding != NULL && (strcasecmp(encoding, "b") == 0 || strcasecmp(encoding, "BASE64") == 0
+        || strcasecmp(encoding, "QUOTED-PRINTABLE") == 0)) {
+
+        const char* mediaType = findParameter(prop, "MEDIATYPE");
+
+        if (mediaType == NULL) {
+            mediaType = findParameter(prop, "TYPE");
+        }
+
+        media->encoding = strcasecmp(encoding, "QUOTED-PRINTABLE") == 0 ? MEDIA_QUOTED_PRINTABLE : MEDIA_BASE64;
+        media->mediaType = mediaType != NULL ? mediaType : "";
+        media->data = first;
+    }
+    //vCard 4.0 style data: URI.  The parser splits values at semicolons, so the URI's media
+    //type is the first value and ";base64," starts a later one
+    else if (strncasecmp(first, "data:", 5) == 0) {
+        for (Node* node = prop->values->head->next; node != NULL; node = node->next) {
+            if (node->data != NULL && strncasecmp(node->data, "base64,", 7) == 0) {
+                media->data = (char*)node->data + 7;
+                break;
+            }
+        }
+
+        if (media->data == NULL) {
+            return false;
+        }
+
+        media->encoding = MEDIA_BASE64;
+        media->mediaType = first + 5;
+    }
+    else {
+        return false;
+    }
+
+    media->length = strlen(media->data);
+    media->maxSize = media->encoding == MEDIA_BASE64 ? (media->length + 3) / 4 * 3 : media->length;
+
+    return true;
+}
+
+//Gathers the next quad of base64 characters, skipping whitespace and allowing for padding
+//and a missing final padding, and leaves its bytes in media->pending
+static void decodeBase64Quad(CardMedia* media) {
+
+    const unsigned char* data = (const unsigned char*)media->data;
+    unsigned char values[4] = {0, 0, 0, 0};
+    int count = 0;
+    int padding = 0;
+
+    while (count < 4 && media->position < media->length) {
+        unsigned char ch = data[media->position++];
+
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            continue;
+        }
+
+        if (ch == '=' && count >= 2) {
+            padding++;
+            count++;
+        }
+        else if (base64Values[ch] < 64 && padding == 0) {
+            values[count++] = base64Values[ch];
+        }
+        else {
+            media->invalid = true;
+            media->finished = true;
+            return;
+        }
+    }
+
+    //A quad of one character, or padding that does not end the quad, cannot be decoded
+    if (count == 1 || (padding > 0 && count < 4)) {
+        media->invalid = true;
+    }
+
+    //Padding, or running out of text, ends the data
+    if (count < 4 || padding > 0) {
+        media->finished = true;
+    }
+
+    if (count < 2 || media->invalid) {
+        return;
+    }
+
+    media->pending[0] = (unsigned char)(values[0] << 2 | values[1] >> 4);
+    media->pending[1] = (unsigned char)(values[1] << 4 | values[2] >> 2);
+    media->pending[2] = (unsigned char)(values[2] << 6 | values[3]);
+    media->numPending = (count < 4 ? count : 4 - padding) - 1;
+}
+
+//Decodes base64 text into a buffer
+static size_t readBase64(CardMedia* media, unsigned char* out, size_t size) {
+
+    const unsigned char* data = (const unsigned char*)media->data;
+    size_t produced = 0;
+
+    while (produced < size) {
+
+        //Bytes left over from a quad that did not fit go out first
+        if (media->numPending > 0) {
+            size_t count = size - produced < (size_t)media->numPending ? size - produced : (size_t)media->numPending;
+            size_t start = 3 - media->numPending;
+
+            //pending is kept right-aligned, so the next byte is at 3 - numPending
+            memcpy(out + produced, media->pending + start, count);
+            produced += count;
+            media->numPending -= (int)count;
+            continue;
+        }
+
+        if (media->finished) {
+            break;
+        }
+
+        //Fast path: a quad of four valid characters decodes straight into the buffer
+        size_t pos = media->position;
+
+        if (size - produced >= 3 && pos + 4 <= media->length) {
+            unsigned a = base64Values[data[pos]];
+            unsigned b = base64Values[data[pos + 1]];
+            unsigned c = base64Values[data[pos + 2]];
+            unsigned d = base64Values[data[pos + 3]];
+
+            if ((a | b | c | d) < 64) {
+                out[produced] = (unsigned char)(a << 2 | b >> 4);
+                out[produced + 1] = (unsigned char)(b << 4 | c >> 2);
+                out[produced + 2] = (unsigned char)(c << 6 | d);
+                produced += 3;
+                media->position += 4;
+                continue;
+            }
+        }
+
+        //Slow path: whitespace, padding, the end of the text or too little room
+        decodeBase64Quad(media);
+
+        //Right-aligns the decoded bytes for the code above
+        if (media->numPending > 0 && media->numPending < 3) {
+            memmove(media->pending + 3 - media->numPending, media->pending, media->numPending);
+        }
+    }
+
+    return produced;
+}
+
+//Returns the value of a hexadecimal digit, or -1
+static int hexValue(unsigned char ch) {
+
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+
+    return -1;
+}
+
+//Decodes quoted-printable text into a buffer
+static size_t readQuotedPrintable(CardMedia* media, unsigned char* out, size_t size) {
+
+    const unsigned char* data = (const unsigned char*)media->data;
+    size_t produced = 0;
+
+    while (produced < size && media->position < media->length) {
+        size_t pos = media->position;
+
+        //Runs of literal bytes are copied in one go
+        if (data[pos] != '=') {
+            const unsigned char* equals = memchr(data + pos, '=', media->length - pos);
+            size_t run = (equals != NULL ? (size_t)(equals - data) : media->length) - pos;
+
+            if (run > size - produced) {
+                run = size - produced;
+            }
+
+            memcpy(out + produced, data + pos, run);
+            produced += run;
+            media->position += run;
+            continue;
+        }
+
+        //A final = is a soft line break left over from unfolding
+        if (pos + 1 == media->length) {
+            media->position++;
+            break;
+        }
+
+        int high = pos + 2 < media->length ? hexValue(data[pos + 1]) : -1;
+        int low = pos + 2 < media->length ? hexValue(data[pos + 2]) : -1;
+
+        if (high < 0 || low < 0) {
+            media->invalid = true;
+            media->position = media->length;
+            break;
+        }
+
+        out[produced++] = (unsigned char)(high << 4 | low);
+        media->position += 3;
+    }
+
+    return produced;
+}
+
+//Decodes the next part of the data
+size_t readCardMedia(CardMedia* media, void* buffer, size_t size) {
+
+    if (media == NULL || media->data == NULL || buffer == NULL || media->invalid) {
+        return 0;
+    }
+
+    if (media->encoding == MEDIA_QUOTED_PRINTABLE) {
+        return readQuotedPrintable(media, buffer, size);
+    }
+
+    return readBase64(media, buffer, size);
+}
+
+//Decodes the data into a stream
+VCardErrorCode writeCardMedia(CardMedia* media, FILE* fptr) {
+
+    if (media == NULL || fptr == NULL) {
+        return WRITE_ERROR;
+    }
+
+    unsigned char* buffer = malloc(MEDIA_CHUNK_SIZE);
+    if (buffer == NULL) {
+        return OTHER_ERROR;
+    }
+
+    VCardErrorCode err = OK;
+    size_t count;
+
+    while ((count = readCardMedia(media, buffer, MEDIA_CHUNK_SIZE)) > 0) {
+        if (fwrite(buffer, 1, count, fptr) != count) {
+            err = WRITE_ERROR;
+            break;
+        }
+    }
+
+    free(buffer);
+
+    if (err == OK && media->invalid) {
+        err = INV_PROP;
+    }
+
+    return err;
+}
+
+//Longest property name and parameters scanCardMedia keeps; longer ones cannot be media
+#define MEDIA_HEADER_LIMIT 4096
+
+//Longest "data:<type>;base64," prefix scanCardMedia recognizes
+#define MEDIA_PREFIX_LIMIT 256
+
+//Where scanCardMedia is within the current line
+typedef enum scanState {SCAN_LINE_START, SCAN_HEADER, SCAN_PREFIX, SCAN_DATA, SCAN_SKIP} ScanState;
+
+//State of a scanCardMedia pass over a file
+typedef struct mediaScan {
+    ScanState       state;
+
+    //State of the logical line a continuation line adds to
+    ScanState       lineState;
+
+    //The next physical line continues a quoted-printable soft line break
+    bool            softBreak;
+
+    //Name and parameters of the current property, and the start of a data: URI
+    char            header[MEDIA_HEADER_LIMIT + 1];
+    size_t          headerLength;
+    bool            inQuotes;
+    char            prefix[MEDIA_PREFIX_LIMIT + 1];
+    size_t          prefixLength;
+
+    //Decoder state carried from one chunk of the file to the next
+    unsigned char   quad[4];
+    int             quadCount;
+    int             padding;
+    int             qpCount;
+    unsigned char   qpDigits[2];
+    bool            done;
+
+    //Decoded bytes waiting for the sink
+    unsigned char*  out;
+    size_t          outLength;
+
+    CardMediaInfo   info;
+    int             numBegins;
+    bool            stopped;
+    bool            (*sink)(const CardMediaInfo* media, const void* bytes, size_t length, void* context);
+    void*           context;
+} MediaScan;
+
+//Hands the decoded bytes to the sink
+static void flushMedia(MediaScan* scan) {
+
+    if (scan->outLength > 0 && !scan->stopped) {
+        scan->stopped = !scan->sink(&scan->info, scan->out, scan->outLength, scan->context);
+    }
+
+    scan->outLength = 0;
+}
+
+//Adds decoded bytes to the output, flushing it when full
+static void emitMedia(MediaScan* scan, const unsigned char* bytes, size_t length) {
+
+    if (scan->outLength + length > MEDIA_CHUNK_SIZE) {
+        flushMedia(scan);
+    }
+
+    memcpy(scan->out + scan->outLength, bytes, length);
+    scan->outLength += length;
+}
+
+//Marks the current media as not validly encoded and stops decoding it
+static void invalidateMedia(MediaScan* scan) {
+
+    scan->info.invalid = true;
+    scan->done = true;
+}
+
+//Decodes a run of base64 text, keeping a partial quad for the next run
+static void scanBase64(MediaScan* scan, const unsigned char* data, size_t length) {
+
+    size_t pos = 0;
+
+    while (pos < length && !scan->done && !scan->stopped) {
+
+        //Fast path: whole quads of four valid characters, as in readBase64
+        if (scan->quadCount == 0) {
+            while (pos + 4 <= length) {
+                unsigned a = base64Values[data[pos]];
+                unsigned b = base64Values[data[pos + 1]];
+                unsigned c = base64Values[data[pos + 2]];
+                unsigned d = base64Values[data[pos + 3]];
+
+                if ((a | b | c | d) >= 64) {
+                    break;
+                }
+
+                if (scan->outLength + 3 > MEDIA_CHUNK_SIZE) {
+                    flushMedia(scan);
+                }
+
+                unsigned char* out = scan->out + scan->outLength;
+                out[0] = (unsigned char)(a << 2 | b >> 4);
+                out[1] = (unsigned char)(b << 4 | c >> 2);
+                out[2] = (unsigned char)(c << 6 | d);
+                scan->outLength += 3;
+                pos += 4;
+            }
+
+            if (pos == length) {
+                break;
+            }
+        }
+
+        //Slow path: one character at a time, skipping whitespace and allowing for padding
+        unsigned char ch = data[pos++];
+
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            continue;
+        }
+
+        if (ch == '=' && scan->quadCount >= 2) {
+            scan->padding++;
+            scan->quad[scan->quadCount++] = 0;
+        }
+        else if (base64Values[ch] < 64 && scan->padding == 0) {
+            scan->quad[scan->quadCount++] = base64Values[ch];
+        }
+        else {
+            invalidateMedia(scan);
+            break;
+        }
+
+        if (scan->quadCount == 4) {
+            unsigned char bytes[3] = {
+                (unsigned char)(scan->quad[0] << 2 | scan->quad[1] >> 4),
+                (unsigned char)(scan->quad[1] << 4 | scan->quad[2] >> 2),
+                (unsigned char)(scan->quad[2] << 6 | scan->quad[3])
+            };
+
+            emitMedia(scan, bytes, 3 - scan->padding);
+            scan->quadCount = 0;
+
+            //Padding ends the data
+            if (scan->padding > 0) {
+                scan->done = true;
+            }
+        }
+    }
+}
+
+//Decodes a run of quoted-printable text, keeping a split escape for the next run
+static void scanQuotedPrintable(MediaScan* scan, const unsigned char* data, size_t length) {
+
+    size_t pos = 0;
+
+    while (pos < length && !scan->done && !scan->stopped) {
+        unsigned char ch = data[pos++];
+
+        //Line ends are never data; a CR or LF in the content is encoded as =0D or =0A
+        if (ch == '\r' || ch == '\n') {
+            continue;
+        }
+
+        if (scan->qpCount == 0) {
+            if (ch == '=') {
+                scan->qpCount = 1;
+            }
+            else {
+                emitMedia(scan, &ch, 1);
+            }
+            continue;
+        }
+
+        if (hexValue(ch) < 0) {
+            invalidateMedia(scan);
+            break;
+        }
+
+        scan->qpDigits[scan->qpCount++ - 1] = ch;
+
+        if (scan->qpCount == 3) {
+            unsigned char byte = (unsigned char)(hexValue(scan->qpDigits[0]) << 4 | hexValue(scan->qpDigits[1]));
+
+            emitMedia(scan, &byte, 1);
+            scan->qpCount = 0;
+        }
+    }
+}
+
+//Ends the current media, decoding what is left and telling the sink
+static void endMedia(MediaScan* scan) {
+
+    if (scan->info.encoding == MEDIA_BASE64 && !scan->done) {
+
+        //A missing final padding is allowed; a single leftover character, or padding that
+        //does not end the quad, cannot be decoded
+        if (scan->quadCount == 1 || scan->padding > 0) {
+            invalidateMedia(scan);
+        }
+        else if (scan->quadCount > 1) {
+            unsigned char bytes[2] = {
+                (unsigned char)(scan->quad[0] << 2 | scan->quad[1] >> 4),
+                (unsigned char)(scan->quad[1] << 4 | (scan->quadCount > 2 ? scan->quad[2] : 0) >> 2)
+            };
+
+            emitMedia(scan, bytes, scan->quadCount - 1);
+        }
+    }
+
+    //A final = is a soft line break; a cut-off escape is not
+    if (scan->info.encoding == MEDIA_QUOTED_PRINTABLE && scan->qpCount > 1) {
+        invalidateMedia(scan);
+    }
+
+    flushMedia(scan);
+
+    if (!scan->stopped) {
+        scan->stopped = !scan->sink(&scan->info, NULL, 0, scan->context);
+    }
+
+    scan->info.mediaIndex++;
+}
+
+//Starts decoding a property's value with the given encoding
+static void beginMedia(MediaScan* scan, MediaEncoding encoding) {
+
+    scan->info.encoding = encoding;
+    scan->info.invalid = false;
+    scan->quadCount = 0;
+    scan->padding = 0;
+    scan->qpCount = 0;
+    scan->done = false;
+    scan->outLength = 0;
+    scan->state = SCAN_DATA;
+}
+
+//Strips the quotes from a parameter value
+static char* unquote(char* value) {
+
+    size_t len = strlen(value);
+
+    if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
+        value[len - 1] = '\0';
+        return value + 1;
+    }
+
+    return value;
+}
+
+//Reads the name and parameters of a property once its colon is met, and picks what to do
+//with its value
+static void parseMediaHeader(MediaScan* scan) {
+
+    char* header = scan->header;
+    header[scan->headerLength] = '\0';
+
+    const char* encoding = NULL;
+    const char* mediaType = NULL;
+    const char* type = NULL;
+    bool quoted = false;
+    char* token = header;
+
+    //Splits at the semicolons outside quotes, naming the property from the first token
+    for (char* ptr = header; ; ptr++) {
+        if (*ptr == '"') {
+            quoted = !quoted;
+            continue;
+        }
+
+        if ((*ptr != ';' || quoted) && *ptr != '\0') {
+            continue;
+        }
+
+        bool last = *ptr == '\0';
+        *ptr = '\0';
+
+        if (token == header) {
+            char* dot = strchr(header, '.');
+            scan->info.name = dot != NULL ? dot + 1 : header;
+        }
+        else {
+            char* equals = strchr(token, '=');
+
+            if (equals != NULL) {
+                *equals = '\0';
+
+                if (strcasecmp(token, "ENCODING") == 0) {
+                    encoding = unquote(equals + 1);
+                }
+                else if (strcasecmp(token, "MEDIATYPE") == 0) {
+                    mediaType = unquote(equals + 1);
+                }
+                else if (strcasecmp(token, "TYPE") == 0 && type == NULL) {
+                    type = unquote(equals + 1);
+                }
+            }
+        }
+
+        if (last) {
+            break;
+        }
+
+        token = ptr + 1;
+    }
+
+    if (strcasecmp(scan->info.name, "BEGIN") == 0) {
+        scan->numBegins++;
+    }
+
+    scan->info.cardIndex = scan->numBegins - 1;
+    scan->info.mediaType = mediaType != NULL ? mediaType : (type != NULL ? type : "");
+
+    //The same encodings as findCardMedia, or else a possible data: URI
+    if (encoding != NULL && (strcasecmp(encoding, "b") == 0 || strcasecmp(encoding, "BASE64") == 0)) {
+        beginMedia(scan, MEDIA_BASE64);
+    }
+    else if (encoding != NULL && strcasecmp(encoding, "QUOTED-PRINTABLE") == 0) {
+        beginMedia(scan, MEDIA_QUOTED_PRINTABLE);
+    }
+    else {
+        scan->prefixLength = 0;
+        scan->state = SCAN_PREFIX;
+    }
+}
+
+//Checks the start of a value for "data:<type>;base64,", returning false once it cannot match
+static bool scanPrefix(MediaScan* scan, unsigned char ch) {
+
+    if (ch == '\r') {
+        return true;
+    }
+
+    if (scan->prefixLength == MEDIA_PREFIX_LIMIT) {
+        return false;
+    }
+
+    scan->prefix[scan->prefixLength++] = (char)ch;
+
+    if (scan->prefixLength <= 5) {
+        return strncasecmp(scan->prefix, "data:", scan->prefixLength) == 0;
+    }
+
+    if (ch != ',') {
+        return true;
+    }
+
+    //Found the comma: the URI is media only if its type ends in ;base64
+    scan->prefix[scan->prefixLength - 1] = '\0';
+    char* base64 = scan->prefixLength >= 13 ? scan->prefix + scan->prefixLength - 8 : NULL;
+
+    if (base64 == NULL || strcasecmp(base64, ";base64") != 0) {
+        return false;
+    }
+
+    *base64 = '\0';
+    scan->info.mediaType = scan->prefix + 5;
+    beginMedia(scan, MEDIA_BASE64);
+
+    return true;
+}
+
+//Ends the logical line that was being read
+static void endLogicalLine(MediaScan* scan) {
+
+    if (scan->lineState == SCAN_DATA) {
+        endMedia(scan);
+    }
+
+    scan->lineState = SCAN_SKIP;
+    scan->headerLength = 0;
+    scan->inQuotes = false;
+    scan->softBreak = false;
+}
+
+//Runs a chunk of the file through the scan
+static void scanChunk(MediaScan* scan, const unsigned char* data, size_t length) {
+
+    size_t pos = 0;
+
+    while (pos < length && !scan->stopped) {
+        const unsigned char* end;
+
+        switch (scan->state) {
+            case SCAN_LINE_START:
+                //Folding whitespace, or a quoted-printable soft break, continues the line
+                if (scan->softBreak && scan->lineState == SCAN_DATA) {
+                    scan->softBreak = false;
+                    scan->state = SCAN_DATA;
+                }
+                else if (data[pos] == ' ' || data[pos] == '\t') {
+                    pos++;
+                    scan->state = scan->lineState;
+                }
+                else {
+                    endLogicalLine(scan);
+
+                    if (data[pos] == '\r' || data[pos] == '\n') {
+                        pos++;
+                    }
+                    else {
+                        scan->state = SCAN_HEADER;
+                        scan->lineState = SCAN_HEADER;
+                    }
+                }
+                break;
+
+            case SCAN_HEADER: {
+                unsigned char ch = data[pos++];
+
+                if (ch == '\n') {
+                    scan->state = SCAN_LINE_START;
+                }
+                else if (ch == ':' && !scan->inQuotes) {
+                    parseMediaHeader(scan);
+                    scan->lineState = scan->state;
+                }
+                else if (ch != '\r') {
+                    if (ch == '"') {
+                        scan->inQuotes = !scan->inQuotes;
+                    }
+
+                    //Too long a header is not media; the rest of the line is skipped
+                    if (scan->headerLength == MEDIA_HEADER_LIMIT) {
+                        scan->state = SCAN_SKIP;
+                        scan->lineState = SCAN_SKIP;
+                    }
+                    else {
+                        scan->header[scan->headerLength++] = (char)ch;
+                    }
+                }
+                break;
+            }
+
+            case SCAN_PREFIX: {
+                unsigned char ch = data[pos++];
+
+                if (ch == '\n') {
+                    scan->state = SCAN_LINE_START;
+                }
+                else if (!scanPrefix(scan, ch)) {
+                    scan->state = SCAN_SKIP;
+                }
+
+                scan->lineState = scan->state == SCAN_LINE_START ? SCAN_PREFIX : scan->state;
+                break;
+            }
+
+            case SCAN_DATA:
+                end = memchr(data + pos, '\n', length - pos);
+
+                if (scan->info.encoding == MEDIA_QUOTED_PRINTABLE) {
+                    scanQuotedPrintable(scan, data + pos, (end != NULL ? (size_t)(end - data) : length) - pos);
+                }
+                else {
+                    scanBase64(scan, data + pos, (end != NULL ? (size_t)(end - data) : length) - pos);
+                }
+
+                if (end == NULL) {
+                    pos = length;
+                    break;
+                }
+
+                //A = left at the end of a quoted-printable line joins it to the next one
+                if (scan->info.encoding == MEDIA_QUOTED_PRINTABLE && scan->qpCount == 1) {
+                    scan->qpCount = 0;
+                    scan->softBreak = true;
+                }
+
+                pos = (size_t)(end - data) + 1;
+                scan->state = SCAN_LINE_START;
+                break;
+
+            case SCAN_SKIP:
+                end = memchr(data + pos, '\n', length - pos);
+                pos = end != NULL ? (size_t)(end - data) + 1 : length;
+
+                if (end != NULL) {
+                    scan->state = SCAN_LINE_START;
+                }
+                break;
+        }
+    }
+}
+
+//Decodes every embedded media property of a file without building a Card
+VCardErrorCode scanCardMedia(const char* fileName, bool (*sink)(const CardMediaInfo* media, const void* bytes, size_t length, void* context),
+                             void* context) {
+
+    if (fileName == NULL || sink == NULL) {
+        return INV_FILE;
+    }
+
+    FILE* fptr = fopen(fileName, "rb");
+    if (fptr == NULL) {
+        return INV_FILE;
+    }
+
+    MediaScan* scan = malloc(sizeof(MediaScan));
+    unsigned char* input = malloc(MEDIA_CHUNK_SIZE);
+    unsigned char* output = malloc(MEDIA_CHUNK_SIZE);
+
+    if (scan == NULL || input == NULL || output == NULL) {
+        free(scan);
+        free(input);
+        free(output);
+        fclose(fptr);
+        return OTHER_ERROR;
+    }
+
+    memset(scan, 0, sizeof(MediaScan));
+    scan->state = SCAN_LINE_START;
+    scan->lineState = SCAN_SKIP;
+    scan->out = output;
+    scan->sink = sink;
+    scan->context = context;
+
+    size_t count;
+
+    while (!scan->stopped && (count = fread(input, 1, MEDIA_CHUNK_SIZE, fptr)) > 0) {
+        scanChunk(scan, input, count);
+    }
+
+    VCardErrorCode err = ferror(fptr) ? INV_FILE : OK;
+
+    //The file may end inside a value
+    if (!scan->stopped) {
+        endLogicalLine(scan);
+    }
+
+    if (scan->stopped) {
+        err = WRITE_ERROR;
+    }
+
+    free(scan);
+    free(input);
+    free(output);
+    fclose(fptr);
+
+    return err;
+}
@@ -0,0 +1,366 @@
+#include <stdint.h>
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCMatch.h"
+#include "VCMerge.h"
+
+//Properties a valid card holds at most once
+static const char* singleNames[] = {"N", "KIND", "GENDER", "UID", "REV", "PRODID"};
+#define NUM_SINGLE_NAMES (sizeof(singleNames) / sizeof(singleNames[0]))
+
+//One merged property, found by the hash of its name, group and values
+typedef struct mergeSlot {
+    uint64_t    hash;
+    Property*   prop;
+} MergeSlot;
+
+//State of one merge
+typedef struct merger {
+    Card*       card;
+    MergePolicy policy;
+
+    //Open-addressing table of merged properties
+    MergeSlot*  slots;
+    size_t      numSlots;
+
+    //Node holding each single-instance property, if any
+    Node*       singles[NUM_SINGLE_NAMES];
+} Merger;
+
+//Copies a possibly NULL string, treating NULL as ""
+static char* copyString(const char* str) {
+
+    if (str == NULL) {
+        str = "";
+    }
+
+    char* copy = vcMalloc(strlen(str) + 1);
+    if (copy != NULL) {
+        strcpy(copy, str);
+    }
+
+    return copy;
+}
+
+//Copies a parameter
+static Parameter* copyParameter(const Parameter* param) {
+
+    return createParameter(param->name, param->value);
+}
+
+//Copies a property with all of its parameters and values
+static Property* copyProperty(const Property* prop) {
+
+    Property* copy = createProperty(prop->name, prop->group);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    bool ok = true;
+
+    ListIterator paramIter = createIterator(prop->parameters);
+    Parameter* param;
+
+    while (ok && (param = nextElement(&paramIter)) != NULL) {
+        Parameter* paramCopy = copyParameter(param);
+        ok = paramCopy != NULL;
+
+        if (ok) {
+            insertBack(copy->parameters, paramCopy);
+        }
+    }
+
+    ListIterator valIter = createIterator(prop->values);
+    char* value;
+
+    while (ok && (value = nextElement(&valIter)) != NULL) {
+        char* valueCopy = copyString(value);
+        ok = valueCopy != NULL;
+
+        if (ok) {
+            insertBack(copy->values, valueCopy);
+        }
+    }
+
+    if (!ok) {
+        deleteProperty(copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+//Copies a DateTime
+static DateTime* copyDate(const DateTime* dt) {
+
+    DateTime* copy = vcMalloc(sizeof(DateTime));
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    copy->UTC = dt->UTC;
+    copy->isText = dt->isText;
+    copy->date = copyString(dt->date);
+    copy->time = copyString(dt->time);
+    copy->text = copyString(dt->text);
+
+    if (copy->date == NULL || copy->time == NULL || copy->text == NULL) {
+        deleteDate(copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+//Adds the parameters of a repeated property that the kept copy lacks
+static bool mergeParameters(Property* kept, const Property* repeat) {
+
+    ListIterator paramIter = createIterator(repeat->parameters);
+    Parameter* param;
+
+    while ((param = nextElement(&paramIter)) != NULL) {
+        ListIterator keptIter = createIterator(kept->parameters);
+        Parameter* other;
+        bool present = false;
+
+        while (!present && (other = nextElement(&keptIter)) != NULL) {
+            present = compareParameters(other, param) == 0;
+        }
+
+        if (present) {
+            continue;
+        }
+
+        Parameter* copy = copyParameter(param);
+        if (copy == NULL) {
+            return false;
+        }
+
+        insertBack(kept->parameters, copy);
+    }
+
+    return true;
+}
+
+//Returns the single-instance index of a property name, or -1
+static int singleIndex(const char* name) {
+
+    for (size_t i = 0; i < NUM_SINGLE_NAMES; i++) {
+        if (strcasecmp(name, singleNames[i]) == 0) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+//Appends a copy of a property to the merged card and returns its node
+static Node* appendCopy(Merger* merger, const Property* prop) {
+
+    Property* copy = copyProperty(prop);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    insertBack(merger->card->optionalProperties, copy);
+
+    return merger->card->optionalProperties->tail;
+}
+
+//Merges one input property into the card
+static bool mergeProperty(Merger* merger, const Property* prop) {
+
+    //Single-instance properties are kept or replaced by policy
+    int single = singleIndex(prop->name);
+
+    if (single >= 0) {
+        Node* node = merger->singles[single];
+
+        if (node == NULL) {
+            merger->singles[single] = appendCopy(merger, prop);
+            return merger->singles[single] != NULL;
+        }
+
+        if (merger->policy == MERGE_PREFER_LAST) {
+            Property* copy = copyProperty(prop);
+            if (copy == NULL) {
+                return false;
+            }
+
+            deleteProperty(node->data);
+            node->data = copy;
+        }
+
+        return true;
+    }
+
+    //Everything else is unioned, with repeats contributing only their parameters
+    uint64_t hash = hashPropertyContent(prop, hashPropertyName(prop));
+    size_t pos = hash & (merger->numSlots - 1);
+
+    while (merger->slots[pos].prop != NULL) {
+        if (merger->slots[pos].hash == hash && samePropertyContent(merger->slots[pos].prop, prop)) {
+            return mergeParameters(merger->slots[pos].prop, prop);
+        }
+
+        pos = (pos + 1) & (merger->numSlots - 1);
+    }
+
+    Node* node = appendCopy(merger, prop);
+    if (node == NULL) {
+        return false;
+    }
+
+    merger->slots[pos] = (MergeSlot){hash, node->data};
+
+    return true;
+}
+
+//Claims the table slot of a property that is already in the card
+static void claimSlot(Merger* merger, Property* prop) {
+
+    uint64_t hash = hashPropertyContent(prop, hashPropertyName(prop));
+    size_t pos = hash & (merger->numSlots - 1);
+
+    while (merger->slots[pos].prop != NULL) {
+        pos = (pos + 1) & (merger->numSlots - 1);
+    }
+
+    merger->slots[pos] = (MergeSlot){hash, prop};
+}
+
+//Ranks how much detail a DateTime holds
+static int datePrecision(const DateTime* dt) {
+
+    if (dt->isText) {
+        return 1;
+    }
+
+    bool hasDate = dt->date != NULL && dt->date[0] != '\0';
+    bool hasTime = dt->time != NULL && dt->time[0] != '\0';
+
+    return hasDate && hasTime ? 4 : hasDate ? 3 : 2;
+}
+
+//Returns the input index whose DateTime should be kept, or -1 if none has one
+static int chooseDate(const Card** inputs, size_t n, MergePolicy policy, bool anniversary) {
+
+    int chosen = -1;
+
+    for (size_t i = 0; i < n; i++) {
+        const DateTime* dt = anniversary ? inputs[i]->anniversary : inputs[i]->birthday;
+
+        if (dt == NULL) {
+            continue;
+        }
+
+        if (chosen < 0 || policy == MERGE_PREFER_LAST) {
+            chosen = (int)i;
+        }
+        else if (policy == MERGE_PREFER_PRECISE) {
+            const DateTime* best = anniversary ? inputs[chosen]->anniversary : inputs[chosen]->birthday;
+
+            if (datePrecision(dt) > datePrecision(best)) {
+                chosen = (int)i;
+            }
+        }
+    }
+
+    return chosen;
+}
+
+//Merges cards into a new card
+VCardErrorCode mergeCards(const Card** inputs, size_t n, MergePolicy policy, Card** out) {
+
+    if (inputs == NULL || n == 0 || out == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *out = NULL;
+
+    //Sizes the table to at most half full with every input property
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (inputs[i] == NULL || inputs[i]->optionalProperties == NULL) {
+            return OTHER_ERROR;
+        }
+
+        total += getLength(inputs[i]->optionalProperties) + 1;
+    }
+
+    Merger merger = {createEmptyCard(), policy, NULL, 16, {NULL}};
+
+    while (merger.numSlots < total * 2) {
+        merger.numSlots *= 2;
+    }
+
+    merger.slots = vcCalloc(merger.numSlots, sizeof(MergeSlot));
+
+    if (merger.card == NULL || merger.slots == NULL) {
+        deleteCard(merger.card);
+        vcFree(merger.slots);
+        return OTHER_ERROR;
+    }
+
+    //Picks the FN field by policy
+    int fnIndex = -1;
+    for (size_t i = 0; i < n; i++) {
+        if (inputs[i]->fn != NULL && (fnIndex < 0 || policy == MERGE_PREFER_LAST)) {
+            fnIndex = (int)i;
+        }
+    }
+
+    bool ok = true;
+
+    if (fnIndex >= 0) {
+        merger.card->fn = copyProperty(inputs[fnIndex]->fn);
+        ok = merger.card->fn != NULL;
+
+        //Equal FNs of the other inputs then only add their parameters to it
+        if (ok) {
+            claimSlot(&merger, merger.card->fn);
+        }
+    }
+
+    //Merges every property, in input order
+    for (size_t i = 0; ok && i < n; i++) {
+        if (inputs[i]->fn != NULL && (int)i != fnIndex) {
+            ok = mergeProperty(&merger, inputs[i]->fn);
+        }
+
+        ListIterator propIter = createIterator(inputs[i]->optionalProperties);
+        Property* prop;
+
+        while (ok && (prop = nextElement(&propIter)) != NULL) {
+            ok = mergeProperty(&merger, prop);
+        }
+    }
+
+    //Picks the dates by policy
+    int bdayIndex = chooseDate(inputs, n, policy, false);
+    int annivIndex = chooseDate(inputs, n, policy, true);
+
+    if (ok && bdayIndex >= 0) {
+        merger.card->birthday = copyDate(inputs[bdayIndex]->birthday);
+        ok = merger.card->birthday != NULL;
+    }
+
+    if (ok && annivIndex >= 0) {
+        merger.card->anniversary = copyDate(inputs[annivIndex]->anniversary);
+        ok = merger.card->anniversary != NULL;
+    }
+
+    vcFree(merger.slots);
+
+    if (!ok) {
+        deleteCard(merger.card);
+        return OTHER_ERROR;
+    }
+
+    *out = merger.card;
+
+    return OK;
+}
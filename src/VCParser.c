@@ -1,691 +1,2101 @@
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <strings.h>
+#include <zlib.h>
+
 #include "LinkedListAPI.h"
 #include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCStats.h"
+
+//Growable array of unfolded content lines
+typedef struct lineArray {
+    char**  lines;
+    int     count;
+    int     capacity;
+} LineArray;
+
+//Frees every line and the array itself
+static void freeLines(LineArray* array) {
+
+    for (int i = 0; i < array->count; i++) {
+        vcFree(array->lines[i]);
+    }
+
+    vcFree(array->lines);
+    array->lines = NULL;
+    array->count = 0;
+    array->capacity = 0;
+}
+
+//Appends a copy of line to the array
+static bool appendLine(LineArray* array, const char* line) {
+
+    //Grows the array geometrically
+    if (array->count == array->capacity) {
+        int newCapacity = array->capacity ? array->capacity * 2 : 32;
+        char** newLines = vcRealloc(array->lines, newCapacity * sizeof(char*));
+
+        if (newLines == NULL) {
+            return false;
+        }
+
+        array->lines = newLines;
+        array->capacity = newCapacity;
+    }
+
+    char* copy = vcMalloc(strlen(line) + 1);
+    if (copy == NULL) {
+        return false;
+    }
+
+    strcpy(copy, line);
+    array->lines[array->count++] = copy;
+
+    return true;
+}
+
+//Appends str to a growable, NUL-terminated buffer of length characters
+//The length is tracked so long folded values, such as embedded photos, unfold in linear time
+static bool appendText(char** buffer, size_t* length, size_t* capacity, const char* str) {
+
+    size_t strLength = strlen(str);
+    size_t needed = *length + strLength + 1;
+
+    if (needed > *capacity) {
+        size_t newCapacity = *capacity * 2;
+
+        while (newCapacity < needed) {
+            newCapacity *= 2;
+        }
+
+        char* newBuffer = vcRealloc(*buffer, newCapacity);
+        if (newBuffer == NULL) {
+            return false;
+        }
+
+        *buffer = newBuffer;
+        *capacity = newCapacity;
+    }
+
+    memcpy(*buffer + *length, str, strLength + 1);
+    *length += strLength;
+
+    return true;
+}
+
+//Initial size of the buffer physical lines are read into; it grows to fit longer lines
+#define LINE_BUFFER_BYTES 256
+
+//Reads one physical line, with its line ending, into a growable buffer
+//Returns 1 if a line was read, 0 at the end of the file and -1 if memory ran out
+static int readLine(FILE* fptr, char** line, size_t* capacity) {
+
+    size_t length = 0;
+
+    while (fgets(*line + length, (int)(*capacity - length > INT_MAX ? INT_MAX : *capacity - length), fptr)) {
+        length += strlen(*line + length);
+
+        if (length > 0 && (*line)[length - 1] == '\n') {
+            return 1;
+        }
+
+        //The line did not fit, so the buffer doubles and reading continues where it stopped
+        if (length + 1 == *capacity) {
+            char* newLine = vcRealloc(*line, *capacity * 2);
+            if (newLine == NULL) {
+                return -1;
+            }
+
+            *line = newLine;
+            *capacity *= 2;
+        }
+    }
+
+    return length > 0 ? 1 : 0;
+}
+
+//Reads the next line of the file and compares it, without its line ending, to expected
+static VCardErrorCode expectLine(FILE* fptr, char** line, size_t* capacity, const char* expected) {
+
+    int status = readLine(fptr, line, capacity);
+
+    if (status < 0) {
+        return OTHER_ERROR;
+    }
+
+    if (status == 0) {
+        return INV_CARD;
+    }
+
+    (*line)[strcspn(*line, "\r\n")] = '\0';
+
+    return strcmp(*line, expected) == 0 ? OK : INV_CARD;
+}
+
+//Checks line endings, the BEGIN/VERSION/END lines and the presence of FN
+static VCardErrorCode checkCardFrame(FILE* fptr) {
+
+    size_t capacity = LINE_BUFFER_BYTES;
+    char* line = vcMalloc(capacity);
+    bool endFlag = false;
+    bool fnFlag = false;
+    int status;
+
+    if (line == NULL) {
+        return OTHER_ERROR;
+    }
+
+    //Reads until the last line of the file
+    while ((status = readLine(fptr, &line, &capacity)) > 0) {
+        size_t len = strlen(line);
+
+        //Check fors for valid CLRF endings
+        if (len >= 2 && !(line[len - 2] == '\r' && line[len - 1] == '\n')) {
+            //Exits if non valid endings are found
+            vcFree(line);
+            return INV_CARD;
+        }
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        //Remembers whether the last non-empty line ends the card
+        if (strlen(line) > 0) { 
+            endFlag = strcmp(line, "END:VCARD") == 0;
+        }
+
+        //Checks for an existing FN property
+        if (strncmp(line, "FN", 2) == 0) {
+            fnFlag = true;
+        }
+    }
+
+    if (status < 0) {
+        vcFree(line);
+        return OTHER_ERROR;
+    }
+
+    //Ensures the file has a valid ending and an FN property
+    if (!endFlag || !fnFlag) {
+        vcFree(line);
+        return INV_CARD;
+    }
+
+    //Rewinds the file pointer to the beginning of the file
+    rewind(fptr);
+
+    //Ensures the vCard has a valid beginning, then that its version is 4.0
+    VCardErrorCode err = expectLine(fptr, &line, &capacity, "BEGIN:VCARD");
+
+    if (err == OK) {
+        err = expectLine(fptr, &line, &capacity, "VERSION:4.0");
+    }
+
+    vcFree(line);
+
+    return err;
+}
+
+//Reads the file and joins folded lines into whole content lines
+static VCardErrorCode unfoldLines(FILE* fptr, LineArray* array) {
+
+    size_t capacity = LINE_BUFFER_BYTES;
+    char* line = vcMalloc(capacity);
+    size_t prevCapacity = 1024;
+    size_t prevLength = 0;
+    char* prevLine = vcMalloc(prevCapacity);
+    VCardErrorCode err = OK;
+    int status;
+
+    if (line == NULL || prevLine == NULL) {
+        vcFree(line);
+        vcFree(prevLine);
+        return OTHER_ERROR;
+    }
+    prevLine[0] = '\0';
+
+    //Sets file pointer back to the beginning
+    rewind(fptr);
+
+    //Reads from file
+    while ((status = readLine(fptr, &line, &capacity)) > 0) {
+
+        //Trims newline characters
+        line[strcspn(line, "\r\n")] = '\0';
+
+        //Skips begin, version and end
+        if (strncmp(line, "BEGIN", 5) == 0 || strncmp(line, "VERSION", 7) == 0 || strncmp(line, "END", 3) == 0) {
+            continue;
+        }
+
+        //If line begins with a space or tab it continues the previous line.  As in RFC 6350,
+        //unfolding removes the line break and exactly that one character, so whitespace that
+        //a folder cut in front of is kept
+        if (line[0] == ' ' || line[0] == '\t') {
+
+            if (!appendText(&prevLine, &prevLength, &prevCapacity, line + 1)) {
+                err = OTHER_ERROR;
+                break;
+            }
+        }
+        //Stores lines in array
+        else {
+            //If previous line is not empty, stores it in the array
+            if (prevLine[0] != '\0' && !appendLine(array, prevLine)) {
+                err = OTHER_ERROR;
+                break;
+            }
+
+            //Updates the contents of previous line for storing
+            prevLine[0] = '\0';
+            prevLength = 0;
+            if (!appendText(&prevLine, &prevLength, &prevCapacity, line)) {
+                err = OTHER_ERROR;
+                break;
+            }
+        }
+    }
+
+    if (status < 0) {
+        err = OTHER_ERROR;
+    }
+
+    //If the final previous line is not empty, stores it in the array
+    if (err == OK && prevLine[0] != '\0' && !appendLine(array, prevLine)) {
+        err = OTHER_ERROR;
+    }
+
+    vcFree(line);
+    vcFree(prevLine);
+
+    return err;
+}
+
+//Limits on the spare objects each thread keeps for createCardInto
+#define SPARE_NODES 4096
+#define SPARE_PROPERTIES 512
+#define SPARE_DATES 4
+
+//Spare objects released by resetCard and reused by createCardInto on the same thread
+static _Thread_local Node* spareNodes[SPARE_NODES];
+static _Thread_local int numSpareNodes = 0;
+static _Thread_local Property* spareProperties[SPARE_PROPERTIES];
+static _Thread_local int numSpareProperties = 0;
+static _Thread_local DateTime* spareDates[SPARE_DATES];
+static _Thread_local int numSpareDates = 0;
+
+//Whether released objects are kept as spares.  Only createCardInto and resetCard keep them, so
+//createCard and deleteCard never leave memory behind on the thread
+static _Thread_local bool keepSpares = false;
+
+//Key whose destructor frees a thread's spares when it exits, set once the thread keeps any
+static pthread_key_t poolKey;
+static pthread_once_t poolKeyOnce = PTHREAD_ONCE_INIT;
+static bool poolKeyCreated = false;
+static _Thread_local bool poolRegistered = false;
+
+//Frees the spares of an exiting thread
+static void releaseThreadPool(void* unused) {
+
+    (void)unused;
+    clearCardPool();
+}
+
+//Creates the key that frees spares at thread exit
+static void createPoolKey(void) {
+
+    poolKeyCreated = pthread_key_create(&poolKey, releaseThreadPool) == 0;
+}
+
+//Starts keeping spares on the calling thread and returns the previous setting to restore.
+//Threads whose pool cannot be freed at exit do not keep any
+static bool beginRecycling(void) {
+
+    bool previous = keepSpares;
+
+    if (!poolRegistered) {
+        pthread_once(&poolKeyOnce, createPoolKey);
+        poolRegistered = poolKeyCreated && pthread_setspecific(poolKey, &poolRegistered) == 0;
+    }
+
+    keepSpares = poolRegistered;
+
+    return previous;
+}
+
+//Appends data to the back of a list, reusing a spare node if there is one
+static void appendData(List* list, void* data) {
+
+    if (numSpareNodes == 0) {
+        insertBack(list, data);
+        return;
+    }
+
+    Node* node = spareNodes[--numSpareNodes];
+    node->data = data;
+    node->next = NULL;
+    node->previous = list->tail;
+
+    if (list->tail != NULL) {
+        list->tail->next = node;
+    }
+    else {
+        list->head = node;
+    }
+
+    list->tail = node;
+    list->length++;
+}
+
+//Empties a list, deleting its data and keeping its nodes as spares
+static void recycleNodes(List* list, void (*deleteData)(void* toBeDeleted)) {
+
+    if (list == NULL) {
+        return;
+    }
+
+    Node* node = list->head;
+
+    while (node != NULL) {
+        Node* next = node->next;
+
+        deleteData(node->data);
+
+        if (keepSpares && numSpareNodes < SPARE_NODES) {
+            spareNodes[numSpareNodes++] = node;
+        }
+        else {
+            vcFree(node);
+        }
+
+        node = next;
+    }
+
+    list->head = NULL;
+    list->tail = NULL;
+    list->length = 0;
+}
+
+//Returns a property with empty parameter and value lists, reusing a spare one if possible
+static Property* newProperty(const char* name, const char* group) {
+
+    if (numSpareProperties == 0) {
+        return createProperty(name, group);
+    }
+
+    Property *prop = spareProperties[--numSpareProperties];
+
+    if (!setPropertyStrings(prop, name, group)) {
+        deleteProperty(prop);
+        return NULL;
+    }
+
+    return prop;
+}
+
+//Empties a property and keeps it, with its lists and nodes, as a spare
+static void recycleProperty(void* toBeRecycled) {
+
+    Property* prop = (Property*)toBeRecycled;
+
+    if (prop == NULL) {
+        return;
+    }
+
+    //Properties without both lists cannot be reused as they are
+    if (!keepSpares || numSpareProperties == SPARE_PROPERTIES || prop->parameters == NULL || prop->values == NULL) {
+        deleteProperty(prop);
+        return;
+    }
+
+    //Short strings live in the property itself and are simply overwritten on reuse
+    if (!isInlineString(prop, prop->name)) {
+        vcFree(prop->name);
+    }
+
+    if (!isInlineString(prop, prop->group)) {
+        vcFree(prop->group);
+    }
+
+    prop->name = NULL;
+    prop->group = NULL;
+
+    recycleNodes(prop->parameters, deleteParameter);
+    recycleNodes(prop->values, deleteValue);
+
+    //Restores the list callbacks in case the caller replaced them
+    prop->parameters->deleteData = deleteParameter;
+    prop->parameters->compare = compareParameters;
+    prop->parameters->printData = parameterToString;
+    prop->values->deleteData = deleteValue;
+    prop->values->compare = compareValues;
+    prop->values->printData = valueToString;
+
+    spareProperties[numSpareProperties++] = prop;
+}
+
+//Returns a zeroed DateTime, reusing a spare one if possible
+static DateTime* newDateTime(void) {
+
+    if (numSpareDates > 0) {
+        return spareDates[--numSpareDates];
+    }
+
+    return vcCalloc(1, sizeof(DateTime));
+}
+
+//Frees the strings of a DateTime and keeps the struct as a spare
+static void recycleDate(DateTime* date) {
+
+    if (date == NULL) {
+        return;
+    }
+
+    if (!keepSpares || numSpareDates == SPARE_DATES) {
+        deleteDate(date);
+        return;
+    }
+
+    vcFree(date->date);
+    vcFree(date->time);
+    vcFree(date->text);
+    memset(date, 0, sizeof(DateTime));
+
+    spareDates[numSpareDates++] = date;
+}
+
+//Parses a date-and-or-time value into a new DateTime
+static VCardErrorCode parseDateTime(const char* value, bool textFlag, DateTime** out) {
+
+    //Allocates memory for the dates and times
+    DateTime *dateField = newDateTime();
+    if (dateField == NULL) {
+        return OTHER_ERROR;
+    }
+
+    //Sets UTC and isText values to false
+    dateField->UTC = false;
+    dateField->isText = false;
+
+    int textLength = strlen(value);
+
+    //Allocates memory for date, time and text
+    dateField->date = vcMalloc(9);
+    dateField->time = vcMalloc(7);
+    dateField->text = vcMalloc(textLength + 1);
+
+    if (dateField->date == NULL || dateField->time == NULL || dateField->text == NULL) {
+        deleteDate(dateField);
+        return OTHER_ERROR;
+    }
+
+    dateField->text[0] = '\0';
+
+    //If date is text format
+    if (textFlag) {
+        strcpy(dateField->text, value);
+        dateField->isText = true;
+        dateField->date[0] = '\0';
+        dateField->time[0] = '\0';
+    }
+    //If date is not text format
+    else {
+
+        //If there is no date specified, store only the time
+        if (value[0] == 'T') {
+            dateField->date[0] = '\0';
+            strncpy(dateField->time, value + 1, 6);
+            dateField->time[6] = '\0';
+
+            //Sets UTC to true
+            if (strlen(value) >= 8 && value[7] == 'Z') {
+                dateField->UTC = true;
+            }
+        }
+        //If there is a date
+        else {
+            const char *tempT = strchr(value, 'T');
+
+            //If there is date and time
+            if (tempT) {
+                //Stores the date
+                size_t dateLength = tempT - value;
+                if (dateLength > 8) {
+                    dateLength = 8;
+                }
+                strncpy(dateField->date, value, dateLength);
+                dateField->date[dateLength] = '\0';
+
+                //Stores the time
+                strncpy(dateField->time, tempT + 1, 6);
+                dateField->time[6] = '\0';
+
+                //Sets UTC to true
+                if (strlen(tempT) >= 8 && tempT[7] == 'Z') {
+                    dateField->UTC = true;
+                }
+            }
+            //If there is no time
+            else {
+                //Stores the date
+                strncpy(dateField->date, value, 8);
+                dateField->date[8] = '\0';
+                dateField->time[0] = '\0';
+            }
+        }
+    }
+
+    *out = dateField;
+
+    return OK;
+}
+
+//Whether lines in a legacy CHARSET are converted to UTF-8 rather than rejected
+static atomic_bool normalizeCharsets = false;
+
+//Legacy character sets that can be converted to UTF-8
+typedef enum legacyCharset {CHARSET_NONE, CHARSET_UTF8, CHARSET_ASCII, CHARSET_LATIN1, CHARSET_CP1252} LegacyCharset;
+
+//Code points of windows-1252 bytes 0x80 to 0x9f, which ISO-8859-1 leaves as control codes
+static const uint16_t cp1252High[32] = {
+    0x20ac, 0x0081, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021,
+    0x02c6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008d, 0x017d, 0x008f,
+    0x0090, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+    0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0x009d, 0x017e, 0x0178
+};
+
+//Turns CHARSET normalization on or off for every thread
+void setCharsetNormalization(bool enabled) {
+
+    atomic_store_explicit(&normalizeCharsets, enabled, memory_order_relaxed);
+}
+
+//Checks that text is well-formed UTF-8: no overlong forms, surrogates or code points past
+//U+10FFFF.  Runs of ASCII are skipped eight bytes at a time
+static bool isValidUTF8(const unsigned char* text, size_t length) {
+
+    size_t pos = 0;
+
+    while (pos < length) {
+
+        //A word with no high bit set holds eight ASCII characters
+        if (length - pos >= 8) {
+            uint64_t word;
+            memcpy(&word, text + pos, sizeof(word));
+
+            if ((word & 0x8080808080808080ull) == 0) {
+                pos += 8;
+                continue;
+            }
+        }
+
+        unsigned char byte = text[pos];
+
+        if (byte < 0x80) {
+            pos++;
+            continue;
+        }
+
+        size_t need;
+        uint32_t codePoint;
+        uint32_t minimum;
+
+        if ((byte & 0xe0) == 0xc0) {
+            need = 1;
+            codePoint = byte & 0x1f;
+            minimum = 0x80;
+        }
+        else if ((byte & 0xf0) == 0xe0) {
+            need = 2;
+            codePoint = byte & 0x0f;
+            minimum = 0x800;
+        }
+        else if ((byte & 0xf8) == 0xf0) {
+            need = 3;
+            codePoint = byte & 0x07;
+            minimum = 0x10000;
+        }
+        else {
+            return false;
+        }
+
+        if (length - pos <= need) {
+            return false;
+        }
+
+        for (size_t i = 1; i <= need; i++) {
+            if ((text[pos + i] & 0xc0) != 0x80) {
+                return false;
+            }
+
+            codePoint = codePoint << 6 | (text[pos + i] & 0x3f);
+        }
+
+        if (codePoint < minimum || codePoint > 0x10ffff || (codePoint >= 0xd800 && codePoint <= 0xdfff)) {
+            return false;
+        }
+
+        pos += need + 1;
+    }
+
+    return true;
+}
+
+//Finds the CHARSET parameter among a content line's parameters, before its first colon
+static LegacyCharset findLineCharset(const char* line) {
+
+    const char* colon = strchr(line, ':');
+    const char* end = colon != NULL ? colon : line + strlen(line);
+
+    for (const char* pos = strchr(line, ';'); pos != NULL && pos < end; pos = strchr(pos + 1, ';')) {
+        if (strncasecmp(pos + 1, "CHARSET=", 8) != 0) {
+            continue;
+        }
+
+        const char* name = pos + 9;
+        size_t length = strcspn(name, ";:");
+
+        struct {
+            const char*     name;
+            LegacyCharset   charset;
+        } names[] = {
+            {"UTF-8", CHARSET_UTF8}, {"US-ASCII", CHARSET_ASCII}, {"ISO-8859-1", CHARSET_LATIN1},
+            {"LATIN1", CHARSET_LATIN1}, {"WINDOWS-1252", CHARSET_CP1252}, {"CP1252", CHARSET_CP1252}
+        };
+
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == length && strncasecmp(name, names[i].name, length) == 0) {
+                return names[i].charset;
+            }
+        }
+
+        return CHARSET_NONE;
+    }
+
+    return CHARSET_NONE;
+}
+
+//Rewrites a line in a single-byte charset as UTF-8
+static char* convertToUTF8(const char* line, LegacyCharset charset) {
+
+    size_t length = strlen(line);
+
+    //No byte takes more than three bytes in UTF-8
+    char* converted = vcMalloc(length * 3 + 1);
+    if (converted == NULL) {
+        return NULL;
+    }
+
+    char* out = converted;
+
+    for (const unsigned char* in = (const unsigned char*)line; *in != '\0'; in++) {
+        uint32_t codePoint = *in;
+
+        if (charset == CHARSET_CP1252 && codePoint >= 0x80 && codePoint < 0xa0) {
+            codePoint = cp1252High[codePoint - 0x80];
+        }
+
+        if (codePoint < 0x80) {
+            *out++ = (char)codePoint;
+        }
+        else if (codePoint < 0x800) {
+            *out++ = (char)(0xc0 | codePoint >> 6);
+            *out++ = (char)(0x80 | (codePoint & 0x3f));
+        }
+        else {
+            *out++ = (char)(0xe0 | codePoint >> 12);
+            *out++ = (char)(0x80 | ((codePoint >> 6) & 0x3f));
+            *out++ = (char)(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    *out = '\0';
+
+    return converted;
+}
+
+//Makes sure a content line is UTF-8 before it is parsed, converting it from a legacy CHARSET
+//if normalization is on.  A converted line replaces the original in place
+static VCardErrorCode checkLineEncoding(char** line) {
+
+    if (atomic_load_explicit(&normalizeCharsets, memory_order_relaxed)) {
+        LegacyCharset charset = findLineCharset(*line);
+
+        if (charset == CHARSET_LATIN1 || charset == CHARSET_CP1252) {
+            char* converted = convertToUTF8(*line, charset);
+            if (converted == NULL) {
+                return OTHER_ERROR;
+            }
+
+            vcFree(*line);
+            *line = converted;
+
+            return OK;
+        }
+    }
+
+    return isValidUTF8((const unsigned char*)*line, strlen(*line)) ? OK : INV_ENCODING;
+}
+
+//Parses one unfolded content line and stores it in the card
+static VCardErrorCode parseLine(char* line, Card* card) {
+
+    bool textFlag = false;
+
+    //For birthdays
+    if (strncmp(line, "BDAY", 4) == 0) {
+
+        //Checks if the birthday is in text format
+        char *substringCheck = strstr(line, "text");
+
+        //Sets boolean flag
+        if (substringCheck != NULL) {
+            textFlag = true;
+        }
+    }
+
+    //Searches the line for the first :
+    char *colonPos = strchr(line, ':');
+
+    if (!colonPos) {
+        return OK;
+    }
+
+    //Replaces the : with a null terminator to split the string
+    *colonPos = '\0';
+
+    //Stores the portion after the colon in value
+    char *value = colonPos + 1;
+
+    //Checks if the value is empty
+    if (value[0] == '\0') {
+        return INV_PROP;
+    }
+
+    //Splits property name in token
+    char *token = strtok(line, ";");
+
+    if (!token || strlen(token) == 0) {
+        return INV_PROP;
+    }
+
+    //Searches the token for a dot, indicating there is a group
+    char *dotPos = strchr(token, '.');
+    char *propertyName;
+    char *groupName;
+
+    //If the property has a group, splits the token into a group and property name
+    if (dotPos) {
+        *dotPos = '\0';
+        groupName = token;
+        propertyName = dotPos + 1;
+    }
+    //If there is no group, the group is an empty string
+    else {
+        groupName = "";
+        propertyName = token;
+    }
+
+    //Initializes property, with short names stored inside it
+    Property *newProp = newProperty(propertyName, groupName);
+    if (newProp == NULL) {
+        return OTHER_ERROR;
+    }
+
+    //Splits the string into parameters
+    while ((token = strtok(NULL, ";"))) {
+
+        //Searches string for equals sign
+        char *equalSign = strchr(token, '=');
+
+        if (equalSign == NULL || *(equalSign + 1) == '\0') {
+            recycleProperty(newProp);
+            return INV_PROP;
+        }
+
+        //Splits parameter name and value
+        *equalSign = '\0';
+        char *paramKey = token;
+        char *paramValue = equalSign + 1;
+
+        //Once lines are normalized to UTF-8, their CHARSET no longer applies
+        if (strcasecmp(paramKey, "CHARSET") == 0 && atomic_load_explicit(&normalizeCharsets, memory_order_relaxed)) {
+            continue;
+        }
+
+        //Allocates a new parameter, with vocabulary words shared and short strings stored inside it
+        Parameter *param = createParameter(paramKey, paramValue);
+        if (param == NULL) {
+            recycleProperty(newProp);
+            return OTHER_ERROR;
+        }
+
+        //Adds parameters to linked list
+        appendData(newProp->parameters, param);
+    }
+
+    //Stores multiple values
+    char *token1 = value;
+    char *token2 = value;
+
+    //Loops until the end of value string.  A semicolon at the end is followed by one more,
+    //empty value, as in "N:Doe;John;;;"
+    bool moreValues = *token2 != '\0';
+
+    while (moreValues) {
+
+        //Advances token2 until it reaches a semi-colon or end of line
+        while (*token2 && *token2 != ';') {
+            token2++;
+        }
+
+        size_t length = token2 - token1;
+
+        //Allocates memory for the value
+        char *finalValue = vcMalloc(length + 1);
+        if (finalValue == NULL) {
+            recycleProperty(newProp);
+            return OTHER_ERROR;
+        }
+
+        //Copies the token values into final value
+        strncpy(finalValue, token1, length);
+        finalValue[length] = '\0';
+
+        //Adds final values into property
+        appendData(newProp->values, finalValue);
+
+        //Continues past a semicolon, even one that ends the line
+        moreValues = *token2 == ';';
+        token1 = ++token2;
+    }
+
+    //If property is full name
+    if (strcmp(propertyName, "FN") == 0) {
+        recycleProperty(card->fn);
+        card->fn = newProp;
+    }
+    //If property is birthday or anniversary
+    else if (strcmp(propertyName, "BDAY") == 0 || strcmp(propertyName, "ANNIVERSARY") == 0) {
+
+        DateTime *dateField = NULL;
+        uint64_t start = startParserPhase();
+        VCardErrorCode err = parseDateTime(value, textFlag, &dateField);
+        endParserPhase(PHASE_DATETIME, start);
+
+        recycleProperty(newProp);
+
+        if (err != OK) {
+            return err;
+        }
+
+        //A repeated date replaces the earlier one
+        DateTime **target = strcmp(propertyName, "BDAY") == 0 ? &card->birthday : &card->anniversary;
+
+        recycleDate(*target);
+        *target = dateField;
+    }
+    //Adds to linked list
+    else {
+        appendData(card->optionalProperties, newProp);
+    }
+
+    return OK;
+}
+
+//Parses an open vcf stream into an empty card and closes the stream
+//The read phase started at readStart, before the stream was opened
+static VCardErrorCode readStream(FILE* fptr, Card* card, uint64_t readStart) {
+
+    LineArray lines = {NULL, 0, 0};
+
+    //Validates the frame of the card, then unfolds and parses each content line
+    VCardErrorCode err = checkCardFrame(fptr);
+    endParserPhase(PHASE_READ, readStart);
+
+    if (err == OK) {
+        uint64_t start = startParserPhase();
+        err = unfoldLines(fptr, &lines);
+        endParserPhase(PHASE_UNFOLD, start);
+
+        //Unfolding reads to the end, so the position is the size of the input
+        long size = ftell(fptr);
+        addParserBytes(size > 0 ? (uint64_t)size : 0, 0);
+    }
+
+    if (err == OK) {
+        uint64_t start = startParserPhase();
+
+        for (int i = 0; err == OK && i < lines.count; i++) {
+            err = checkLineEncoding(&lines.lines[i]);
+
+            if (err == OK) {
+                err = parseLine(lines.lines[i], card);
+            }
+        }
+
+        endParserPhase(PHASE_TOKENIZE, start);
+    }
+
+    //Every exit goes through here, so nothing allocated above can leak
+    freeLines(&lines);
+    fclose(fptr);
+
+    return err;
+}
+
+//Compressed bytes read from the source at a time when parsing gzip input
+#define INFLATE_CHUNK_SIZE (64 * 1024)
+
+//A gzip-compressed source decompressed as it is read, in bounded memory
+typedef struct inflateStream {
+    FILE*           source;
+    z_stream        zs;
+    uint64_t        position;
+    bool            inMember;
+    bool            ended;
+    unsigned char   input[INFLATE_CHUNK_SIZE];
+} InflateStream;
+
+//Decompresses into the stream's buffer, following concatenated gzip members
+static ssize_t inflateRead(void* cookie, char* buf, size_t size) {
+
+    InflateStream* stream = cookie;
+
+    stream->zs.next_out = (Bytef*)buf;
+    stream->zs.avail_out = size > UINT_MAX ? UINT_MAX : (uInt)size;
+
+    while (stream->zs.avail_out > 0 && !stream->ended) {
+        if (stream->zs.avail_in == 0) {
+            size_t count = fread(stream->input, 1, INFLATE_CHUNK_SIZE, stream->source);
+
+            //Input may only end between members
+            if (count == 0) {
+                if (stream->inMember || ferror(stream->source)) {
+                    return -1;
+                }
+
+                stream->ended = true;
+                break;
+            }
+
+            stream->zs.next_in = stream->input;
+            stream->zs.avail_in = (uInt)count;
+        }
+
+        stream->inMember = true;
+
+        int ret = inflate(&stream->zs, Z_NO_FLUSH);
+
+        if (ret == Z_STREAM_END) {
+            inflateReset(&stream->zs);
+            stream->inMember = false;
+        }
+        else if (ret != Z_OK) {
+            return -1;
+        }
+    }
+
+    size_t produced = (size > UINT_MAX ? UINT_MAX : size) - stream->zs.avail_out;
+    stream->position += produced;
+
+    return (ssize_t)produced;
+}
+
+//Supports the two seeks the parser makes: rewinding, and asking for the position
+static int inflateSeek(void* cookie, off64_t* offset, int whence) {
+
+    InflateStream* stream = cookie;
+
+    if (whence == SEEK_CUR && *offset == 0) {
+        *offset = (off64_t)stream->position;
+        return 0;
+    }
+
+    if (whence != SEEK_SET || *offset != 0 || fseek(stream->source, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+
+    inflateReset(&stream->zs);
+    stream->zs.avail_in = 0;
+    stream->position = 0;
+    stream->inMember = false;
+    stream->ended = false;
+
+    return 0;
+}
+
+//Releases the decompressor and its source
+static int inflateClose(void* cookie) {
+
+    InflateStream* stream = cookie;
+
+    inflateEnd(&stream->zs);
+    int result = fclose(stream->source);
+    vcFree(stream);
+
+    return result;
+}
+
+//Replaces a compressed source with a stream of its decompressed text, checking its magic
+//bytes; plain sources are returned as they are.  The source is closed on failure
+static VCardErrorCode openInput(FILE* source, FILE** fptr) {
+
+    unsigned char magic[4];
+    size_t count = fread(magic, 1, sizeof(magic), source);
+
+    rewind(source);
+
+    //zstd frames are recognized but cannot be read, as the library is built without zstd
+    if (count == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        fclose(source);
+        return INV_FILE;
+    }
+
+    if (count < 2 || magic[0] != 0x1f || magic[1] != 0x8b) {
+        *fptr = source;
+        return OK;
+    }
+
+    InflateStream* stream = vcMalloc(sizeof(InflateStream));
+    if (stream == NULL) {
+        fclose(source);
+        return OTHER_ERROR;
+    }
+
+    memset(&stream->zs, 0, sizeof(z_stream));
+    stream->zs.zalloc = vcZlibAlloc;
+    stream->zs.zfree = vcZlibFree;
+    stream->source = source;
+    stream->position = 0;
+    stream->inMember = false;
+    stream->ended = false;
+
+    //Window bits of 16 + MAX_WBITS accept the gzip wrapper only
+    if (inflateInit2(&stream->zs, 16 + MAX_WBITS) != Z_OK) {
+        vcFree(stream);
+        fclose(source);
+        return OTHER_ERROR;
+    }
+
+    cookie_io_functions_t functions = {inflateRead, NULL, inflateSeek, inflateClose};
+
+    *fptr = fopencookie(stream, "r", functions);
+
+    if (*fptr == NULL) {
+        inflateClose(stream);
+        return OTHER_ERROR;
+    }
+
+    return OK;
+}
+
+//Reads and parses a vcf file, which may be gzip-compressed, into an empty card
+static VCardErrorCode readCard(const char* fileName, Card* card) {
+
+    uint64_t start = startParserPhase();
+
+    //Opens file
+    FILE *fptr;
+    fptr = fopen(fileName, "r");
+
+    //Returns error code
+    if (fptr == NULL) {
+        endParserPhase(PHASE_READ, start);
+        return INV_FILE;
+    }
+
+    VCardErrorCode err = openInput(fptr, &fptr);
+    if (err != OK) {
+        endParserPhase(PHASE_READ, start);
+        return err;
+    }
+
+    return readStream(fptr, card, start);
+}
+
+//Parses an in-memory vcf file, which may be gzip-compressed, into an empty card
+static VCardErrorCode readBuffer(const char* buffer, size_t length, Card* card) {
+
+    //An empty buffer cannot hold a card, and fmemopen rejects it
+    if (length == 0) {
+        return INV_CARD;
+    }
+
+    uint64_t start = startParserPhase();
+
+    //The stream is read-only, so the buffer is never modified
+    FILE *fptr = fmemopen((void*)buffer, length, "r");
+    if (fptr == NULL) {
+        endParserPhase(PHASE_READ, start);
+        return OTHER_ERROR;
+    }
+
+    VCardErrorCode err = openInput(fptr, &fptr);
+    if (err != OK) {
+        endParserPhase(PHASE_READ, start);
+        return err;
+    }
+
+    return readStream(fptr, card, start);
+}
+
+//A card whose contents are carved from its own allocation, followed by that storage
+typedef struct packedCard {
+    Card        card;
+    BlockList   properties;
+    size_t      size;
+    max_align_t storage[];
+} PackedCard;
+
+//Checks whether a card was allocated by createPackedCard
+static bool isPacked(const Card* obj) {
+
+    return obj->optionalProperties != NULL && obj->optionalProperties->deleteData == keepBlockData
+           && ((const BlockList*)obj->optionalProperties)->blockStart == obj;
+}
+
+//Checks whether an object lies inside the allocation of a packed card
+static bool inBlock(const Card* obj, const void* ptr) {
+
+    uintptr_t start = (uintptr_t)obj;
+
+    return (uintptr_t)ptr >= start && (uintptr_t)ptr < start + ((const PackedCard*)obj)->size;
+}
+
+//Frees a string of a packed card unless it lies in the block or is shared by the parameter vocabulary
+static void releaseBlockString(const BlockList* list, char* str) {
+
+    if (!inListBlock(list, str) && !isInternedString(str)) {
+        vcFree(str);
+    }
+}
+
+//deleteItem of a packed value list: frees values added from outside the block
+static void deleteBlockValue(const BlockList* list, void* toBeDeleted) {
+
+    releaseBlockString(list, toBeDeleted);
+}
+
+//deleteItem of a packed parameter list: frees parameters, or strings, added from outside the block
+static void deleteBlockParameter(const BlockList* list, void* toBeDeleted) {
+
+    Parameter* param = toBeDeleted;
+
+    if (!inListBlock(list, param)) {
+        deleteParameter(param);
+        return;
+    }
+
+    releaseBlockString(list, param->name);
+    releaseBlockString(list, param->value);
+}
+
+//deleteItem of a packed property list: frees whatever of a property lies outside the block
+static void deleteBlockProperty(const BlockList* list, void* toBeDeleted) {
+
+    Property* prop = toBeDeleted;
+
+    if (prop == NULL) {
+        return;
+    }
+
+    if (!inListBlock(list, prop)) {
+        deleteProperty(prop);
+        return;
+    }
+
+    releaseBlockString(list, prop->name);
+    releaseBlockString(list, prop->group);
+
+    //Lists from the block only free what was added to them; replaced ones are freed whole
+    freeList(prop->parameters);
+    freeList(prop->values);
+}
+
+//Frees whatever was added to a packed card's DateTime from outside the block
+static void releasePackedDate(const BlockList* list, DateTime* date) {
+
+    if (date == NULL) {
+        return;
+    }
+
+    if (!inListBlock(list, date)) {
+        deleteDate(date);
+        return;
+    }
+
+    releaseBlockString(list, date->date);
+    releaseBlockString(list, date->time);
+    releaseBlockString(list, date->text);
+}
+
+//Empties a packed card, freeing only the objects that lie outside its block
+static void releasePackedCard(Card* obj) {
+
+    const BlockList* list = &((PackedCard*)obj)->properties;
+
+    deleteBlockProperty(list, obj->fn);
+    releasePackedDate(list, obj->birthday);
+    releasePackedDate(list, obj->anniversary);
+    clearList(obj->optionalProperties);
+
+    obj->fn = NULL;
+    obj->birthday = NULL;
+    obj->anniversary = NULL;
+}
+
+//Allocates an empty card followed by storage for its contents
+Card* createPackedCard(size_t size, void** storage) {
+
+    if (storage == NULL || size > SIZE_MAX - sizeof(PackedCard)) {
+        return NULL;
+    }
+
+    PackedCard* packed = vcMalloc(sizeof(PackedCard) + size);
+    if (packed == NULL) {
+        return NULL;
+    }
+
+    packed->size = sizeof(PackedCard) + size;
+    packed->card = (Card){NULL, NULL, NULL, NULL};
+    packed->card.optionalProperties = initializeBlockList(&packed->properties, packed, packed->size, propertyToString,
+                                                          deleteBlockProperty, compareProperties);
+
+    *storage = packed->storage;
+
+    return &packed->card;
+}
+
+//Sets up a parameter or value list inside the block of a packed card
+List* initializePackedList(const Card* card, BlockList* list, bool parameters) {
+
+    if (card == NULL || list == NULL || !isPacked(card) || !inBlock(card, list)) {
+        return NULL;
+    }
+
+    const PackedCard* packed = (const PackedCard*)card;
+
+    if (parameters) {
+        return initializeBlockList(list, packed, packed->size, parameterToString, deleteBlockParameter, compareParameters);
+    }
+
+    return initializeBlockList(list, packed, packed->size, valueToString, deleteBlockValue, compareValues);
+}
+
+//Alignment of the structs carved from a clone's storage, which hold only pointers and smaller fields
+#define CLONE_ALIGN sizeof(void*)
+
+//Space needed to clone a card: structs first, then the strings they point to
+typedef struct cloneSize {
+    size_t  structs;
+    size_t  strings;
+} CloneSize;
+
+//Cursors into the storage of a clone being built
+typedef struct cloneCursor {
+    const Card* card;
+    char*       structs;
+    char*       strings;
+} CloneCursor;
+
+//Rounds a struct size up so the next struct carved after it stays aligned
+static size_t cloneAligned(size_t size) {
+
+    return (size + CLONE_ALIGN - 1) / CLONE_ALIGN * CLONE_ALIGN;
+}
+
+//Returns the space a possibly NULL string takes in a clone, where NULL becomes ""
+static size_t cloneStringSize(const char* str) {
+
+    return (str != NULL ? strlen(str) : 0) + 1;
+}
+
+//Returns the space a parameter string takes in a clone, which shares vocabulary words
+static size_t cloneParamStringSize(const char* str) {
+
+    return isInternedString(str) ? 0 : cloneStringSize(str);
+}
+
+//Adds the space a property needs to size
+static void measureClonedProperty(const Property* prop, bool listed, CloneSize* size) {
+
+    size->structs += cloneAligned(sizeof(Property)) + 2 * cloneAligned(sizeof(BlockList)) + (listed ? cloneAligned(sizeof(Node)) : 0);
+    size->strings += cloneStringSize(prop->name) + cloneStringSize(prop->group);
+
+    for (Node* node = prop->parameters ? prop->parameters->head : NULL; node != NULL; node = node->next) {
+        Parameter* param = node->data;
+
+        size->structs += cloneAligned(sizeof(Parameter)) + cloneAligned(sizeof(Node));
+        size->strings += cloneParamStringSize(param->name) + cloneParamStringSize(param->value);
+    }
+
+    for (Node* node = prop->values ? prop->values->head : NULL; node != NULL; node = node->next) {
+        size->structs += cloneAligned(sizeof(Node));
+        size->strings += cloneStringSize(node->data);
+    }
+}
+
+//Adds the space a DateTime needs to size
+static void measureClonedDate(const DateTime* date, CloneSize* size) {
+
+    size->structs += cloneAligned(sizeof(DateTime));
+    size->strings += cloneStringSize(date->date) + cloneStringSize(date->time) + cloneStringSize(date->text);
+}
+
+//Takes an uninitialized struct from the front of the storage
+static void* carveClonedStruct(CloneCursor* cursor, size_t size) {
+
+    void* ptr = cursor->structs;
+    cursor->structs += cloneAligned(size);
+
+    return ptr;
+}
+
+//Copies a possibly NULL string into the string area of the storage
+static char* carveClonedString(CloneCursor* cursor, const char* str) {
+
+    size_t len = str != NULL ? strlen(str) : 0;
+    char* copy = cursor->strings;
+
+    memcpy(copy, str != NULL ? str : "", len + 1);
+    cursor->strings += len + 1;
+
+    return copy;
+}
+
+//Shares a vocabulary word or copies any other parameter string into the storage
+static char* carveClonedParamString(CloneCursor* cursor, char* str) {
+
+    return isInternedString(str) ? str : carveClonedString(cursor, str);
+}
+
+//Appends data to a list with a node from the storage
+static void carveClonedNode(CloneCursor* cursor, List* list, void* data) {
+
+    Node* node = carveClonedStruct(cursor, sizeof(Node));
+    *node = (Node){data, list->tail, NULL};
+
+    if (list->tail != NULL) {
+        list->tail->next = node;
+    }
+    else {
+        list->head = node;
+    }
+
+    list->tail = node;
+    list->length++;
+}
+
+//Copies a property into the storage
+static Property* carveClonedProperty(CloneCursor* cursor, const Property* prop) {
+
+    Property* copy = carveClonedStruct(cursor, sizeof(Property));
+    copy->name = carveClonedString(cursor, prop->name);
+    copy->group = carveClonedString(cursor, prop->group);
+
+    copy->parameters = initializePackedList(cursor->card, carveClonedStruct(cursor, sizeof(BlockList)), true);
+    copy->values = initializePackedList(cursor->card, carveClonedStruct(cursor, sizeof(BlockList)), false);
+
+    for (Node* node = prop->parameters ? prop->parameters->head : NULL; node != NULL; node = node->next) {
+        Parameter* param = node->data;
+        Parameter* paramCopy = carveClonedStruct(cursor, sizeof(Parameter));
+
+        paramCopy->name = carveClonedParamString(cursor, param->name);
+        paramCopy->value = carveClonedParamString(cursor, param->value);
+        carveClonedNode(cursor, copy->parameters, paramCopy);
+    }
+
+    for (Node* node = prop->values ? prop->values->head : NULL; node != NULL; node = node->next) {
+        carveClonedNode(cursor, copy->values, carveClonedString(cursor, node->data));
+    }
+
+    return copy;
+}
+
+//Copies a DateTime into the storage
+static DateTime* carveClonedDate(CloneCursor* cursor, const DateTime* date) {
+
+    DateTime* copy = carveClonedStruct(cursor, sizeof(DateTime));
+    copy->UTC = date->UTC;
+    copy->isText = date->isText;
+    copy->date = carveClonedString(cursor, date->date);
+    copy->time = carveClonedString(cursor, date->time);
+    copy->text = carveClonedString(cursor, date->text);
+
+    return copy;
+}
+
+//Deep-copies a card into a single allocation
+Card* cloneCard(const Card* obj) {
+
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    //Works out the size of everything first, so the copy needs one allocation
+    CloneSize size = {0, 0};
+
+    if (obj->fn != NULL) {
+        measureClonedProperty(obj->fn, false, &size);
+    }
+
+    for (Node* node = obj->optionalProperties ? obj->optionalProperties->head : NULL; node != NULL; node = node->next) {
+        measureClonedProperty(node->data, true, &size);
+    }
+
+    if (obj->birthday != NULL) {
+        measureClonedDate(obj->birthday, &size);
+    }
+
+    if (obj->anniversary != NULL) {
+        measureClonedDate(obj->anniversary, &size);
+    }
+
+    void* storage;
+    Card* copy = createPackedCard(size.structs + size.strings, &storage);
+
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    CloneCursor cursor = {copy, storage, (char*)storage + size.structs};
+
+    if (obj->fn != NULL) {
+        copy->fn = carveClonedProperty(&cursor, obj->fn);
+    }
+
+    for (Node* node = obj->optionalProperties ? obj->optionalProperties->head : NULL; node != NULL; node = node->next) {
+        carveClonedNode(&cursor, copy->optionalProperties, carveClonedProperty(&cursor, node->data));
+    }
+
+    if (obj->birthday != NULL) {
+        copy->birthday = carveClonedDate(&cursor, obj->birthday);
+    }
+
+    if (obj->anniversary != NULL) {
+        copy->anniversary = carveClonedDate(&cursor, obj->anniversary);
+    }
+
+    return copy;
+}
+
+//Walk of a card for cardMemoryUsage
+typedef struct memoryWalk {
+    const Card*     card;
+    bool            packed;
+    size_t          blockBytes;
+    CardMemStats*   stats;
+} MemoryWalk;
+
+//Adds one object to a category, at its exact heap size or, inside a packed block, at its own size
+static void countMemory(MemoryWalk* walk, const void* ptr, size_t packedSize, size_t* category) {
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (walk->packed && inBlock(walk->card, ptr)) {
+        *category += packedSize;
+        walk->blockBytes += packedSize;
+        return;
+    }
+
+    *category += vcAllocatedSize(ptr);
+    walk->stats->overheadBytes += vcHeaderSize();
+    walk->stats->numBlocks++;
+}
+
+//Adds a string to a category
+static void countStringMemory(MemoryWalk* walk, const char* str, size_t* category) {
+
+    if (str != NULL) {
+        countMemory(walk, str, strlen(str) + 1, category);
+    }
+}
+
+//Adds a string of a Property or Parameter, moving one stored inside it out of the struct's bytes
+static void countOwnedStringMemory(MemoryWalk* walk, const void* owner, const char* str, size_t* category) {
+
+    bool heapOwner = !(walk->packed && inBlock(walk->card, owner));
+
+    //Vocabulary words are shared by every card and owned by none
+    if (isInternedString(str)) {
+        return;
+    }
+
+    if (heapOwner && isInlineString(owner, str)) {
+        size_t length = strlen(str) + 1;
+
+        walk->stats->objectBytes -= length;
+        *category += length;
+        return;
+    }
+
+    countStringMemory(walk, str, category);
+}
+
+//Adds a list header and its nodes
+static void countListMemory(MemoryWalk* walk, const List* list) {
+
+    size_t headerSize = list != NULL && list->deleteData == keepBlockData ? sizeof(BlockList) : sizeof(List);
+
+    countMemory(walk, list, headerSize, &walk->stats->listBytes);
+
+    if (list == NULL) {
+        return;
+    }
+
+    for (const Node* node = list->head; node != NULL; node = node->next) {
+        countMemory(walk, node, sizeof(Node), &walk->stats->nodeBytes);
+    }
+}
+
+//Adds a property with its lists, parameters and values
+static void countPropertyMemory(MemoryWalk* walk, const Property* prop) {
+
+    CardMemStats* stats = walk->stats;
+
+    countMemory(walk, prop, sizeof(Property), &stats->objectBytes);
+    countOwnedStringMemory(walk, prop, prop->name, &stats->nameBytes);
+    countOwnedStringMemory(walk, prop, prop->group, &stats->nameBytes);
+
+    countListMemory(walk, prop->parameters);
+    countListMemory(walk, prop->values);
+
+    if (prop->parameters != NULL) {
+        for (const Node* node = prop->parameters->head; node != NULL; node = node->next) {
+            const Parameter* param = node->data;
+
+            countMemory(walk, param, sizeof(Parameter), &stats->objectBytes);
+            countOwnedStringMemory(walk, param, param->name, &stats->nameBytes);
+            countOwnedStringMemory(walk, param, param->value, &stats->valueBytes);
+        }
+    }
+
+    if (prop->values != NULL) {
+        for (const Node* node = prop->values->head; node != NULL; node = node->next) {
+            countStringMemory(walk, node->data, &stats->valueBytes);
+        }
+    }
+}
+
+//Adds a DateTime and its strings
+static void countDateMemory(MemoryWalk* walk, const DateTime* date) {
+
+    if (date == NULL) {
+        return;
+    }
+
+    countMemory(walk, date, sizeof(DateTime), &walk->stats->objectBytes);
+    countStringMemory(walk, date->date, &walk->stats->dateBytes);
+    countStringMemory(walk, date->time, &walk->stats->dateBytes);
+    countStringMemory(walk, date->text, &walk->stats->dateBytes);
+}
+
+//Measures the memory a card holds, by category
+void cardMemoryUsage(const Card* obj, CardMemStats* stats) {
+
+    if (stats == NULL) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(CardMemStats));
+
+    if (obj == NULL) {
+        return;
+    }
+
+    MemoryWalk walk = {obj, isPacked(obj), 0, stats};
+
+    //A packed card is one block, its Card and List headers included
+    if (walk.packed) {
+        stats->objectBytes += sizeof(Card);
+        stats->listBytes += sizeof(BlockList);
+        walk.blockBytes = sizeof(Card) + sizeof(BlockList);
+        stats->numBlocks = 1;
+
+        for (const Node* node = obj->optionalProperties->head; node != NULL; node = node->next) {
+            countMemory(&walk, node, sizeof(Node), &stats->nodeBytes);
+        }
+    }
+    else {
+        countMemory(&walk, obj, sizeof(Card), &stats->objectBytes);
+        countListMemory(&walk, obj->optionalProperties);
+    }
+
+    if (obj->fn != NULL) {
+        countPropertyMemory(&walk, obj->fn);
+    }
+
+    if (obj->optionalProperties != NULL) {
+        for (const Node* node = obj->optionalProperties->head; node != NULL; node = node->next) {
+            countPropertyMemory(&walk, node->data);
+        }
+    }
+
+    countDateMemory(&walk, obj->birthday);
+    countDateMemory(&walk, obj->anniversary);
+
+    //Whatever of the block no object accounts for is its header and alignment padding
+    if (walk.packed) {
+        size_t blockSize = ((const PackedCard*)obj)->size;
+
+        stats->overheadBytes += vcHeaderSize() + (blockSize > walk.blockBytes ? blockSize - walk.blockBytes : 0);
+    }
+
+    stats->structuralBytes = stats->objectBytes + stats->listBytes + stats->nodeBytes + stats->overheadBytes;
+    stats->payloadBytes = stats->nameBytes + stats->valueBytes + stats->dateBytes;
+    stats->totalBytes = stats->structuralBytes + stats->payloadBytes;
+}
+
+//Allocates a card with no properties
+Card* createEmptyCard(void) {
+
+    //Allocates memory for the Card object
+    Card *card = vcMalloc(sizeof(Card));
+    if (card == NULL) {
+        return NULL;
+    }
+
+    //Initializes the card
+    card->fn = NULL;
+    card->optionalProperties = initializeList(propertyToString, deleteProperty, compareProperties);
+    card->birthday = NULL;
+    card->anniversary = NULL;
+
+    if (card->optionalProperties == NULL) {
+        vcFree(card);
+        return NULL;
+    }
+
+    return card;
+}
 
 //Parses and stores information from a vcf file
 VCardErrorCode createCard(char* fileName, Card** obj) {
 
-    //Opens file
-    FILE *fptr;
-    fptr = fopen(fileName, "r");
+    if (obj == NULL) {
+        return OTHER_ERROR;
+    }
 
-    //Returns error code
-    if (fptr == NULL) {
+    *obj = NULL;
+
+    if (fileName == NULL) {
         return INV_FILE;
     }
 
-    char line[256];
-    char prevLine[1024] = {0};
-    char lineArray[100][256];
-    int row = 0;
-
-    //Allocates memory for the Card object
-    *obj = malloc(sizeof(Card));
-    if (*obj == NULL) {
-        fclose(fptr);
+    Card *card = createEmptyCard();
+    if (card == NULL) {
         return OTHER_ERROR;
     }
 
-    //Initializes the card
-    (*obj)->fn = NULL;
-    (*obj)->optionalProperties = initializeList(propertyToString, deleteProperty, compareProperties);
-    (*obj)->birthday = NULL;
-    (*obj)->anniversary = NULL;
+    VCardErrorCode err = readCard(fileName, card);
 
-    //Moves to the end of the file
-    fseek(fptr, -1000, SEEK_END);
+    //Deletes the partial card on any error
+    if (err != OK) {
+        deleteCard(card);
+        return err;
+    }
 
-    char lastLine[1000] = "";
+    *obj = card;
 
-    bool fnFlag = false;
+    return OK;
+}
 
-    //Reads until the last line of the file
-    while (fgets(line, sizeof(line), fptr)) {
-        size_t len = strlen(line);
+//Parses a vcf file into an existing card, reusing its storage
+VCardErrorCode createCardInto(const char* fileName, Card* obj) {
 
-        //Check fors for valid CLRF endings
-        if (len >= 2 && !(line[len - 2] == '\r' && line[len - 1] == '\n')) {
-            fclose(fptr);
-            //Exits if non valid endings are found
-            return INV_CARD;
-        }
+    if (obj == NULL) {
+        return OTHER_ERROR;
+    }
 
-        line[strcspn(line, "\r\n")] = '\0';
+    bool previous = beginRecycling();
 
-        if (strlen(line) > 0) { 
-            strcpy(lastLine, line);
-        }
+    resetCard(obj);
 
-        //Checks for an existing FN property
-        if (strncmp(line, "FN", 2) == 0) {
-            fnFlag = true;
-        }
-    }
+    VCardErrorCode err = fileName != NULL ? readCard(fileName, obj) : INV_FILE;
 
-    //Ensures the file has a valid ending
-    if (strcmp(lastLine, "END:VCARD") != 0) {
-        fclose(fptr);
-        //Exits the program if an invalid ending is found
-        return INV_CARD;
+    //Leaves an empty card behind on any error
+    if (err != OK) {
+        resetCard(obj);
     }
 
-    //Ensures there is a FN property
-    if (!fnFlag) {
-        fclose(fptr);
-        return INV_CARD;
+    keepSpares = previous;
+
+    return err;
+}
+
+//Parses a vcf file that is already in memory
+VCardErrorCode createCardFromBuffer(const char* buffer, size_t length, Card** obj) {
+
+    if (obj == NULL) {
+        return OTHER_ERROR;
     }
 
-    //Rewinds the file pointer to the beginning of the file
-    rewind(fptr);
+    *obj = NULL;
 
-    fgets(line, sizeof(line), fptr);
-    line[strcspn(line, "\r\n")] = '\0';
+    if (buffer == NULL) {
+        return INV_FILE;
+    }
 
-    //Ensures the vCard has a valid beginning
-    if (strcmp(line, "BEGIN:VCARD") != 0) {
-        fclose(fptr);
-        //Exits if an invalid beginning is found
-        return INV_CARD;
+    Card *card = createEmptyCard();
+    if (card == NULL) {
+        return OTHER_ERROR;
     }
 
-    fgets(line, sizeof(line), fptr);
-    line[strcspn(line, "\r\n")] = '\0';
+    VCardErrorCode err = readBuffer(buffer, length, card);
 
-    //Ensures the version of the vCard is 4.0
-    if (strcmp(line, "VERSION:4.0") != 0) {
-        fclose(fptr);
-        //Exits if an invalid version is entered
-        return INV_CARD;
+    //Deletes the partial card on any error
+    if (err != OK) {
+        deleteCard(card);
+        return err;
     }
 
-    //Sets file pointer back to the beginning
-    rewind(fptr);
+    *obj = card;
 
-    //Reads from file
-    while (fgets(line, sizeof(line), fptr)) {
+    return OK;
+}
 
-        //Trims newline characters
-        line[strcspn(line, "\r\n")] = '\0';
+//Parses an in-memory vcf file into an existing card, reusing its storage
+VCardErrorCode createCardIntoFromBuffer(const char* buffer, size_t length, Card* obj) {
 
-        //Skips begin, version and end
-        if (strncmp(line, "BEGIN", 5) == 0 || strncmp(line, "VERSION", 7) == 0 || strncmp(line, "END", 3) == 0) {
-            continue;
-        }
+    if (obj == NULL) {
+        return OTHER_ERROR;
+    }
 
-        //If line begins with a space or tab it needs to be added onto the previous line
-        if (line[0] == ' ' || line[0] == '\t') {
+    bool previous = beginRecycling();
 
-            int i = 0;
-            int spaceCount = 0;
+    resetCard(obj);
 
-            //Counts leading whitespaces
-            while (line[i] == ' ' || line[i] == '\t') {
-                if (line[i] == ' ') {
-                    spaceCount++;
-                }
-                i++;
-            }
+    VCardErrorCode err = buffer != NULL ? readBuffer(buffer, length, obj) : INV_FILE;
 
-            //If there were more than one space, preserve whitespace
-            if (spaceCount > 1) {
-                strcat(prevLine, " ");
-            }
+    //Leaves an empty card behind on any error
+    if (err != OK) {
+        resetCard(obj);
+    }
 
-            memmove(line, line + i, strlen(line + i) + 1);
-            
-            strcat(prevLine, line);
-        }
-        //Stores lines in array
-        else {
-            //If previous line is not empty, stores it in the array
-            if (prevLine[0] != '\0') {
-                strncpy(lineArray[row], prevLine, sizeof(lineArray[row]) - 1);
-                lineArray[row][sizeof(lineArray[row]) - 1] = '\0';
-                row++;
+    keepSpares = previous;
 
-                //Resets previous line for next loop
-                prevLine[0] = '\0';
-            }
+    return err;
+}
 
-            //Updates the contents of previous line for storing
-            strncpy(prevLine, line, sizeof(prevLine) - 1);
-            prevLine[sizeof(prevLine) - 1] = '\0';
-        }
+//Empties a card, keeping its storage for the next createCardInto
+void resetCard(Card* obj) {
+
+    if (obj == NULL) {
+        return;
     }
 
-    //If the final previous line is not empty, stores it in teh array
-    if (prevLine[0] != '\0') {
-        strncpy(lineArray[row], prevLine, sizeof(lineArray[row]) - 1);
-        lineArray[row][sizeof(lineArray[row]) - 1] = '\0';
-        row++;
+    //Objects inside a packed card's block stay there until deleteCard
+    if (isPacked(obj)) {
+        releasePackedCard(obj);
+        return;
     }
 
-    //Handles parsing and storing of lines
-    for (int i = 0; i < row; i++) {
+    bool previous = beginRecycling();
 
-        bool textFlag = 0;
-        char *line = lineArray[i];
+    recycleProperty(obj->fn);
+    obj->fn = NULL;
 
-        //For birthdays
-        if (strncmp(line, "BDAY", 4) == 0) {
+    recycleDate(obj->birthday);
+    obj->birthday = NULL;
 
-            //Checks if the birthday is in text format
-            char *substringCheck = strstr(line, "text");
+    recycleDate(obj->anniversary);
+    obj->anniversary = NULL;
 
-            //Sets boolean flag
-            if (substringCheck != NULL) {
-                textFlag = 1;
-            }
-        }
-    
-        //Searches the line for the first :
-        char *colonPos = strchr(line, ':');
+    //Recreates the list if it is missing, otherwise empties it in place
+    if (obj->optionalProperties == NULL) {
+        obj->optionalProperties = initializeList(propertyToString, deleteProperty, compareProperties);
+    }
+    else {
+        recycleNodes(obj->optionalProperties, recycleProperty);
+        obj->optionalProperties->deleteData = deleteProperty;
+    }
 
-        if (!colonPos) {
-            continue;
-        }
+    keepSpares = previous;
+}
 
-        //Replaces the : with a null terminator to split the string
-        *colonPos = '\0';
+//Frees the spare objects kept for the calling thread
+void clearCardPool(void) {
 
-        //Stores the portion after the colon in value
-        char *value = colonPos + 1;
+    while (numSpareProperties > 0) {
+        deleteProperty(spareProperties[--numSpareProperties]);
+    }
 
-        //Checks if the value is empty
-        if (value[0] == '\0') {
-            fclose(fptr);
-            return INV_PROP;
-        }
+    while (numSpareDates > 0) {
+        vcFree(spareDates[--numSpareDates]);
+    }
 
-        //Splits property name in token
-        char *token = strtok(line, ";");
+    while (numSpareNodes > 0) {
+        vcFree(spareNodes[--numSpareNodes]);
+    }
+}
 
-        if (!token || strlen(token) == 0) {
-            fclose(fptr);
-            return INV_PROP;
-        }
+//Stream the serializer writes to, with the column reached on the current content line
+typedef struct lineWriter {
+    FILE*       fptr;
+    uint64_t    written;
+    size_t      column;
+    bool        ok;
+} LineWriter;
 
-        //Initializes property
-        Property *newProp = malloc(sizeof(Property));
-        if (newProp == NULL) {
-            fclose(fptr);
-            return OTHER_ERROR;
-        }
+//Writes bytes to the stream, counting them
+static void writeBytes(LineWriter* out, const char* bytes, size_t length) {
 
-        //Initializes parameters and values lists
-        newProp->parameters = initializeList(parameterToString, deleteParameter, compareParameters);
-        newProp->values = initializeList(valueToString, deleteValue, compareValues);
+    if (out->ok && fwrite(bytes, 1, length, out->fptr) != length) {
+        out->ok = false;
+    }
 
-        //Searches the token for a dot, indicating there is a group
-        char *dotPos = strchr(token, '.');
-        char *propertyName;
+    out->written += length;
+}
 
-        //If the property has a group
-        if (dotPos) {
-            //Splits the token into a group and property name
-            *dotPos = '\0';
+//Finds how much of a content line fits before its next fold
+size_t foldOffset(const char* text, size_t length, size_t column) {
 
-            //Allocates memory for the group
-            newProp->group = malloc(strlen(token) + 1);
-            if (newProp->group == NULL) {
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+    size_t room = column < VCARD_FOLD_OCTETS ? VCARD_FOLD_OCTETS - column : 0;
 
-            //Stores the group name
-            strcpy(newProp->group, token);
-            propertyName = dotPos + 1;
-        }
-        //If there is no group 
-        else {
-            //Allocates memory for the group
-            newProp->group = malloc(1);
-            if (newProp->group == NULL) {
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+    if (text == NULL || length <= room) {
+        return text != NULL ? length : 0;
+    }
 
-            //Sets the group to empty string
-            strcpy(newProp->group, "");
-            propertyName = token;
-        }
+    //Whatever does not fit is cut at the start of a UTF-8 sequence, found by skipping back
+    //over continuation bytes, so no character is split across lines
+    size_t chunk = room;
 
-        //Allocates memory for the property name
-        newProp->name = malloc(strlen(propertyName) + 1);
-        if (newProp->name == NULL) {
-            deleteProperty(newProp);
-            fclose(fptr);
-            return OTHER_ERROR;
-        }
+    while (chunk > 0 && ((unsigned char)text[chunk] & 0xc0) == 0x80) {
+        chunk--;
+    }
 
-        //Stores the property name
-        strcpy(newProp->name, propertyName);
+    //Only invalid UTF-8 has no boundary in a whole line; it is cut anywhere
+    if (chunk == 0 && column <= 1) {
+        chunk = room;
+    }
 
-        //Splits the string into parameters
-        while ((token = strtok(NULL, ";"))) {
+    return chunk;
+}
 
-            //Searches string for equals sign
-            char *equalSign = strchr(token, '=');
+//Writes text onto the current content line, folding it every VCARD_FOLD_OCTETS octets
+static void writeFolded(LineWriter* out, const char* text, size_t length) {
 
-            if (equalSign == NULL || *(equalSign + 1) == '\0') {
-                deleteProperty(newProp);
-                fclose(fptr);
-                return INV_PROP;
-            }
+    while (out->ok && length > 0) {
+        size_t chunk = foldOffset(text, length, out->column);
 
-            //Splits parameter name and value
-            *equalSign = '\0';
-            char *paramKey = token;
-            char *paramValue = equalSign + 1;
+        writeBytes(out, text, chunk);
+        out->column += chunk;
+        text += chunk;
+        length -= chunk;
 
+        //Continuation lines start with one space, which counts towards their length
+        if (length > 0) {
+            writeBytes(out, "\r\n ", 3);
+            out->column = 1;
+        }
+    }
+}
 
-            if (paramKey && paramValue) {
-                //Allocates memory for a new parameter
-                Parameter *param = malloc(sizeof(Parameter));
-                if (param == NULL) {
-                    deleteProperty(newProp);
-                    fclose(fptr);
-                    return OTHER_ERROR;
-                }
+//Writes strings onto the current content line, up to a terminating NULL
+static void writeText(LineWriter* out, ...) {
 
-                //Allocates memory for parameter name
-                param->name = malloc(strlen(paramKey) + 1);
-                if (param->name == NULL) {
-                    free(param);
-                    deleteProperty(newProp);
-                    fclose(fptr);
-                    return OTHER_ERROR;
-                }
+    va_list args;
+    va_start(args, out);
 
-                //Stores the parameter name
-                strcpy(param->name, paramKey);
-
-                //Allocates memory for a value and stores it
-                param->value = malloc(strlen(paramValue) + 1);
-                if (param->value == NULL) {
-                    free(param->name);
-                    free(param);
-                    deleteProperty(newProp);
-                    fclose(fptr);
-                    return OTHER_ERROR;
-                }
+    const char* text;
 
-                //Stores the parameter value
-                strcpy(param->value, paramValue);
+    while ((text = va_arg(args, const char*)) != NULL) {
+        writeFolded(out, text, strlen(text));
+    }
 
-                //Adds parameters to linked list
-                insertBack(newProp->parameters, param);
-            }
-        }
+    va_end(args);
+}
 
-        //Stores multiple values
-        if (value) {
+//Ends the current content line
+static void endLine(LineWriter* out) {
 
-            //Allocates memory for a copy of value
-            char *tempValue = malloc(strlen(value) + 1);
-            if (tempValue == NULL) {
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+    writeBytes(out, "\r\n", 2);
+    out->column = 0;
+}
 
-            //Stores a copy of value
-            strcpy(tempValue, value);
-
-            char *token1 = tempValue;
-            char *token2 = tempValue;
-            
-            //Loops until the end of value string
-            while (*token2) {
-                
-                //Advances token2 until it reaches a semi-colon or end of line
-                while (*token2 && *token2 != ';') {
-                    token2++;
-                }
+//Writes a BDAY or ANNIVERSARY line, if the date is set
+static void writeDate(LineWriter* out, const char* name, const DateTime* date) {
 
-                size_t length = token2 - token1;
+    if (date == NULL) {
+        return;
+    }
 
-                //Allocates memory for the value
-                char *finalValue = malloc(length + 1);
-                if (finalValue == NULL) {
-                    deleteProperty(newProp);
-                    fclose(fptr);
-                    return OTHER_ERROR;
-                }
+    //If the date is stored in text format
+    if (date->isText) {
+        writeText(out, name, ";VALUE=text:", date->text, NULL);
+    }
+    //If it has both a date and time
+    else if (date->date[0] != '\0' && date->time[0] != '\0') {
+        writeText(out, name, ":", date->date, "T", date->time, date->UTC ? "Z" : "", NULL);
+    }
+    //If it only has a date
+    else if (date->date[0] != '\0') {
+        writeText(out, name, ":", date->date, NULL);
+    }
+    //If it only has a time
+    else if (date->time[0] != '\0') {
+        writeText(out, name, ":T", date->time, date->UTC ? "Z" : "", NULL);
+    }
+    else {
+        return;
+    }
 
-                //Copies the token values into final value
-                strncpy(finalValue, token1, length);
-                finalValue[length] = '\0';
+    endLine(out);
+}
 
-                //Adds final values into property
-                insertBack(newProp->values, finalValue);
+//Writes one optional property as a content line
+static void writeProperty(LineWriter* out, const Property* prop) {
 
-                //If reached end of line, break out of loop
-                if (!*token2) {
-                    break;
-                }
+    //Writes the group, if there is one, and the name of the property
+    if (prop->group != NULL && prop->group[0] != '\0') {
+        writeText(out, prop->group, ".", NULL);
+    }
 
-                //Moves token
-                token1 = ++token2;
-            }
+    writeText(out, prop->name, NULL);
 
-            free(tempValue);
-        }
+    //Writes the parameters, each preceded by a semicolon
+    Node* first = prop->parameters != NULL ? prop->parameters->head : NULL;
 
-        //If property is full name
-        if (strcmp(propertyName, "FN") == 0) {
-            if ((*obj)->fn != NULL) {
-                deleteProperty((*obj)->fn);
-            }
-            (*obj)->fn = newProp; 
-        }
-        //If property is birthday or anniversary
-        else if (strcmp(propertyName, "BDAY") == 0 || strcmp(propertyName, "ANNIVERSARY") == 0) {
+    for (Node* node = first; node != NULL; node = node->next) {
+        Parameter* param = node->data;
 
-            //Allocates memory for the dates and times
-            DateTime *dateField = malloc(sizeof(DateTime));
-            if (dateField == NULL) {
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+        writeText(out, ";", param->name, "=", param->value, NULL);
+    }
 
-            //Sets UTC and isText values to false
-            dateField->UTC = false;
-            dateField->isText = false;
+    //Writes the values, separated by semicolons
+    writeText(out, ":", NULL);
 
-            //Allocates memory for date
-            dateField->date = malloc(9);
-            if (dateField->date == NULL) {
-                free(dateField);
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+    first = prop->values != NULL ? prop->values->head : NULL;
 
-            int textLength = strlen(value);
+    for (Node* node = first; node != NULL; node = node->next) {
+        writeText(out, node == first ? "" : ";", (char*)node->data, NULL);
+    }
 
-            //Allocates memory for time
-            dateField->time = malloc(7);
-            if (dateField->time == NULL) {
-                free(dateField->date);
-                free(dateField);
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+    endLine(out);
+}
 
-            //Allocates memory for text
-            dateField->text = malloc(textLength + 1);
-            if (dateField->text == NULL) {
-                free(dateField->time);
-                free(dateField->date);
-                free(dateField);
-                deleteProperty(newProp);
-                fclose(fptr);
-                return OTHER_ERROR;
-            }
+//Writes a card in vCard format to an open stream, folding long content lines
+VCardErrorCode writeCardToStream(FILE* fptr, const Card* obj) {
 
-            //If date is text format
-            if (textFlag == 1) {
-                strcpy(dateField->text, value);
-                dateField->isText = true;
-                dateField->date[0] = '\0';
-                dateField->time[0] = '\0';
-            }
-            //If date is not text format
-            else {
+    //Checks to see if function parameters are NULL
+    if (fptr == NULL || obj == NULL) {
+        return WRITE_ERROR;
+    }
 
-                //If there is no date specified, store only the time
-                if (value[0] == 'T') {
-                    dateField->date[0] = '\0';
-                    strncpy(dateField->time, value + 1, 6);
-                    dateField->time[6] = '\0';
-                }
-                //If there is a date
-                else {
-                    char *tempT = strchr(value, 'T');
-
-                    //If there is date and time
-                    if (tempT) {
-                        //Stores the date
-                        size_t dateLength = tempT - value;
-                        strncpy(dateField->date, value, dateLength);
-                        dateField->date[dateLength] = '\0';
-
-                        //Stores the time
-                        strncpy(dateField->time, tempT + 1, 6);
-                        dateField->time[6] = '\0';
-
-                        //Sets UTC to true
-                        if (tempT[7] == 'Z') {
-                            dateField->UTC = true;
-                        }
-                    }
-                    //If there is no time
-                    else {
-                        //Stores the date
-                        strncpy(dateField->date, value, 8);
-                        dateField->date[8] = '\0';
-                        dateField->time[0] = '\0';
-                    }
-                }
-            }
+    LineWriter out = {fptr, 0, 0, true};
 
-            //If property is birthday
-            if (strcmp(propertyName, "BDAY") == 0) {
-                (*obj)->birthday = dateField;
-            }
-            //If property is anniversary 
-            else {
-                (*obj)->anniversary = dateField;
-            }
+    //Writes beginning of the card
+    writeText(&out, "BEGIN:VCARD", NULL);
+    endLine(&out);
+    writeText(&out, "VERSION:4.0", NULL);
+    endLine(&out);
 
-            deleteProperty(newProp);
-        }
-        //Adds to linked list
-        else {
-            insertBack((*obj)->optionalProperties, newProp);
+    //Writes the first value of the FN property
+    if (obj->fn != NULL && obj->fn->values != NULL && obj->fn->values->head != NULL) {
+        writeText(&out, "FN:", (char*)obj->fn->values->head->data, NULL);
+        endLine(&out);
+    }
+
+    writeDate(&out, "BDAY", obj->birthday);
+    writeDate(&out, "ANNIVERSARY", obj->anniversary);
+
+    //Writes the optional properties
+    if (obj->optionalProperties != NULL) {
+        for (Node* node = obj->optionalProperties->head; out.ok && node != NULL; node = node->next) {
+            writeProperty(&out, node->data);
         }
     }
-    fclose(fptr);
 
-    return OK;
+    //Writes end of the card
+    writeText(&out, "END:VCARD", NULL);
+    endLine(&out);
+
+    addParserBytes(0, out.written);
+
+    return out.ok ? OK : WRITE_ERROR;
 }
 
 //Writes the struct to a vcf file
-VCardErrorCode writeCard(const char* fileName, const Card* obj) {
+static VCardErrorCode writeCardFile(const char* fileName, const Card* obj) {
 
     //Checks to see if function parameters are NULL
     if (fileName == NULL || obj == NULL) {
         return WRITE_ERROR;
     }
 
-    //Initializes variables
-    char* fullName = NULL;
-
     //Opens file
-    FILE *fptr;
-    fptr = fopen(fileName, "w");
+    FILE *fptr = fopen(fileName, "w");
 
     //Returns error code
     if (fptr == NULL) {
         return WRITE_ERROR;
     }
 
-    //Stores full name in a temp variable
-    if (obj->fn != NULL && obj->fn->values != NULL && obj->fn->values->head != NULL) {
-        fullName = (char*)(obj->fn->values->head->data);
-    }
-
-    //A helper function to ensure fprintf writes properly
-    int writeCheck(int result) {
-        
-        //If fprintf returns -1, writing has failed
-        if (result < 0) {
-            fclose(fptr);
-            //Writing failed
-            return 1;
-        }
-        //Writing was successful
-        return 0;
-    }
-
-    //Writes beginning of file
-    if (writeCheck(fprintf(fptr, "BEGIN:VCARD\r\n")) || writeCheck(fprintf(fptr, "VERSION:4.0\r\n"))){
-        return WRITE_ERROR;
-    }
-
-    //Writes FN property to file
-    if (fullName != NULL) {
-        if (writeCheck(fprintf(fptr, "FN:%s\r\n", fullName))) {
-            return WRITE_ERROR;
-        }
-    }
+    VCardErrorCode err = writeCardToStream(fptr, obj);
 
-    //Writes birthday to file
-    if (obj->birthday != NULL) {
-        //If birthday stores is in text format
-        if (obj->birthday->isText) {
-            if (writeCheck(fprintf(fptr, "BDAY;VALUE=text:%s\r\n", obj->birthday->text))) {
-                return WRITE_ERROR;
-            }
-        }
-        //If birthday stored has both a date and time
-        else if (obj->birthday->date[0] != '\0' && obj->birthday->time[0] != '\0') {
-            if(writeCheck(fprintf(fptr, "BDAY:%sT%s\r\n", obj->birthday->date, obj->birthday->time))) {
-                return WRITE_ERROR;
-            } 
-        }
-        //If birthday only has a date
-        else if (obj->birthday->date[0] != '\0') {
-            if (writeCheck(fprintf(fptr, "BDAY:%s\r\n", obj->birthday->date))) {
-                return WRITE_ERROR;
-            }
-        }
-        //If birthday only has a time
-        else if (obj->birthday->time[0] != '\0') {
-            if (writeCheck(fprintf(fptr, "BDAY:T%s\r\n", obj->birthday->time))) {
-                return WRITE_ERROR;
-            }
-        }
-    }
-    
-    //Writes anniversary to file
-    if (obj->anniversary != NULL) {
-        //If anniversary stored is in text format
-        //THIS IS DEF NOT RIGHT THERES NO WAY YOU CAN JUST HARDCODE THIS YOU GODDAMN IDIOT
-        if (obj->anniversary->isText) {
-            if (writeCheck(fprintf(fptr, "ANNIVERSARY;VALUE=text:%s\r\n", obj->anniversary->text))) {
-                return WRITE_ERROR;
-            }
-        }
-        //If anniversary stored has both a date and time
-        else if (obj->anniversary->date[0] != '\0' && obj->anniversary->time[0] != '\0') {
-            if (writeCheck(fprintf(fptr, "ANNIVERSARY:%sT%s\r\n", obj->anniversary->date, obj->anniversary->time))) {
-                return WRITE_ERROR;
-            } 
-        }
-        //If anniversary only has a date
-        else if (obj->anniversary->date[0] != '\0') {
-            if (writeCheck(fprintf(fptr, "ANNIVERSARY:%s\r\n", obj->anniversary->date))) {
-                return WRITE_ERROR;
-            }
-        }
-        //If anniversary only has a time
-        else if (obj->anniversary->time[0] != '\0') {
-            if (writeCheck(fprintf(fptr, "ANNIVERSARY:T%s\r\n", obj->anniversary->time))) {
-                return WRITE_ERROR;
-            }
-        }
+    //Buffered data is only known to be written once the file is closed
+    if (fclose(fptr) != 0) {
+        err = WRITE_ERROR;
     }
 
-    //Creates an iterator for the properties
-    ListIterator propIterator = createIterator(obj->optionalProperties);
-    Property *prop;
-
-    //Iterates through existing properties
-    while ((prop = nextElement(&propIterator)) != NULL) {
+    return err;
+}
 
-        //Checks for a group and writes to file if one exists
-        if (strlen(prop->group) > 0) {
-            if (writeCheck(fprintf(fptr, "%s.", prop->group))) {
-                return WRITE_ERROR;
-            }
-        }
+//Hook told of every card file written, with its context; set and called under writeHookLock
+static CardWriteHook writeHook;
+static void* writeHookContext;
+static pthread_mutex_t writeHookLock = PTHREAD_MUTEX_INITIALIZER;
 
-        //Writes the name of the property
-        if (writeCheck(fprintf(fptr, "%s", prop->name))) {
-            return  WRITE_ERROR;
-        }
+//Sets the hook told of every card file written
+void setCardWriteHook(CardWriteHook hook, void* context) {
 
-        //Creates an iterator for parameters
-        ListIterator paramIterator = createIterator(prop->parameters);
-        Parameter *param;
+    pthread_mutex_lock(&writeHookLock);
+    writeHook = hook;
+    writeHookContext = context;
+    pthread_mutex_unlock(&writeHookLock);
+}
 
-        bool paramCheck = true;
+//Tells the write hook, if there is one, that a card file has been written
+void notifyCardWritten(const char* fileName, const Card* obj) {
 
-        //Iterates through parameters
-        while ((param = nextElement(&paramIterator)) != NULL) {
-            if (paramCheck) {
-                if (writeCheck(fprintf(fptr, ";"))) {
-                    return WRITE_ERROR;
-                }
-                paramCheck = false;
-            }
-            else {
-                if (writeCheck(fprintf(fptr, ";"))) {
-                    return WRITE_ERROR;
-                }
-            }
-            if (writeCheck(fprintf(fptr, "%s=%s", param->name, param->value))) {
-                return WRITE_ERROR;
-            }
-        }
+    if (fileName == NULL) {
+        return;
+    }
 
-        if (writeCheck(fprintf(fptr, ":"))) {
-            return WRITE_ERROR;
-        }
+    pthread_mutex_lock(&writeHookLock);
 
-        //Creates an iterator for the values
-        ListIterator valueIterator = createIterator(prop->values);
-        char *value;
+    if (writeHook != NULL) {
+        writeHook(fileName, obj, writeHookContext);
+    }
 
-        bool valueCheck = true;
+    pthread_mutex_unlock(&writeHookLock);
+}
 
-        //Iterates through values
-        while ((value = nextElement(&valueIterator)) != NULL) {
-            if (valueCheck) {
-                valueCheck = false;
-            }
-            else {
-                if (writeCheck(fprintf(fptr, ";"))) {
-                    return WRITE_ERROR;
-                }
-            }
-            if (writeCheck(fprintf(fptr, "%s", value))) {
-                return WRITE_ERROR;
-            }
-        }
+//Writes a card to a file, timing it as PHASE_WRITE
+VCardErrorCode writeCard(const char* fileName, const Card* obj) {
 
-        if (writeCheck(fprintf(fptr, "\r\n"))) {
-            return WRITE_ERROR;
-        }
-    }
+    uint64_t start = startParserPhase();
+    VCardErrorCode err = writeCardFile(fileName, obj);
+    endParserPhase(PHASE_WRITE, start);
 
-    //Writes end of file
-    if (writeCheck(fprintf(fptr, "END:VCARD\r\n"))) {
-        return WRITE_ERROR;
+    if (err == OK) {
+        notifyCardWritten(fileName, obj);
     }
 
-    fclose(fptr);
-
-    return OK;
+    return err;
 }
 
 //Ensures the card object is valid
-VCardErrorCode validateCard(const Card* obj) {
+static VCardErrorCode checkCard(const Card* obj) {
     
     //Checks for NULL card object
     if (obj == NULL) {
@@ -922,7 +2332,7 @@ VCardErrorCode validateCard(const Card* obj) {
         //If the DateTime is not a text value
         if (!bday->isText) {
             //Ensures text is an empty string
-            if (bday->text == NULL || strlen(bday->text) == 0) {
+            if (bday->text == NULL || strlen(bday->text) > 0) {
                 return INV_DT;
             }
 
@@ -940,11 +2350,11 @@ VCardErrorCode validateCard(const Card* obj) {
         //If the DateTime is a text value
         if (anniv->isText) {
             //Ensures date is an empty string
-            if (anniv->date == NULL || strlen(anniv->date) == 0) {
+            if (anniv->date == NULL || strlen(anniv->date) > 0) {
                 return INV_DT;
             }
             //Ensures the time is an empty string
-            if (anniv->time == NULL || strlen(anniv->time) == 0) {
+            if (anniv->time == NULL || strlen(anniv->time) > 0) {
                 return INV_DT;
             }
             //Ensures UTC is not true
@@ -956,7 +2366,7 @@ VCardErrorCode validateCard(const Card* obj) {
         //If the DateTime is not a text value
         if (!anniv->isText) {
             //Ensures text is an empty string
-            if (anniv->text == NULL || strlen(anniv->text) == 0) {
+            if (anniv->text == NULL || strlen(anniv->text) > 0) {
                 return INV_DT;
             }
         }
@@ -965,12 +2375,29 @@ VCardErrorCode validateCard(const Card* obj) {
     return OK;
 }
 
+//Validates a card, timing it as PHASE_VALIDATE
+VCardErrorCode validateCard(const Card* obj) {
+
+    uint64_t start = startParserPhase();
+    VCardErrorCode err = checkCard(obj);
+    endParserPhase(PHASE_VALIDATE, start);
+
+    return err;
+}
+
 //Deallocates all memory that was allocated for the card
 void deleteCard(Card* obj) {
 
     if (obj == NULL) {
         return;
     }
+
+    //Deallocates a packed card with its block
+    if (isPacked(obj)) {
+        releasePackedCard(obj);
+        vcFree(obj);
+        return;
+    }
     
     //Deallocates FN
     if (obj->fn) {
@@ -994,11 +2421,11 @@ void deleteCard(Card* obj) {
     }
 
     //Deallocates card
-    free(obj);
+    vcFree(obj);
 }
 
 //Converts the card struct into a readable string
-char* cardToString(const Card* obj) {
+static char* buildCardString(const Card* obj) {
 
     if (obj == NULL) {
         return NULL;
@@ -1113,6 +2540,16 @@ char* cardToString(const Card* obj) {
     return cardString;
 }
 
+//Converts a card to a string, timing it as PHASE_TO_STRING
+char* cardToString(const Card* obj) {
+
+    uint64_t start = startParserPhase();
+    char* str = buildCardString(obj);
+    endParserPhase(PHASE_TO_STRING, start);
+
+    return str;
+}
+
 //Converts error codes into readable strings for the user
 char* errorToString(VCardErrorCode err) {
 
@@ -1137,6 +2574,9 @@ char* errorToString(VCardErrorCode err) {
     else if (err == WRITE_ERROR) {
         errorText = "Error writing to file";
     }
+    else if (err == INV_ENCODING) {
+        errorText = "Invalid UTF-8 in vCard";
+    }
     else {
         errorText = "Invalid error code";
     }
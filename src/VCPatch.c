@@ -0,0 +1,430 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <limits.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCPatch.h"
+
+//Longest group and name that is looked at when matching a line
+#define MAX_NAME 256
+
+//Growable byte buffer for the new file contents
+typedef struct patchBuffer {
+    char*   data;
+    size_t  length;
+    size_t  capacity;
+} PatchBuffer;
+
+//Appends bytes to a buffer
+static bool appendBytes(PatchBuffer* buffer, const char* bytes, size_t len) {
+
+    if (buffer->length + len > buffer->capacity) {
+        size_t newCapacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+
+        while (newCapacity < buffer->length + len) {
+            newCapacity *= 2;
+        }
+
+        char* newData = vcRealloc(buffer->data, newCapacity);
+        if (newData == NULL) {
+            return false;
+        }
+
+        buffer->data = newData;
+        buffer->capacity = newCapacity;
+    }
+
+    memcpy(buffer->data + buffer->length, bytes, len);
+    buffer->length += len;
+
+    return true;
+}
+
+//Reads a whole file into a buffer
+static VCardErrorCode readFile(const char* fileName, PatchBuffer* buffer) {
+
+    FILE* fptr = fopen(fileName, "rb");
+    if (fptr == NULL) {
+        return INV_FILE;
+    }
+
+    char chunk[65536];
+    size_t got;
+    bool ok = true;
+
+    while (ok && (got = fread(chunk, 1, sizeof(chunk), fptr)) > 0) {
+        ok = appendBytes(buffer, chunk, got);
+    }
+
+    bool failed = ferror(fptr);
+    fclose(fptr);
+
+    if (!ok) {
+        return OTHER_ERROR;
+    }
+
+    return failed ? INV_FILE : OK;
+}
+
+//Returns the length of a fold (line break plus one blank) at pos, or 0 if there is none
+static size_t foldAt(const char* data, size_t pos, size_t end) {
+
+    size_t breakLen = 0;
+
+    if (pos + 1 < end && data[pos] == '\r' && data[pos + 1] == '\n') {
+        breakLen = 2;
+    }
+    else if (pos < end && data[pos] == '\n') {
+        breakLen = 1;
+    }
+
+    if (breakLen > 0 && pos + breakLen < end && (data[pos + breakLen] == ' ' || data[pos + breakLen] == '\t')) {
+        return breakLen + 1;
+    }
+
+    return 0;
+}
+
+//Returns the offset just past the line break that ends the content line starting at start
+static size_t lineEnd(const char* data, size_t start, size_t end) {
+
+    size_t pos = start;
+
+    while (pos < end) {
+        const char* newline = memchr(data + pos, '\n', end - pos);
+
+        if (newline == NULL) {
+            return end;
+        }
+
+        pos = (size_t)(newline - data) + 1;
+
+        //A line that starts with a blank continues the previous one
+        if (pos >= end || (data[pos] != ' ' && data[pos] != '\t')) {
+            return pos;
+        }
+    }
+
+    return end;
+}
+
+//Unfolds the part of a content line before its value, including the ':'
+//Returns false if the line has no ':' outside a quoted parameter value
+static bool unfoldHead(const char* data, size_t start, size_t end, PatchBuffer* head) {
+
+    bool quoted = false;
+
+    for (size_t pos = start; pos < end; ) {
+        size_t fold = foldAt(data, pos, end);
+
+        if (fold > 0) {
+            pos += fold;
+            continue;
+        }
+
+        if (data[pos] == '\r' || data[pos] == '\n') {
+            return false;
+        }
+
+        if (!appendBytes(head, &data[pos], 1)) {
+            return false;
+        }
+
+        if (data[pos] == '"') {
+            quoted = !quoted;
+        }
+        else if (data[pos] == ':' && !quoted) {
+            return true;
+        }
+
+        pos++;
+    }
+
+    return false;
+}
+
+//Checks whether the content line starting at start has the given name, ignoring any group
+static bool lineHasName(const char* data, size_t start, size_t end, const char* propName) {
+
+    char name[MAX_NAME];
+    size_t len = 0;
+
+    //Unfolds the group and name, which end at the first ';' or ':'
+    for (size_t pos = start; pos < end && len < sizeof(name) - 1; ) {
+        size_t fold = foldAt(data, pos, end);
+
+        if (fold > 0) {
+            pos += fold;
+            continue;
+        }
+
+        if (data[pos] == ';' || data[pos] == ':' || data[pos] == '\r' || data[pos] == '\n') {
+            break;
+        }
+
+        name[len++] = data[pos++];
+    }
+
+    name[len] = '\0';
+
+    char* dot = strrchr(name, '.');
+
+    return strcasecmp(dot != NULL ? dot + 1 : name, propName) == 0;
+}
+
+//Appends a content line folded as writeCard folds it
+static bool appendFolded(PatchBuffer* out, const char* line, size_t len) {
+
+    size_t column = 0;
+
+    while (true) {
+        size_t chunk = foldOffset(line, len, column);
+
+        if (!appendBytes(out, line, chunk)) {
+            return false;
+        }
+
+        line += chunk;
+        len -= chunk;
+
+        if (len == 0) {
+            break;
+        }
+
+        //Continuation lines start with one space, which counts towards their length
+        if (!appendBytes(out, "\r\n ", 3)) {
+            return false;
+        }
+        column = 1;
+    }
+
+    return appendBytes(out, "\r\n", 2);
+}
+
+//Checks whether file contents start with the gzip magic bytes
+static bool isGzip(const PatchBuffer* file) {
+
+    return file->length >= 2 && (unsigned char)file->data[0] == 0x1f && (unsigned char)file->data[1] == 0x8b;
+}
+
+//Decompresses gzip file contents, following concatenated members as the parser does
+static VCardErrorCode inflateFile(const PatchBuffer* file, PatchBuffer* text) {
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(z_stream));
+    zs.zalloc = vcZlibAlloc;
+    zs.zfree = vcZlibFree;
+
+    //Window bits of 16 + MAX_WBITS accept the gzip wrapper only
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return OTHER_ERROR;
+    }
+
+    zs.next_in = (Bytef*)file->data;
+    zs.avail_in = file->length > UINT_MAX ? UINT_MAX : (uInt)file->length;
+
+    VCardErrorCode err = OK;
+    unsigned char chunk[65536];
+    int ret = Z_OK;
+
+    while (err == OK) {
+        zs.next_out = chunk;
+        zs.avail_out = sizeof(chunk);
+
+        ret = inflate(&zs, Z_NO_FLUSH);
+
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            err = INV_FILE;
+        }
+        else if (!appendBytes(text, (const char*)chunk, sizeof(chunk) - zs.avail_out)) {
+            err = OTHER_ERROR;
+        }
+        else if (ret == Z_STREAM_END) {
+            if (zs.avail_in == 0 && zs.total_in == file->length) {
+                break;
+            }
+
+            //Another member follows
+            inflateReset(&zs);
+        }
+    }
+
+    inflateEnd(&zs);
+
+    return err;
+}
+
+//Compresses new file contents as a single gzip member
+static VCardErrorCode deflateFile(const PatchBuffer* text, PatchBuffer* file) {
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(z_stream));
+    zs.zalloc = vcZlibAlloc;
+    zs.zfree = vcZlibFree;
+
+    if (text->length > UINT_MAX || deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return OTHER_ERROR;
+    }
+
+    size_t bound = deflateBound(&zs, (uLong)text->length);
+    VCardErrorCode err = OK;
+
+    file->data = vcMalloc(bound);
+    file->capacity = bound;
+
+    if (file->data == NULL) {
+        err = OTHER_ERROR;
+    }
+    else {
+        zs.next_in = (Bytef*)text->data;
+        zs.avail_in = (uInt)text->length;
+        zs.next_out = (Bytef*)file->data;
+        zs.avail_out = (uInt)bound;
+
+        //deflateBound leaves room for the whole member in one call
+        err = deflate(&zs, Z_FINISH) == Z_STREAM_END ? OK : OTHER_ERROR;
+        file->length = bound - zs.avail_out;
+    }
+
+    deflateEnd(&zs);
+
+    return err;
+}
+
+//Writes data to a temporary file next to fileName and renames it over fileName
+static VCardErrorCode replaceFile(const char* fileName, const char* data, size_t len) {
+
+    struct stat info;
+    if (stat(fileName, &info) != 0) {
+        return WRITE_ERROR;
+    }
+
+    char* tempName = malloc(strlen(fileName) + sizeof(".XXXXXX"));
+    if (tempName == NULL) {
+        return OTHER_ERROR;
+    }
+
+    strcpy(tempName, fileName);
+    strcat(tempName, ".XXXXXX");
+
+    int fd = mkstemp(tempName);
+    if (fd < 0) {
+        free(tempName);
+        return WRITE_ERROR;
+    }
+
+    //Writes everything, then makes it durable before it becomes visible
+    bool ok = true;
+    for (size_t done = 0; ok && done < len; ) {
+        ssize_t wrote = write(fd, data + done, len - done);
+        ok = wrote > 0;
+
+        if (ok) {
+            done += (size_t)wrote;
+        }
+    }
+
+    ok = ok && fchmod(fd, info.st_mode & 07777) == 0 && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(tempName, fileName) == 0;
+
+    if (!ok) {
+        unlink(tempName);
+    }
+
+    free(tempName);
+
+    return ok ? OK : WRITE_ERROR;
+}
+
+//Replaces the value of one property in a file
+VCardErrorCode updateCardProperty(const char* fileName, const char* propName, const char* newValue) {
+
+    if (fileName == NULL) {
+        return INV_FILE;
+    }
+
+    if (propName == NULL || newValue == NULL || propName[0] == '\0' || newValue[0] == '\0'
+        || strpbrk(propName, "\r\n;:.") != NULL || strpbrk(newValue, "\r\n") != NULL
+        || strcasecmp(propName, "BEGIN") == 0 || strcasecmp(propName, "VERSION") == 0 || strcasecmp(propName, "END") == 0) {
+        return INV_PROP;
+    }
+
+    PatchBuffer file = {NULL, 0, 0};
+    VCardErrorCode err = readFile(fileName, &file);
+
+    //A compressed file is edited as its decompressed text and compressed again when written
+    bool compressed = err == OK && isGzip(&file);
+
+    if (compressed) {
+        PatchBuffer text = {NULL, 0, 0};
+        err = inflateFile(&file, &text);
+
+        vcFree(file.data);
+        file = text;
+    }
+
+    if (err != OK) {
+        vcFree(file.data);
+        return err;
+    }
+
+    //Finds the first content line with the name
+    size_t start = 0;
+    size_t end = 0;
+    bool found = false;
+
+    while (!found && start < file.length) {
+        end = lineEnd(file.data, start, file.length);
+
+        if (lineHasName(file.data, start, end, propName)) {
+            found = true;
+        }
+        else {
+            start = end;
+        }
+    }
+
+    //Rebuilds that line as its original head followed by the new value
+    PatchBuffer line = {NULL, 0, 0};
+    PatchBuffer out = {NULL, 0, 0};
+
+    if (!found || !unfoldHead(file.data, start, end, &line)) {
+        err = INV_PROP;
+    }
+    else if (!appendBytes(&line, newValue, strlen(newValue))
+             || !appendBytes(&out, file.data, start)
+             || !appendFolded(&out, line.data, line.length)
+             || !appendBytes(&out, file.data + end, file.length - end)) {
+        err = OTHER_ERROR;
+    }
+    else if (compressed) {
+        PatchBuffer packed = {NULL, 0, 0};
+        err = deflateFile(&out, &packed);
+
+        if (err == OK) {
+            err = replaceFile(fileName, packed.data, packed.length);
+        }
+
+        vcFree(packed.data);
+    }
+    else {
+        err = replaceFile(fileName, out.data, out.length);
+    }
+
+    vcFree(file.data);
+    vcFree(line.data);
+    vcFree(out.data);
+
+    if (err == OK) {
+        notifyCardWritten(fileName, NULL);
+    }
+
+    return err;
+}
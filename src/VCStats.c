@@ -0,0 +1,89 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#include "VCStats.h"
+
+//Whether any thread gathers statistics; read without ordering since counters are per thread
+static atomic_bool statsEnabled = false;
+
+//Counters of the calling thread
+static _Thread_local ParserStats threadStats;
+
+//Checks the enabled flag
+static bool isEnabled(void) {
+
+    return atomic_load_explicit(&statsEnabled, memory_order_relaxed);
+}
+
+//Turns statistics on or off
+void setParserStatsEnabled(bool enabled) {
+
+    atomic_store_explicit(&statsEnabled, enabled, memory_order_relaxed);
+}
+
+//Copies the calling thread's counters
+void getParserStats(ParserStats* stats) {
+
+    if (stats != NULL) {
+        *stats = threadStats;
+    }
+}
+
+//Zeroes the calling thread's counters
+void resetParserStats(void) {
+
+    memset(&threadStats, 0, sizeof(ParserStats));
+}
+
+//Reads the monotonic clock in nanoseconds, never returning 0
+uint64_t startParserPhase(void) {
+
+    if (!isEnabled()) {
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+
+    return ns != 0 ? ns : 1;
+}
+
+//Adds the time since start to a phase
+void endParserPhase(ParserPhase phase, uint64_t start) {
+
+    if (start == 0 || phase < 0 || phase >= NUM_PHASES) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+
+    threadStats.phases[phase].calls++;
+    threadStats.phases[phase].nanoseconds += ns > start ? ns - start : 0;
+}
+
+//Counts bytes of vCard text
+void addParserBytes(uint64_t read, uint64_t written) {
+
+    if (isEnabled()) {
+        threadStats.bytesRead += read;
+        threadStats.bytesWritten += written;
+    }
+}
+
+//Counts memory calls
+void addParserAllocations(uint64_t allocations, uint64_t reallocations, uint64_t frees) {
+
+    if (isEnabled()) {
+        threadStats.allocations += allocations;
+        threadStats.reallocations += reallocations;
+        threadStats.frees += frees;
+    }
+}
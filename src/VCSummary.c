@@ -0,0 +1,179 @@
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCSummary.h"
+
+//Growable string blob used while a batch is being built
+typedef struct blob {
+    char*   data;
+    size_t  length;
+    size_t  capacity;
+} Blob;
+
+//Appends a NUL-terminated copy of str to the blob and stores its offset, failing if memory runs out
+//or the offset would not fit in 32 bits
+static bool appendString(Blob* blob, const char* str, uint32_t* offset) {
+
+    //Empty and missing strings share the terminator at offset 0
+    if (str == NULL || str[0] == '\0') {
+        *offset = 0;
+        return true;
+    }
+
+    size_t size = strlen(str) + 1;
+
+    //Offsets are 32 bits wide
+    if (blob->length + size > UINT32_MAX) {
+        return false;
+    }
+
+    //Grows the blob geometrically
+    if (blob->length + size > blob->capacity) {
+        size_t newCapacity = blob->capacity * 2;
+
+        while (newCapacity < blob->length + size) {
+            newCapacity *= 2;
+        }
+
+        char* newData = realloc(blob->data, newCapacity);
+        if (newData == NULL) {
+            return false;
+        }
+
+        blob->data = newData;
+        blob->capacity = newCapacity;
+    }
+
+    *offset = (uint32_t)blob->length;
+    memcpy(blob->data + blob->length, str, size);
+    blob->length += size;
+
+    return true;
+}
+
+//Appends the three strings of a DateTime
+static bool appendDate(Blob* blob, const DateTime* date, uint32_t* dateOffset, uint32_t* timeOffset, uint32_t* textOffset) {
+
+    return appendString(blob, date->date, dateOffset) && appendString(blob, date->time, timeOffset) && appendString(blob, date->text, textOffset);
+}
+
+//Fills in one record from a parsed card, failing if its strings cannot be stored
+static bool summarizeCard(const Card* card, CardSummary* record, Blob* blob) {
+
+    //Stores the first FN value
+    if (card->fn != NULL && card->fn->values != NULL) {
+        if (!appendString(blob, getFromFront(card->fn->values), &record->fn)) {
+            return false;
+        }
+    }
+
+    record->numOptionalProperties = card->optionalProperties ? getLength(card->optionalProperties) : 0;
+
+    //Stores the birthday
+    if (card->birthday != NULL) {
+        record->flags |= SUMMARY_HAS_BIRTHDAY;
+        record->flags |= card->birthday->UTC ? SUMMARY_BIRTHDAY_UTC : 0;
+        record->flags |= card->birthday->isText ? SUMMARY_BIRTHDAY_TEXT : 0;
+
+        if (!appendDate(blob, card->birthday, &record->birthdayDate, &record->birthdayTime, &record->birthdayText)) {
+            return false;
+        }
+    }
+
+    //Stores the anniversary
+    if (card->anniversary != NULL) {
+        record->flags |= SUMMARY_HAS_ANNIVERSARY;
+        record->flags |= card->anniversary->UTC ? SUMMARY_ANNIVERSARY_UTC : 0;
+        record->flags |= card->anniversary->isText ? SUMMARY_ANNIVERSARY_TEXT : 0;
+
+        if (!appendDate(blob, card->anniversary, &record->anniversaryDate, &record->anniversaryTime, &record->anniversaryText)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Parses a set of files into a flat batch of summaries
+VCardErrorCode createCardSummaries(char** fileNames, int numFiles, CardSummaryBatch** obj) {
+
+    if (fileNames == NULL || numFiles < 0 || obj == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *obj = NULL;
+
+    //Allocates the records up front, since there is exactly one per file
+    CardSummary* records = calloc(numFiles > 0 ? numFiles : 1, sizeof(CardSummary));
+    if (records == NULL) {
+        return OTHER_ERROR;
+    }
+
+    //Offset 0 of the blob is the shared empty string
+    Blob blob = {malloc(4096), 1, 4096};
+    if (blob.data == NULL) {
+        free(records);
+        return OTHER_ERROR;
+    }
+    blob.data[0] = '\0';
+
+    //Parses and summarizes every file into one reused card
+    Card* card = createEmptyCard();
+    if (card == NULL) {
+        free(records);
+        free(blob.data);
+        return OTHER_ERROR;
+    }
+
+    for (int i = 0; i < numFiles; i++) {
+        VCardErrorCode err = createCardInto(fileNames[i], card);
+        bool stored = appendString(&blob, fileNames[i], &records[i].fileName);
+
+        if (stored && err == OK) {
+            err = validateCard(card);
+            stored = summarizeCard(card, &records[i], &blob);
+        }
+
+        //A record with missing strings would silently read as empty, so the batch fails instead
+        if (!stored) {
+            deleteCard(card);
+            free(records);
+            free(blob.data);
+            return OTHER_ERROR;
+        }
+
+        records[i].status = err;
+    }
+
+    deleteCard(card);
+
+    //Packs the header, records and blob into one block
+    size_t recordsSize = sizeof(CardSummary) * numFiles;
+    CardSummaryBatch* batch = malloc(sizeof(CardSummaryBatch) + recordsSize + blob.length);
+    if (batch == NULL) {
+        free(records);
+        free(blob.data);
+        return OTHER_ERROR;
+    }
+
+    batch->count = numFiles;
+    batch->stringsLength = blob.length;
+    batch->records = (CardSummary*)(batch + 1);
+    batch->strings = (char*)batch->records + recordsSize;
+
+    memcpy(batch->records, records, recordsSize);
+    memcpy(batch->strings, blob.data, blob.length);
+
+    free(records);
+    free(blob.data);
+
+    *obj = batch;
+
+    return OK;
+}
+
+//Releases a summary batch
+void deleteCardSummaries(CardSummaryBatch* obj) {
+
+    //The batch is a single allocation
+    free(obj);
+}
@@ -0,0 +1,558 @@
+#include <stdint.h>
+#include <strings.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCTrie.h"
+
+//Keys longer than this are truncated
+#define MAX_KEY 128
+
+//One (key, card) pair waiting to be built into the tree
+typedef struct trieEntry {
+    uint32_t    keyStart;
+    uint32_t    keyLength;
+    uint32_t    doc;
+} TrieEntry;
+
+//One node of the tree.  Its children are numChildren adjacent nodes, sorted by first byte
+typedef struct trieNode {
+    //Edge label, as a range of the key pool
+    uint32_t    labelStart;
+    uint32_t    labelLength;
+
+    uint32_t    firstChild;
+    uint32_t    numChildren;
+
+    //Range of the card id array covering every key below this node
+    uint32_t    postingStart;
+    uint32_t    postingEnd;
+} TrieNode;
+
+struct cardTrie {
+    //Bytes of every key, which node labels point into
+    char*       pool;
+    uint32_t    poolLength;
+    uint32_t    poolCapacity;
+
+    //Keys added so far
+    TrieEntry*  entries;
+    uint32_t    numEntries;
+    uint32_t    entryCapacity;
+
+    //File name of every card
+    char**      docs;
+    uint32_t    numDocs;
+    uint32_t    docCapacity;
+
+    //Built tree, with the card ids of every key in key order
+    TrieNode*   nodes;
+    uint32_t    numNodes;
+    uint32_t*   postings;
+};
+
+//Checks whether a byte belongs in a word
+static bool isWordByte(unsigned char c) {
+
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+//Folds text into key: ASCII letters lowercased, separator runs collapsed to one space
+static size_t foldName(const char* text, char* key) {
+
+    const unsigned char* pos = (const unsigned char*)text;
+    size_t len = 0;
+
+    while (*pos != '\0') {
+        //Skips separators, remembering that a space is needed before the next word
+        if (!isWordByte(*pos)) {
+            pos++;
+            continue;
+        }
+
+        if (len > 0 && len < MAX_KEY) {
+            key[len++] = ' ';
+        }
+
+        while (*pos != '\0' && isWordByte(*pos)) {
+            if (len < MAX_KEY) {
+                key[len++] = (*pos >= 'A' && *pos <= 'Z') ? (char)(*pos + ('a' - 'A')) : (char)*pos;
+            }
+            pos++;
+        }
+    }
+
+    return len;
+}
+
+//Grows an array so it can hold one more element
+static bool reserve(void** array, uint32_t* capacity, uint32_t count, size_t size, uint32_t initial) {
+
+    if (count < *capacity) {
+        return true;
+    }
+
+    uint32_t newCapacity = *capacity ? *capacity * 2 : initial;
+    void* newArray = realloc(*array, newCapacity * size);
+
+    if (newArray == NULL) {
+        return false;
+    }
+
+    *array = newArray;
+    *capacity = newCapacity;
+
+    return true;
+}
+
+//Adds one key for a card
+static bool addKey(CardTrie* trie, const char* key, size_t len, uint32_t doc) {
+
+    if (len == 0) {
+        return true;
+    }
+
+    while (trie->poolLength + len > trie->poolCapacity) {
+        uint32_t newCapacity = trie->poolCapacity ? trie->poolCapacity * 2 : 65536;
+        char* newPool = realloc(trie->pool, newCapacity);
+
+        if (newPool == NULL) {
+            return false;
+        }
+
+        trie->pool = newPool;
+        trie->poolCapacity = newCapacity;
+    }
+
+    if (!reserve((void**)&trie->entries, &trie->entryCapacity, trie->numEntries, sizeof(TrieEntry), 1024)) {
+        return false;
+    }
+
+    memcpy(trie->pool + trie->poolLength, key, len);
+    trie->entries[trie->numEntries++] = (TrieEntry){trie->poolLength, (uint32_t)len, doc};
+    trie->poolLength += (uint32_t)len;
+
+    return true;
+}
+
+//Adds a value as one whole key, and each of its words as a key
+static bool addName(CardTrie* trie, const char* value, uint32_t doc, bool whole) {
+
+    char key[MAX_KEY];
+    size_t len = foldName(value, key);
+
+    if (whole && !addKey(trie, key, len, doc)) {
+        return false;
+    }
+
+    for (size_t start = 0; start < len; ) {
+        size_t end = start;
+        while (end < len && key[end] != ' ') {
+            end++;
+        }
+
+        if (!addKey(trie, key + start, end - start, doc)) {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return true;
+}
+
+//Creates an empty trie
+CardTrie* createCardTrie(void) {
+
+    return calloc(1, sizeof(CardTrie));
+}
+
+//Releases a trie
+void deleteCardTrie(CardTrie* trie) {
+
+    if (trie == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < trie->numDocs; i++) {
+        free(trie->docs[i]);
+    }
+
+    free(trie->pool);
+    free(trie->entries);
+    free(trie->docs);
+    free(trie->nodes);
+    free(trie->postings);
+    free(trie);
+}
+
+//Records the file name of a new card, returning its id or UINT32_MAX on failure
+static uint32_t addDocument(CardTrie* trie, const char* fileName) {
+
+    if (!reserve((void**)&trie->docs, &trie->docCapacity, trie->numDocs, sizeof(char*), 256)) {
+        return UINT32_MAX;
+    }
+
+    char* name = malloc(strlen(fileName) + 1);
+    if (name == NULL) {
+        return UINT32_MAX;
+    }
+
+    strcpy(name, fileName);
+    trie->docs[trie->numDocs] = name;
+
+    return trie->numDocs++;
+}
+
+//Adds the FN and N words of a card
+VCardErrorCode addCardToTrie(CardTrie* trie, const char* fileName, const Card* card) {
+
+    if (trie == NULL || fileName == NULL || card == NULL) {
+        return OTHER_ERROR;
+    }
+
+    uint32_t doc = addDocument(trie, fileName);
+    if (doc == UINT32_MAX) {
+        return OTHER_ERROR;
+    }
+
+    //Each FN value is a key of its own, so a typed first and last name finds it
+    bool ok = true;
+    ListIterator valIter;
+    char* value;
+
+    if (card->fn != NULL) {
+        valIter = createIterator(card->fn->values);
+
+        while (ok && (value = nextElement(&valIter)) != NULL) {
+            ok = addName(trie, value, doc, true);
+        }
+    }
+
+    //N components are only searchable word by word
+    ListIterator propIter = createIterator(card->optionalProperties);
+    Property* prop;
+
+    while (ok && (prop = nextElement(&propIter)) != NULL) {
+        if (strcasecmp(prop->name, "N") != 0) {
+            continue;
+        }
+
+        valIter = createIterator(prop->values);
+
+        while (ok && (value = nextElement(&valIter)) != NULL) {
+            ok = addName(trie, value, doc, false);
+        }
+    }
+
+    return ok ? OK : OTHER_ERROR;
+}
+
+//Key pool used by the entry sort, since qsort has no context argument
+static _Thread_local const char* sortingPool;
+
+//Compares two keys of the pool bytewise
+static int compareKeys(const TrieEntry* a, const TrieEntry* b) {
+
+    uint32_t shorter = a->keyLength < b->keyLength ? a->keyLength : b->keyLength;
+    int diff = memcmp(sortingPool + a->keyStart, sortingPool + b->keyStart, shorter);
+
+    if (diff != 0) {
+        return diff;
+    }
+
+    return (a->keyLength > b->keyLength) - (a->keyLength < b->keyLength);
+}
+
+//Orders entries by key, then by card
+static int compareEntries(const void* first, const void* second) {
+
+    const TrieEntry* a = (const TrieEntry*)first;
+    const TrieEntry* b = (const TrieEntry*)second;
+    int diff = compareKeys(a, b);
+
+    if (diff != 0) {
+        return diff;
+    }
+
+    return (a->doc > b->doc) - (a->doc < b->doc);
+}
+
+//Builds the tree from the sorted distinct keys
+VCardErrorCode buildCardTrie(CardTrie* trie) {
+
+    if (trie == NULL) {
+        return OTHER_ERROR;
+    }
+
+    if (trie->numEntries > 1) {
+        sortingPool = trie->pool;
+        qsort(trie->entries, trie->numEntries, sizeof(TrieEntry), compareEntries);
+    }
+
+    //Drops repeated (key, card) pairs
+    uint32_t numEntries = 0;
+    for (uint32_t i = 0; i < trie->numEntries; i++) {
+        if (numEntries == 0 || compareEntries(&trie->entries[numEntries - 1], &trie->entries[i]) != 0) {
+            trie->entries[numEntries++] = trie->entries[i];
+        }
+    }
+    trie->numEntries = numEntries;
+
+    //Splits the entries into distinct keys, remembering where each key's cards start
+    uint32_t count = numEntries > 0 ? numEntries : 1;
+    TrieEntry* keys = malloc(count * sizeof(TrieEntry));
+    uint32_t* keyStart = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t* postings = malloc(count * sizeof(uint32_t));
+
+    //A radix tree with n leaves has at most 2n - 1 nodes, plus the root
+    TrieNode* nodes = malloc((2 * count + 1) * sizeof(TrieNode));
+
+    //Key range and depth of each node while it waits to be expanded
+    uint32_t* nodeLow = malloc((2 * count + 1) * sizeof(uint32_t));
+    uint32_t* nodeHigh = malloc((2 * count + 1) * sizeof(uint32_t));
+    uint32_t* nodeDepth = malloc((2 * count + 1) * sizeof(uint32_t));
+
+    if (keys == NULL || keyStart == NULL || postings == NULL || nodes == NULL || nodeLow == NULL || nodeHigh == NULL || nodeDepth == NULL) {
+        free(keys);
+        free(keyStart);
+        free(postings);
+        free(nodes);
+        free(nodeLow);
+        free(nodeHigh);
+        free(nodeDepth);
+        return OTHER_ERROR;
+    }
+
+    uint32_t numKeys = 0;
+    for (uint32_t i = 0; i < numEntries; i++) {
+        if (numKeys == 0 || compareKeys(&keys[numKeys - 1], &trie->entries[i]) != 0) {
+            keys[numKeys] = trie->entries[i];
+            keyStart[numKeys++] = i;
+        }
+        postings[i] = trie->entries[i].doc;
+    }
+    keyStart[numKeys] = numEntries;
+
+    //Expands nodes breadth-first, appending each node's children as one block
+    nodes[0] = (TrieNode){0, 0, 0, 0, 0, numEntries};
+    nodeLow[0] = 0;
+    nodeHigh[0] = numKeys;
+    nodeDepth[0] = 0;
+    uint32_t numNodes = numKeys > 0 ? 1 : 0;
+
+    for (uint32_t n = 0; n < numNodes; n++) {
+        uint32_t low = nodeLow[n];
+        uint32_t high = nodeHigh[n];
+        uint32_t depth = nodeDepth[n];
+        const TrieEntry* first = &keys[low];
+        const TrieEntry* last = &keys[high - 1];
+
+        //Keys are sorted, so the common prefix of the range is that of its first and last keys
+        uint32_t end = depth;
+        while (end < first->keyLength && end < last->keyLength
+               && trie->pool[first->keyStart + end] == trie->pool[last->keyStart + end]) {
+            end++;
+        }
+
+        nodes[n].labelStart = first->keyStart + depth;
+        nodes[n].labelLength = end - depth;
+        nodes[n].postingStart = keyStart[low];
+        nodes[n].postingEnd = keyStart[high];
+        nodes[n].firstChild = numNodes;
+        nodes[n].numChildren = 0;
+
+        //A key that ends here sorts first and needs no child
+        uint32_t i = low;
+        if (first->keyLength == end) {
+            i++;
+        }
+
+        //Every run of keys sharing the next byte becomes one child
+        while (i < high) {
+            char next = trie->pool[keys[i].keyStart + end];
+            uint32_t j = i + 1;
+
+            while (j < high && trie->pool[keys[j].keyStart + end] == next) {
+                j++;
+            }
+
+            nodeLow[numNodes] = i;
+            nodeHigh[numNodes] = j;
+            nodeDepth[numNodes] = end;
+            numNodes++;
+            nodes[n].numChildren++;
+
+            i = j;
+        }
+    }
+
+    free(keys);
+    free(keyStart);
+    free(nodeLow);
+    free(nodeHigh);
+    free(nodeDepth);
+
+    free(trie->nodes);
+    free(trie->postings);
+    trie->nodes = nodes;
+    trie->numNodes = numNodes;
+    trie->postings = postings;
+
+    return OK;
+}
+
+//Parses files and builds a trie over their names
+VCardErrorCode createCardTrieFromFiles(char** fileNames, int numFiles, CardTrie** trie) {
+
+    if (fileNames == NULL || numFiles < 0 || trie == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *trie = NULL;
+
+    CardTrie* built = createCardTrie();
+    Card* card = createEmptyCard();
+    VCardErrorCode err = (built != NULL && card != NULL) ? OK : OTHER_ERROR;
+
+    //Parses every file into one reused card, skipping the ones that do not parse
+    for (int i = 0; err == OK && i < numFiles; i++) {
+        if (createCardInto(fileNames[i], card) == OK) {
+            err = addCardToTrie(built, fileNames[i], card);
+        }
+    }
+
+    deleteCard(card);
+
+    if (err == OK) {
+        err = buildCardTrie(built);
+    }
+
+    if (err != OK) {
+        deleteCardTrie(built);
+        return err;
+    }
+
+    *trie = built;
+
+    return OK;
+}
+
+//Builds a trie over names that are already known, such as the FN values of a summary batch
+VCardErrorCode createCardTrieFromNames(char** fileNames, char** names, int numNames, CardTrie** trie) {
+
+    if (fileNames == NULL || names == NULL || numNames < 0 || trie == NULL) {
+        return OTHER_ERROR;
+    }
+
+    *trie = NULL;
+
+    CardTrie* built = createCardTrie();
+    VCardErrorCode err = built != NULL ? OK : OTHER_ERROR;
+
+    //Each name is a key of its own and is also searchable word by word, as FN is for cards
+    for (int i = 0; err == OK && i < numNames; i++) {
+        if (fileNames[i] == NULL || names[i] == NULL) {
+            err = OTHER_ERROR;
+            break;
+        }
+
+        uint32_t doc = addDocument(built, fileNames[i]);
+
+        if (doc == UINT32_MAX || !addName(built, names[i], doc, true)) {
+            err = OTHER_ERROR;
+        }
+    }
+
+    if (err == OK) {
+        err = buildCardTrie(built);
+    }
+
+    if (err != OK) {
+        deleteCardTrie(built);
+        return err;
+    }
+
+    *trie = built;
+
+    return OK;
+}
+
+//Finds the child of a node whose label starts with a byte
+static const TrieNode* findChild(const CardTrie* trie, const TrieNode* node, char next) {
+
+    uint32_t low = node->firstChild;
+    uint32_t high = node->firstChild + node->numChildren;
+
+    //Children are sorted by first byte
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        unsigned char first = (unsigned char)trie->pool[trie->nodes[mid].labelStart];
+
+        if (first == (unsigned char)next) {
+            return &trie->nodes[mid];
+        }
+        if (first < (unsigned char)next) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return NULL;
+}
+
+//Returns the first maxResults distinct cards with a key starting with prefix
+int lookupCardPrefix(const CardTrie* trie, const char* prefix, const char** fileNames, int maxResults) {
+
+    if (trie == NULL || prefix == NULL || fileNames == NULL || maxResults <= 0 || trie->numNodes == 0) {
+        return 0;
+    }
+
+    char key[MAX_KEY];
+    size_t len = foldName(prefix, key);
+
+    //Walks down the tree while the prefix matches the labels
+    const TrieNode* node = &trie->nodes[0];
+    size_t matched = 0;
+
+    while (true) {
+        size_t remaining = len - matched;
+        size_t compare = remaining < node->labelLength ? remaining : node->labelLength;
+
+        if (memcmp(trie->pool + node->labelStart, key + matched, compare) != 0) {
+            return 0;
+        }
+
+        //The prefix ends inside this label, so every key below the node matches
+        if (remaining <= node->labelLength) {
+            break;
+        }
+
+        matched += node->labelLength;
+        node = findChild(trie, node, key[matched]);
+
+        if (node == NULL) {
+            return 0;
+        }
+    }
+
+    //Collects distinct cards in key order
+    int found = 0;
+
+    for (uint32_t i = node->postingStart; i < node->postingEnd && found < maxResults; i++) {
+        const char* name = trie->docs[trie->postings[i]];
+        bool seen = false;
+
+        for (int j = 0; j < found && !seen; j++) {
+            seen = fileNames[j] == name;
+        }
+
+        if (!seen) {
+            fileNames[found++] = name;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,188 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCStats.h"
+#include "VCWriter.h"
+
+//Size of the stdio buffer cards are written through
+#define WRITER_BUFFER_SIZE (1 << 20)
+
+//Size of zlib's input buffer when compressing
+#define GZIP_BUFFER_SIZE (256 * 1024)
+
+struct vCardWriter {
+    //Buffered stream the cards are written to, through zlib if compressing
+    FILE*   stream;
+    char*   buffer;
+
+    //The file itself, kept open so it can be synced once the stream is closed
+    int     fd;
+
+    int     count;
+    bool    failed;
+};
+
+//Passes buffered text to zlib, in pieces since gzwrite takes an unsigned length
+static ssize_t gzipWrite(void* cookie, const char* buf, size_t size) {
+
+    size_t done = 0;
+
+    while (done < size) {
+        unsigned chunk = size - done > UINT_MAX ? UINT_MAX : (unsigned)(size - done);
+        int written = gzwrite(cookie, buf + done, chunk);
+
+        if (written <= 0) {
+            return done > 0 ? (ssize_t)done : -1;
+        }
+
+        done += (size_t)written;
+    }
+
+    return (ssize_t)done;
+}
+
+//Finishes the gzip stream and closes its descriptor
+static int gzipClose(void* cookie) {
+
+    return gzclose(cookie) == Z_OK ? 0 : -1;
+}
+
+//Opens a stream on a duplicate of fd, gzip-compressed if asked to
+static FILE* openStream(int fd, bool compress) {
+
+    int streamFd = dup(fd);
+    if (streamFd < 0) {
+        return NULL;
+    }
+
+    if (!compress) {
+        FILE* stream = fdopen(streamFd, "w");
+
+        if (stream == NULL) {
+            close(streamFd);
+        }
+
+        return stream;
+    }
+
+    gzFile gz = gzdopen(streamFd, "wb");
+    if (gz == NULL) {
+        close(streamFd);
+        return NULL;
+    }
+
+    gzbuffer(gz, GZIP_BUFFER_SIZE);
+
+    cookie_io_functions_t functions = {NULL, gzipWrite, NULL, gzipClose};
+    FILE* stream = fopencookie(gz, "w", functions);
+
+    if (stream == NULL) {
+        gzclose(gz);
+    }
+
+    return stream;
+}
+
+//Creates a file for cards to be appended to
+VCardErrorCode openVCardWriter(const char* fileName, bool compress, VCardWriter** writer) {
+
+    if (fileName == NULL || writer == NULL) {
+        return OTHER_ERROR;
+    }
+
+    VCardWriter* newWriter = calloc(1, sizeof(VCardWriter));
+    if (newWriter == NULL) {
+        return OTHER_ERROR;
+    }
+
+    newWriter->buffer = vcMalloc(WRITER_BUFFER_SIZE);
+    if (newWriter->buffer == NULL) {
+        free(newWriter);
+        return OTHER_ERROR;
+    }
+
+    newWriter->fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (newWriter->fd < 0) {
+        vcFree(newWriter->buffer);
+        free(newWriter);
+        return WRITE_ERROR;
+    }
+
+    newWriter->stream = openStream(newWriter->fd, compress);
+    if (newWriter->stream == NULL) {
+        close(newWriter->fd);
+        vcFree(newWriter->buffer);
+        free(newWriter);
+        return WRITE_ERROR;
+    }
+
+    //One large buffer turns many small card writes into few large ones
+    setvbuf(newWriter->stream, newWriter->buffer, _IOFBF, WRITER_BUFFER_SIZE);
+
+    *writer = newWriter;
+
+    return OK;
+}
+
+//Writes a card to the end of a writer's file
+VCardErrorCode appendCard(VCardWriter* writer, const Card* obj) {
+
+    if (writer == NULL || obj == NULL || writer->failed) {
+        return WRITE_ERROR;
+    }
+
+    uint64_t start = startParserPhase();
+    VCardErrorCode err = writeCardToStream(writer->stream, obj);
+    endParserPhase(PHASE_WRITE, start);
+
+    //A partly written card leaves the file damaged, so nothing more is written
+    if (err != OK) {
+        writer->failed = true;
+        return err;
+    }
+
+    writer->count++;
+
+    return OK;
+}
+
+//Returns the number of cards written
+int vcardWriterCount(const VCardWriter* writer) {
+
+    return writer != NULL ? writer->count : 0;
+}
+
+//Flushes, syncs and closes a writer's file
+VCardErrorCode closeVCardWriter(VCardWriter* writer) {
+
+    if (writer == NULL) {
+        return OK;
+    }
+
+    VCardErrorCode err = writer->failed ? WRITE_ERROR : OK;
+
+    //Closing the stream flushes the buffer and finishes any gzip stream
+    if (fclose(writer->stream) != 0) {
+        err = WRITE_ERROR;
+    }
+
+    if (fsync(writer->fd) != 0) {
+        err = WRITE_ERROR;
+    }
+
+    if (close(writer->fd) != 0) {
+        err = WRITE_ERROR;
+    }
+
+    vcFree(writer->buffer);
+    free(writer);
+
+    return err;
+}
@@ -0,0 +1,402 @@
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LinkedListAPI.h"
+#include "VCParser.h"
+#include "VCAlloc.h"
+#include "VCDiff.h"
+#include "VCMedia.h"
+
+/*  Leak test for the parser, built with AddressSanitizer by 'make test'.  Every file named on
+    the command line, valid or malformed, is parsed, written back, re-read, cloned and scanned
+    for media on the main thread and again on worker threads that exit without any cleanup.
+    LeakSanitizer fails the run on anything left allocated at exit, and each thread also checks
+    that its vcMalloc accounting returns to where it started.  Every card written back must be
+    folded into lines of at most 75 octets without splitting a UTF-8 sequence, and must read
+    back with no changes according to diffCards.  Parameter matching with hasParamValue is
+    checked last, including after the arena of shared comma lists has filled up.
+*/
+
+//Threads that run the same work as the main thread at the same time
+#define NUM_WORKERS 4
+
+//Files under test
+static char** fileNames;
+static int numFiles;
+
+//Scratch file for the write and re-read step
+static const char* tempFile = "test/leakTest.tmp.vcf";
+
+//Reads a whole file into a malloc buffer
+static char* readFile(const char* fileName, size_t* length) {
+
+    FILE* fptr = fopen(fileName, "rb");
+    if (fptr == NULL) {
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    char* buffer = malloc(capacity);
+    *length = 0;
+
+    while (buffer != NULL) {
+        *length += fread(buffer + *length, 1, capacity - *length, fptr);
+
+        if (*length < capacity) {
+            break;
+        }
+
+        char* newBuffer = realloc(buffer, capacity * 2);
+        if (newBuffer == NULL) {
+            free(buffer);
+        }
+
+        buffer = newBuffer;
+        capacity *= 2;
+    }
+
+    fclose(fptr);
+
+    return buffer;
+}
+
+//Sink for scanCardMedia that stops at the first decoded byte of the second media
+static bool stopAtSecondMedia(const CardMediaInfo* media, const void* bytes, size_t length, void* context) {
+
+    (void)bytes;
+    (void)context;
+
+    return media->mediaIndex == 0 || length == 0;
+}
+
+//Checks that a written file has no line over VCARD_FOLD_OCTETS octets and no fold inside a
+//UTF-8 sequence
+static bool checkFolding(const char* fileName) {
+
+    size_t length = 0;
+    char* data = readFile(fileName, &length);
+
+    if (data == NULL) {
+        return false;
+    }
+
+    bool ok = true;
+    size_t start = 0;
+
+    while (ok && start < length) {
+        const char* lf = memchr(data + start, '\n', length - start);
+        size_t end = lf != NULL ? (size_t)(lf - data) : length;
+        size_t lineLength = end - start - (end > start && data[end - 1] == '\r');
+
+        //A continuation line starts with the fold's blank, then must not resume mid-sequence
+        bool splitSequence = lineLength > 1 && data[start] == ' ' && ((unsigned char)data[start + 1] & 0xc0) == 0x80;
+
+        if (lineLength > VCARD_FOLD_OCTETS || splitSequence) {
+            fprintf(stderr, "leakTest: %s: badly folded line at offset %zu\n", fileName, start);
+            ok = false;
+        }
+
+        start = end + 1;
+    }
+
+    free(data);
+
+    return ok;
+}
+
+//Checks that a card written to tempFile is folded correctly and reads back unchanged
+static bool checkWriteBack(const Card* card, const char* source) {
+
+    if (writeCard(tempFile, card) != OK) {
+        return true;
+    }
+
+    bool ok = checkFolding(tempFile);
+
+    Card* reread = NULL;
+    CardDiff* diff = NULL;
+
+    if (createCard((char*)tempFile, &reread) != OK) {
+        fprintf(stderr, "leakTest: %s: written card does not parse\n", source);
+        ok = false;
+    }
+    else {
+        free(cardToString(reread));
+
+        if (diffCards(card, reread, &diff) != OK || diff->numChanges != 0) {
+            fprintf(stderr, "leakTest: %s: written card reads back changed\n", source);
+            ok = false;
+        }
+    }
+
+    deleteCardDiff(diff);
+    deleteCard(reread);
+
+    return ok;
+}
+
+//Exercises everything that allocates for a card that parsed, returning false if writing it
+//back failed a check
+static bool exerciseCard(const Card* card, const char* source, bool writeBack) {
+
+    validateCard(card);
+    free(cardToString(card));
+
+    //A clone's lists must stay safe to clear, as with any other card
+    Card* clone = cloneCard(card);
+
+    if (clone != NULL && clone->fn != NULL) {
+        clearList(clone->fn->parameters);
+        clearList(clone->fn->values);
+        insertBack(clone->fn->parameters, createParameter("TYPE", "added"));
+
+        char* value = vcMalloc(sizeof("added"));
+        if (value != NULL) {
+            strcpy(value, "added");
+            insertBack(clone->fn->values, value);
+        }
+    }
+
+    if (clone != NULL && clone->optionalProperties->head != NULL) {
+        Property* prop = clone->optionalProperties->head->data;
+        clearList(prop->values);
+    }
+
+    deleteCard(clone);
+
+    return !writeBack || checkWriteBack(card, source);
+}
+
+//Telephone lines for checkParameters, each with the TYPE values it must and must not match
+static const struct {
+    const char* line;
+    const char* matches;
+    const char* misses;
+} typeChecks[] = {
+    {"TEL;TYPE=work:1", "WORK", "home"},
+    {"TEL;TYPE=WORK:2", "work", "HOME"},
+    {"TEL;TYPE=Work:3", "wOrK", "Home"},
+    {"TEL;TYPE=wOrK:4", "Work", "cell"},
+    {"TEL;TYPE=work,:5", "work", ""},
+    {"TEL;TYPE=,Work,,Voice:6", "VOICE", "fax"},
+    {"TEL;TYPE=x-custom,work:7", "X-CUSTOM", "x-cust"},
+    {"TEL;TYPE=x-custom:8", "x-custom", "work"}
+};
+
+#define NUM_TYPE_CHECKS ((int)(sizeof(typeChecks) / sizeof(typeChecks[0])))
+
+//Words from the parameter vocabulary used to make comma lists no card has used yet
+static const char* const listWords[] = {
+    "work", "home", "cell", "voice", "fax", "msg", "text", "video", "pager", "textphone",
+    "internet", "x400", "dom", "intl", "postal", "parcel", "bbs", "modem", "car", "isdn",
+    "pcs", "uri", "date", "time", "jpeg", "png", "gif", "b", "pref", "label"
+};
+
+#define NUM_LIST_WORDS ((int)(sizeof(listWords) / sizeof(listWords[0])))
+
+//Parses one property line into a card and checks hasParamValue on it
+static bool checkTypeLine(const char* line, const char* matches, const char* misses) {
+
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "BEGIN:VCARD\r\nVERSION:4.0\r\nFN:Test\r\n%s\r\nEND:VCARD\r\n", line);
+
+    Card* card = NULL;
+    bool ok = createCardFromBuffer(buffer, (size_t)length, &card) == OK && card->optionalProperties->head != NULL;
+
+    if (ok) {
+        const Property* prop = card->optionalProperties->head->data;
+
+        ok = hasParamValue(prop, "type", matches) && hasParamValue(prop, "TYPE", matches) && !hasParamValue(prop, "TYPE", misses)
+             && !hasParamValue(prop, "PREF", matches);
+
+        //Shared strings in the query must find the same parameters as any other spelling
+        const char* sharedName = internParamString("TYPE");
+        const char* sharedValue = internParamString(matches);
+
+        if (sharedValue != NULL) {
+            ok = ok && hasParamValue(prop, sharedName, sharedValue);
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "leakTest: %s does not match TYPE=%s and only that\n", line, matches);
+    }
+
+    deleteCard(card);
+
+    return ok;
+}
+
+//Checks parameter matching across spellings and comma lists, then fills the shared list arena
+//and checks that lists which no longer fit are kept as plain strings that still match
+static bool checkParameters(void) {
+
+    bool ok = true;
+
+    for (int i = 0; i < NUM_TYPE_CHECKS; i++) {
+        ok = checkTypeLine(typeChecks[i].line, typeChecks[i].matches, typeChecks[i].misses) && ok;
+    }
+
+    char list[64];
+    bool full = false;
+
+    for (int i = 0; !full && i < NUM_LIST_WORDS; i++) {
+        for (int j = 0; !full && j < NUM_LIST_WORDS; j++) {
+            if (i == j) {
+                continue;
+            }
+
+            snprintf(list, sizeof(list), "%s,%s,%s", listWords[i], listWords[j], listWords[(i + j) % NUM_LIST_WORDS]);
+
+            Parameter* param = createParameter("TYPE", list);
+            if (param == NULL) {
+                fprintf(stderr, "leakTest: createParameter failed for %s\n", list);
+                return false;
+            }
+
+            if (strcmp(param->value, list) != 0) {
+                fprintf(stderr, "leakTest: TYPE=%s was stored as %s\n", list, param->value);
+                ok = false;
+            }
+
+            full = !isInternedString(param->value);
+            deleteParameter(param);
+        }
+    }
+
+    if (!full) {
+        fprintf(stderr, "leakTest: the shared list arena never filled\n");
+        return false;
+    }
+
+    //The last list did not fit, so this line's parameter is an ordinary copy, searched here
+    //for its last item in upper case
+    char line[96];
+    snprintf(line, sizeof(line), "TEL;TYPE=%s:9", list);
+
+    char item[16];
+    snprintf(item, sizeof(item), "%s", strrchr(list, ',') + 1);
+
+    for (char* c = item; *c != '\0'; c++) {
+        *c = (char)toupper((unsigned char)*c);
+    }
+
+    return checkTypeLine(line, item, "x-custom") && ok;
+}
+
+//Runs every parsing path over every file, returning false if a check failed or the thread's
+//accounting leaked
+static bool runFiles(bool writeBack) {
+
+    bool ok = true;
+
+    VCardHeapStats before;
+    VCardHeapStats after;
+
+    getVCardHeapStats(&before);
+
+    Card* reused = createEmptyCard();
+
+    for (int i = 0; i < numFiles; i++) {
+        Card* card = NULL;
+
+        if (createCard(fileNames[i], &card) == OK) {
+            ok = exerciseCard(card, fileNames[i], writeBack) && ok;
+        }
+
+        deleteCard(card);
+
+        size_t length = 0;
+        char* buffer = readFile(fileNames[i], &length);
+
+        if (buffer != NULL) {
+            card = NULL;
+
+            if (createCardFromBuffer(buffer, length, &card) == OK) {
+                exerciseCard(card, fileNames[i], false);
+            }
+
+            deleteCard(card);
+
+            if (reused != NULL) {
+                createCardIntoFromBuffer(buffer, length, reused);
+            }
+
+            free(buffer);
+        }
+
+        scanCardMedia(fileNames[i], stopAtSecondMedia, NULL);
+
+        if (reused != NULL && createCardInto(fileNames[i], reused) == OK) {
+            exerciseCard(reused, fileNames[i], false);
+        }
+    }
+
+    deleteCard(reused);
+    clearCardPool();
+
+    getVCardHeapStats(&after);
+
+    if (after.bytesInUse != before.bytesInUse) {
+        fprintf(stderr, "leakTest: %lld bytes still in use\n", (long long)(after.bytesInUse - before.bytesInUse));
+        return false;
+    }
+
+    return ok;
+}
+
+//Worker thread: parses every file, then leaves a card pool behind for thread exit to free
+static void* runWorker(void* result) {
+
+    *(bool*)result = runFiles(false);
+
+    Card* reused = createEmptyCard();
+
+    for (int i = 0; i < numFiles; i++) {
+        createCardInto(fileNames[i], reused);
+    }
+
+    deleteCard(reused);
+
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s file...\n", argv[0]);
+        return 2;
+    }
+
+    fileNames = argv + 1;
+    numFiles = argc - 1;
+
+    bool ok = runFiles(true);
+    remove(tempFile);
+
+    pthread_t workers[NUM_WORKERS];
+    bool results[NUM_WORKERS];
+
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        results[i] = false;
+
+        if (pthread_create(&workers[i], NULL, runWorker, &results[i]) != 0) {
+            fprintf(stderr, "leakTest: could not start a worker\n");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        pthread_join(workers[i], NULL);
+        ok = ok && results[i];
+    }
+
+    ok = checkParameters() && ok;
+
+    printf("leakTest: %d files on %d threads: %s\n", numFiles, NUM_WORKERS + 1, ok ? "ok" : "FAILED");
+
+    return ok ? 0 : 1;
+}